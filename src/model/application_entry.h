@@ -0,0 +1,77 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2019 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KSMOOTHDOCK_APPLICATION_ENTRY_H_
+#define KSMOOTHDOCK_APPLICATION_ENTRY_H_
+
+#include <optional>
+
+#include <QString>
+#include <QStringList>
+
+#include <utils/command_utils.h>
+
+namespace ksmoothdock {
+
+// An application entry in the application menu.
+struct ApplicationEntry {
+  // Name e.g. 'Chrome'.
+  QString name;
+
+  // Generic name e.g. 'Web Brower'.
+  QString genericName;
+
+  // Icon name e.g. 'chrome'.
+  QString icon;
+
+  // Command to execute e.g. '/usr/bin/google-chrome-stable'.
+  QString command;
+
+  // The task command, to compare with KWindowInfo.windowClassName, e.g. 'google-chrome'
+  QString taskCommand;
+
+  // The path to the desktop file e.g. '/usr/share/applications/chrome.desktop'
+  QString desktopFile;
+
+  ApplicationEntry(const QString& name2, const QString& genericName2,
+                   const QString& icon2, const QString& command2,
+                   const QString& desktopFile2)
+      : name(name2), genericName(genericName2), icon(icon2), command(command2),
+        taskCommand(getTaskCommand(command)), desktopFile(desktopFile2) {}
+
+  // With an already resolved task command.
+  ApplicationEntry(const QString& name2, const QString& genericName2,
+                   const QString& icon2, const QString& command2,
+                   const QString& taskCommand2, const QString& desktopFile2)
+      : name(name2), genericName(genericName2), icon(icon2), command(command2),
+        taskCommand(taskCommand2), desktopFile(desktopFile2) {}
+};
+
+// An application entry read from a .desktop file, not yet added to the
+// categories.
+struct DesktopEntry {
+  // Not set if the entry is not to be displayed.
+  std::optional<ApplicationEntry> entry;
+  QStringList categories;
+};
+
+bool operator<(const ApplicationEntry &e1, const ApplicationEntry &e2);
+
+}  // namespace ksmoothdock
+
+#endif  // KSMOOTHDOCK_APPLICATION_ENTRY_H_
@@ -20,19 +20,27 @@
 
 #include <algorithm>
 #include <iostream>
+#include <utility>
 
 #include <QApplication>
 #include <QDir>
+#include <QHash>
 #include <QStringBuilder>
 #include <QUrl>
+#include <QtConcurrent>
 
-#include <KDesktopFile>
 #include <KLocalizedString>
 
+#include "config_helper.h"
+#include "desktop_entry_index.h"
+#include <utils/binary_file.h>
 #include <utils/command_utils.h>
+#include <utils/desktop_file_parser.h>
 
 namespace ksmoothdock {
 
+constexpr int ApplicationMenuConfig::kUpdateDelay;
+
 const std::vector<Category> ApplicationMenuConfig::kSessionSystemCategories = {
   {"Session", "Session", "system-switch-user", {
     {"Lock Screen",
@@ -88,13 +96,17 @@ bool operator<(const ApplicationEntry &e1, const ApplicationEntry &e2) {
 
 ApplicationMenuConfig::ApplicationMenuConfig(const QStringList& entryDirs)
     : entryDirs_(entryDirs),
+      indexPath_(ConfigHelper::desktopEntryIndexPath(entryDirs)),
       fileWatcher_(entryDirs) {
   initCategories();
   loadEntries();
+  updateTimer_.setSingleShot(true);
+  updateTimer_.setInterval(kUpdateDelay);
+  connect(&updateTimer_, SIGNAL(timeout()), this, SLOT(updateEntries()));
   connect(&fileWatcher_, SIGNAL(directoryChanged(const QString&)),
-          this, SLOT(reload()));
+          &updateTimer_, SLOT(start()));
   connect(&fileWatcher_, SIGNAL(fileChanged(const QString&)),
-          this, SLOT(reload()));
+          &updateTimer_, SLOT(start()));
 }
 
 void ApplicationMenuConfig::initCategories() {
@@ -125,70 +137,259 @@ void ApplicationMenuConfig::initCategories() {
 }
 
 bool ApplicationMenuConfig::loadEntries() {
-  for (const QString& entryDir : entryDirs_) {
-    if (!QDir::root().exists(entryDir)) {
-      continue;
+  std::vector<DesktopEntryIndex::Dir> indexedDirs;
+  if (!DesktopEntryIndex::load(indexPath_, &indexedDirs) ||
+      indexedDirs.size() != static_cast<size_t>(entryDirs_.size())) {
+    indexedDirs.clear();
+  }
+
+  const bool changed = scanEntryDirs(indexedDirs, &dirs_);
+  for (const auto& dir : dirs_) {
+    for (const auto& file : dir.files) {
+      addEntry(file.desktopEntry);
     }
+  }
+
+  if (changed || indexedDirs.empty()) {
+    saveIndex();
+  }
 
-    QDir dir(entryDir);
-    QStringList files = dir.entryList({"*.desktop"}, QDir::Files, QDir::Name);
-    if (files.isEmpty()) {
+  return true;
+}
+
+bool ApplicationMenuConfig::scanEntryDirs(
+    const std::vector<DesktopEntryIndex::Dir>& knownDirs,
+    std::vector<DesktopEntryIndex::Dir>* dirs) const {
+  bool changed = false;
+  dirs->clear();
+  dirs->reserve(entryDirs_.size());
+  // The files to parse, as indices into dirs and files.
+  QStringList filesToParse;
+  std::vector<std::pair<int, int>> parseTargets;
+  for (int i = 0; i < entryDirs_.size(); ++i) {
+    dirs->emplace_back();
+    auto& dir = dirs->back();
+    dir.path = entryDirs_[i];
+    qint64 size;
+    fileStamp(dir.path, &dir.modified, &size);
+    const DesktopEntryIndex::Dir* knownDir =
+        (!knownDirs.empty() && knownDirs[i].path == dir.path)
+            ? &knownDirs[i] : nullptr;
+    if (dir.modified < 0) {
+      changed = changed || (knownDir == nullptr) || (knownDir->modified >= 0);
       continue;
     }
 
-    for (int i = 0; i < files.size(); ++i) {
-      const QString& file = entryDir + "/" + files.at(i);
-      loadEntry(file);
+    // Files are only added, removed or renamed if the dir has changed.
+    QStringList fileNames;
+    if (knownDir != nullptr && knownDir->modified == dir.modified) {
+      for (const auto& knownFile : knownDir->files) {
+        fileNames.append(knownFile.path.mid(dir.path.size() + 1));
+      }
+    } else {
+      changed = true;
+      fileNames = QDir(dir.path).entryList({"*.desktop"}, QDir::Files,
+                                           QDir::Name);
+    }
+
+    QHash<QString, const DesktopEntryIndex::File*> knownFiles;
+    if (knownDir != nullptr) {
+      for (const auto& knownFile : knownDir->files) {
+        knownFiles[knownFile.path] = &knownFile;
+      }
+    }
+
+    dir.files.reserve(fileNames.size());
+    for (const QString& fileName : fileNames) {
+      dir.files.emplace_back();
+      auto& file = dir.files.back();
+      file.path = dir.path + "/" + fileName;
+      fileStamp(file.path, &file.modified, &file.size);
+      const auto* knownFile = knownFiles.value(file.path);
+      if (knownFile != nullptr && knownFile->modified == file.modified &&
+          knownFile->size == file.size) {
+        file.desktopEntry = knownFile->desktopEntry;
+        continue;
+      }
+      filesToParse.append(file.path);
+      parseTargets.emplace_back(i, static_cast<int>(dir.files.size()) - 1);
     }
   }
 
-  return true;
+  // Parsing the files is the expensive part. The results are in the order of
+  // the files, so that adding them gives the same categories regardless of
+  // the number of threads.
+  if (!filesToParse.isEmpty()) {
+    changed = true;
+    const auto desktopEntries =
+        QtConcurrent::blockingMapped<std::vector<DesktopEntry>>(
+            filesToParse, &ApplicationMenuConfig::readEntry);
+    for (size_t i = 0; i < desktopEntries.size(); ++i) {
+      const auto& target = parseTargets[i];
+      (*dirs)[target.first].files[target.second].desktopEntry =
+          desktopEntries[i];
+    }
+  }
+
+  return changed;
 }
 
-bool ApplicationMenuConfig::loadEntry(const QString &file) {
-  KDesktopFile desktopFile(file);
-  if (desktopFile.noDisplay()) {
-    return false;
+void ApplicationMenuConfig::updateEntries() {
+  std::vector<DesktopEntryIndex::Dir> dirs;
+  if (!scanEntryDirs(dirs_, &dirs)) {
+    return;
   }
 
-  if (desktopFile.entryMap("Desktop Entry").contains("Hidden")) {
-    const QString hidden = desktopFile.entryMap("Desktop Entry")["Hidden"];
-    if (hidden.trimmed().toLower() == "true") {
-      return false;
+  QHash<QString, const DesktopEntryIndex::File*> oldFiles;
+  for (const auto& dir : dirs_) {
+    for (const auto& file : dir.files) {
+      oldFiles[file.path] = &file;
+    }
+  }
+  QHash<QString, const DesktopEntryIndex::File*> newFiles;
+  for (const auto& dir : dirs) {
+    for (const auto& file : dir.files) {
+      newFiles[file.path] = &file;
+    }
+  }
+  const auto sameFile = [](const DesktopEntryIndex::File* file1,
+                           const DesktopEntryIndex::File* file2) {
+    return file1 != nullptr && file2 != nullptr &&
+        file1->modified == file2->modified && file1->size == file2->size;
+  };
+
+  ApplicationEntryChanges changes;
+  for (const auto& dir : dirs_) {
+    for (const auto& file : dir.files) {
+      if (!sameFile(&file, newFiles.value(file.path))) {
+        removeEntry(file.desktopEntry, &changes);
+      }
+    }
+  }
+  for (const auto& dir : dirs) {
+    for (const auto& file : dir.files) {
+      if (!sameFile(&file, oldFiles.value(file.path))) {
+        addEntry(file.desktopEntry, &changes);
+      }
     }
   }
 
-  const QStringList categories =
-      desktopFile.entryMap("Desktop Entry")["Categories"]
-          .split(';', QString::SkipEmptyParts);
-  if (categories.isEmpty()) {
+  dirs_ = std::move(dirs);
+  updateEntryMap();
+  saveIndex();
+  if (!changes.empty()) {
+    emit entriesChanged(changes);
+  }
+}
+
+void ApplicationMenuConfig::saveIndex() {
+  if (!DesktopEntryIndex::save(indexPath_, dirs_)) {
+    std::cerr << "Failed to save the desktop entry index to "
+              << indexPath_.toStdString() << std::endl;
+  }
+}
+
+/* static */ DesktopEntry ApplicationMenuConfig::readEntry(
+    const QString& file) {
+  DesktopEntry desktopEntry;
+  DesktopFileEntry fileEntry;
+  if (!DesktopFileParser().parse(file, &fileEntry) || fileEntry.noDisplay ||
+      fileEntry.hidden) {
+    return desktopEntry;
+  }
+
+  desktopEntry.categories = fileEntry.categories;
+  if (desktopEntry.categories.isEmpty()) {
+    return desktopEntry;
+  }
+
+  const QString command = filterFieldCodes(fileEntry.exec);
+  desktopEntry.entry.emplace(fileEntry.name,
+                             fileEntry.genericName,
+                             fileEntry.icon,
+                             command,
+                             file);
+  return desktopEntry;
+}
+
+bool ApplicationMenuConfig::addEntry(const DesktopEntry& desktopEntry,
+                                     ApplicationEntryChanges* changes) {
+  if (!desktopEntry.entry) {
     return false;
   }
 
-  for (int i = 0; i < categories.size(); ++i) {
-    const std::string category = categories[i].toStdString();
+  const ApplicationEntry& newEntry = *desktopEntry.entry;
+  for (const QString& categoryName : desktopEntry.categories) {
+    const std::string category = categoryName.toStdString();
     if (categoryMap_.count(category) > 0) {
-      const QString command = filterFieldCodes(
-          desktopFile.entryMap("Desktop Entry")["Exec"]);
-      ApplicationEntry newEntry(desktopFile.readName(),
-                                desktopFile.readGenericName(),
-                                desktopFile.readIcon(),
-                                command,
-                                file);
       auto& entries = categories_[categoryMap_[category]].entries;
       auto next = std::lower_bound(entries.begin(), entries.end(), newEntry);
       entries.insert(next, newEntry);
 
       entries_[newEntry.taskCommand.toStdString()] = &(*--next);
+      if (changes != nullptr) {
+        changes->addedEntries.emplace_back(categoryName, newEntry);
+      }
     }
   }
   return true;
 }
 
+void ApplicationMenuConfig::removeEntry(const DesktopEntry& desktopEntry,
+                                        ApplicationEntryChanges* changes) {
+  if (!desktopEntry.entry) {
+    return;
+  }
+
+  const QString& desktopFile = desktopEntry.entry->desktopFile;
+  for (const QString& categoryName : desktopEntry.categories) {
+    const std::string category = categoryName.toStdString();
+    if (categoryMap_.count(category) > 0) {
+      categories_[categoryMap_[category]].entries.remove_if(
+          [&desktopFile](const ApplicationEntry& entry) {
+            return entry.desktopFile == desktopFile;
+          });
+      changes->removedEntries.emplace_back(categoryName, desktopFile);
+    }
+  }
+}
+
+void ApplicationMenuConfig::updateEntryMap() {
+  // The entries of each category by desktop file.
+  std::vector<QHash<QString, const ApplicationEntry*>> categoryEntries(
+      categories_.size());
+  for (size_t i = 0; i < categories_.size(); ++i) {
+    for (const auto& entry : categories_[i].entries) {
+      categoryEntries[i][entry.desktopFile] = &entry;
+    }
+  }
+
+  // The same as adding all the entries in order: the last one wins.
+  entries_.clear();
+  for (const auto& dir : dirs_) {
+    for (const auto& file : dir.files) {
+      if (!file.desktopEntry.entry) {
+        continue;
+      }
+      for (const QString& categoryName : file.desktopEntry.categories) {
+        const auto category = categoryMap_.find(categoryName.toStdString());
+        if (category != categoryMap_.end()) {
+          const ApplicationEntry* entry =
+              categoryEntries[category->second].value(file.path);
+          if (entry != nullptr) {
+            entries_[entry->taskCommand.toStdString()] = entry;
+          }
+        }
+      }
+    }
+  }
+}
+
 void ApplicationMenuConfig::reload() {
   for (auto& category : categories_) {
     category.entries.clear();
   }
+  entries_.clear();
   loadEntries();
   emit configChanged();
 }
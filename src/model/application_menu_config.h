@@ -4,6 +4,7 @@
 #include <list>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <QDir>
@@ -12,40 +13,13 @@
 #include <QObject>
 #include <QString>
 #include <QStringList>
+#include <QTimer>
 
-#include <utils/command_utils.h>
+#include "application_entry.h"
+#include "desktop_entry_index.h"
 
 namespace ksmoothdock {
 
-// An application entry in the application menu.
-struct ApplicationEntry {
-  // Name e.g. 'Chrome'.
-  QString name;
-
-  // Generic name e.g. 'Web Brower'.
-  QString genericName;
-
-  // Icon name e.g. 'chrome'.
-  QString icon;
-
-  // Command to execute e.g. '/usr/bin/google-chrome-stable'.
-  QString command;
-
-  // The task command, to compare with KWindowInfo.windowClassName, e.g. 'google-chrome'
-  QString taskCommand;
-
-  // The path to the desktop file e.g. '/usr/share/applications/chrome.desktop'
-  QString desktopFile;
-
-  ApplicationEntry(const QString& name2, const QString& genericName2,
-                   const QString& icon2, const QString& command2,
-                   const QString& desktopFile2)
-      : name(name2), genericName(genericName2), icon(icon2), command(command2),
-        taskCommand(getTaskCommand(command)), desktopFile(desktopFile2) {}
-};
-
-bool operator<(const ApplicationEntry &e1, const ApplicationEntry &e2);
-
 // A category in the application menu.
 struct Category {
   // Name for the category e.g. 'Development' or 'Utility'. See:
@@ -71,6 +45,17 @@ struct Category {
   }
 };
 
+// Changes to the application entries after desktop files have been added,
+// removed or modified. A modified entry is removed then added again.
+struct ApplicationEntryChanges {
+  // Category names and desktop files of the removed entries.
+  std::vector<std::pair<QString, QString>> removedEntries;
+  // Category names and the added entries, in the order they have been added.
+  std::vector<std::pair<QString, ApplicationEntry>> addedEntries;
+
+  bool empty() const { return removedEntries.empty() && addedEntries.empty(); }
+};
+
 class ApplicationMenuConfig : public QObject {
   Q_OBJECT
 
@@ -93,25 +78,64 @@ class ApplicationMenuConfig : public QObject {
   }
 
  signals:
+  // All the entries have been reloaded.
   void configChanged();
+  // Some entries have changed.
+  void entriesChanged(const ApplicationEntryChanges& changes);
 
  public slots:
   void reload();
 
+ private slots:
+  // Re-parses only the desktop files that have been added, removed or
+  // modified, and emits entriesChanged() if any has.
+  void updateEntries();
+
  private:
+  // Bursts of entry dir changes, e.g. from a package manager, are handled at
+  // once after this delay, in milliseconds.
+  static constexpr int kUpdateDelay = 500;
+
   // Initializes application categories.
   void initCategories();
 
-  // Loads application entries from entryDir.
+  // Loads application entries from entryDir. The .desktop files that are not
+  // in the desktop entry index, or that have changed since, are read in
+  // parallel. The entries are then added in the order of the entry dirs and
+  // of the file names, and the index is updated.
   bool loadEntries();
 
-  // Loads an application entry from the .desktop file.
-  bool loadEntry(const QString& file);
+  // Scans the entry dirs into dirs, taking the desktop files that haven't
+  // changed from knownDirs, which is either empty or has one dir per entry
+  // dir. The other files are read in parallel. Returns whether anything has
+  // changed compared to knownDirs.
+  bool scanEntryDirs(const std::vector<DesktopEntryIndex::Dir>& knownDirs,
+                     std::vector<DesktopEntryIndex::Dir>* dirs) const;
+
+  // Reads an application entry from the .desktop file. This is thread-safe.
+  static DesktopEntry readEntry(const QString& file);
+
+  // Adds an application entry to its categories.
+  bool addEntry(const DesktopEntry& desktopEntry,
+                ApplicationEntryChanges* changes = nullptr);
+
+  // Removes an application entry from its categories. The look-up map has to
+  // be rebuilt afterwards.
+  void removeEntry(const DesktopEntry& desktopEntry,
+                   ApplicationEntryChanges* changes);
+
+  // Rebuilds the look-up map from commands to application entries.
+  void updateEntryMap();
+
+  void saveIndex();
 
   // The directories that contains the list of all application entries as
   // desktop files, e.g. /usr/share/applications
   const QStringList entryDirs_;
 
+  // See DesktopEntryIndex.
+  const QString indexPath_;
+
   // Application entries, organized by categories.
   std::vector<Category> categories_;
   // Map from category names to category indices in the above vector,
@@ -120,7 +144,11 @@ class ApplicationMenuConfig : public QObject {
   // Map from commands to application entries for fast look-up.
   std::unordered_map<std::string, const ApplicationEntry*> entries_;
 
+  // The entry dirs and their desktop files, as last loaded.
+  std::vector<DesktopEntryIndex::Dir> dirs_;
+
   QFileSystemWatcher fileWatcher_;
+  QTimer updateTimer_;
 
   friend class ApplicationMenuConfigTest;
 };
@@ -18,14 +18,24 @@
 
 #include "application_menu_config.h"
 
+#include <algorithm>
 #include <memory>
 
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
 #include <QTemporaryDir>
 #include <QTest>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
 
 #include <KConfig>
 #include <KConfigGroup>
 
+#include "config_helper.h"
+
 namespace ksmoothdock {
 
 constexpr int kNumCategories = 11;
@@ -34,6 +44,11 @@ class ApplicationMenuConfigTest: public QObject {
   Q_OBJECT
 
  private slots:
+  void initTestCase() {
+    // Keeps the desktop entry indices out of the user's cache dir.
+    QStandardPaths::setTestModeEnabled(true);
+  }
+
   void init() {
     QTemporaryDir configDir;
   }
@@ -41,7 +56,82 @@ class ApplicationMenuConfigTest: public QObject {
   void loadEntries_singleDir();
   void loadEntries_multipleDirs();
 
+  // Tests that the entries don't depend on the number of threads.
+  void loadEntries_deterministic();
+
+  // Tests that unchanged desktop files are loaded from the index.
+  void loadEntries_index();
+
+  // Tests that changed desktop files are parsed again.
+  void loadEntries_indexOutdated();
+
+  // Tests that only the added, removed and modified desktop files are
+  // reported as changes.
+  void updateEntries();
+
+  // Tests that a burst of entry dir changes is handled at once.
+  void updateEntries_debounce();
+
+  // Loads a synthetic corpus of desktop files with different numbers of
+  // threads, and from the desktop entry index.
+  void loadEntries_benchmark_data();
+  void loadEntries_benchmark();
+
  private:
+  // Writes desktop files with duplicate names and commands, and a few
+  // entries that are not to be displayed.
+  void writeCorpus(const QString& dir, int fileCount) {
+    static const char* const kCategories[] = {
+      "Development", "Game;Education", "Network", "AudioVideo;Qt;KDE",
+      "Utility", "Office", "System;Settings", "NotACategory"
+    };
+    for (int i = 0; i < fileCount; ++i) {
+      QFile file(QString("%1/app%2.desktop").arg(dir).arg(i, 5, 10, QChar('0')));
+      QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+      QTextStream out(&file);
+      out << "[Desktop Entry]\n"
+          << "Type=Application\n"
+          << "Name=App " << (i % 97) << "\n"
+          << "Name[de]=Anwendung " << (i % 97) << "\n"
+          << "GenericName=Generic " << i << "\n"
+          << "Icon=icon" << i << "\n"
+          << "Exec=/usr/bin/app" << (i % 331) << " %U\n"
+          << "Categories=" << kCategories[i % 8] << ";\n";
+      if (i % 50 == 0) {
+        out << "NoDisplay=true\n";
+      } else if (i % 70 == 0) {
+        out << "Hidden=true\n";
+      }
+    }
+  }
+
+  // The entries of all categories, and the look-up results.
+  static QStringList describe(const ApplicationMenuConfig& config) {
+    QStringList description;
+    for (const auto& category : config.categories_) {
+      for (const auto& entry : category.entries) {
+        description.append(category.name + ": " + entry.name + " " +
+                           entry.command + " " + entry.desktopFile);
+      }
+    }
+    std::vector<std::string> commands;
+    for (const auto& entry : config.entries_) {
+      commands.push_back(entry.first);
+    }
+    std::sort(commands.begin(), commands.end());
+    for (const auto& command : commands) {
+      description.append(QString::fromStdString(command) + " -> " +
+                         config.entries_.at(command)->desktopFile);
+    }
+    return description;
+  }
+
+
+  static void setModified(const QString& filename, const QDateTime& modified) {
+    QFile file(filename);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.setFileTime(modified, QFileDevice::FileModificationTime));
+  }
 
   void writeEntry(const QString& filename, const ApplicationEntry& entry,
                   const QString& categories,
@@ -136,6 +226,212 @@ void ApplicationMenuConfigTest::loadEntries_multipleDirs() {
   }
 }
 
+void ApplicationMenuConfigTest::loadEntries_deterministic() {
+  QTemporaryDir entryDir1;
+  QVERIFY(entryDir1.isValid());
+  writeCorpus(entryDir1.path(), 500);
+  QTemporaryDir entryDir2;
+  QVERIFY(entryDir2.isValid());
+  writeCorpus(entryDir2.path(), 100);
+  const QStringList entryDirs = { entryDir1.path(), entryDir2.path() };
+  const QString indexPath = ConfigHelper::desktopEntryIndexPath(entryDirs);
+
+  auto* threadPool = QThreadPool::globalInstance();
+  const int maxThreadCount = threadPool->maxThreadCount();
+  threadPool->setMaxThreadCount(1);
+  QFile::remove(indexPath);
+  const QStringList expected = describe(ApplicationMenuConfig(entryDirs));
+  threadPool->setMaxThreadCount(std::max(4, maxThreadCount));
+  for (int i = 0; i < 3; ++i) {
+    QFile::remove(indexPath);
+    QCOMPARE(describe(ApplicationMenuConfig(entryDirs)), expected);
+  }
+  threadPool->setMaxThreadCount(maxThreadCount);
+
+  // From the index.
+  QCOMPARE(describe(ApplicationMenuConfig(entryDirs)), expected);
+}
+
+void ApplicationMenuConfigTest::loadEntries_index() {
+  QTemporaryDir entryDir;
+  QVERIFY(entryDir.isValid());
+  const QString file = entryDir.path() + "/1.desktop";
+  writeEntry(file, {"Chrome", "Web Browser", "chrome", "chrome", ""},
+             "Network");
+  const QDateTime modified = QFileInfo(file).lastModified();
+  { ApplicationMenuConfig config({ entryDir.path() }); }
+
+  // Same size and modification time: the index is not outdated.
+  writeEntry(file, {"Chromx", "Web Browser", "chrome", "chrome", ""},
+             "Network");
+  setModified(file, modified);
+
+  ApplicationMenuConfig config({ entryDir.path() });
+  const ApplicationEntry* entry = config.findApplication("chrome");
+  QVERIFY(entry != nullptr);
+  QCOMPARE(entry->name, QString("Chrome"));
+  QCOMPARE(entry->genericName, QString("Web Browser"));
+  QCOMPARE(entry->icon, QString("chrome"));
+  QCOMPARE(entry->desktopFile, file);
+}
+
+void ApplicationMenuConfigTest::loadEntries_indexOutdated() {
+  QTemporaryDir entryDir;
+  QVERIFY(entryDir.isValid());
+  const QString file1 = entryDir.path() + "/1.desktop";
+  writeEntry(file1, {"Chrome", "Web Browser", "chrome", "chrome", ""},
+             "Network");
+  const QDateTime modified = QFileInfo(file1).lastModified();
+  { ApplicationMenuConfig config({ entryDir.path() }); }
+
+  // A changed file.
+  writeEntry(file1, {"Chromx", "Web Browser", "chrome", "chrome", ""},
+             "Network");
+  setModified(file1, modified.addSecs(1));
+  // A new file.
+  writeEntry(entryDir.path() + "/2.desktop",
+             {"KMail", "Email Client", "kmail", "kmail", ""}, "Network");
+
+  ApplicationMenuConfig config({ entryDir.path() });
+  const ApplicationEntry* entry = config.findApplication("chrome");
+  QVERIFY(entry != nullptr);
+  QCOMPARE(entry->name, QString("Chromx"));
+  QVERIFY(config.findApplication("kmail") != nullptr);
+
+  // A removed file.
+  QVERIFY(QFile::remove(file1));
+  ApplicationMenuConfig config2({ entryDir.path() });
+  QVERIFY(config2.findApplication("chrome") == nullptr);
+  QVERIFY(config2.findApplication("kmail") != nullptr);
+}
+
+void ApplicationMenuConfigTest::updateEntries() {
+  QTemporaryDir entryDir;
+  QVERIFY(entryDir.isValid());
+  const QString file1 = entryDir.path() + "/1.desktop";
+  const QString file2 = entryDir.path() + "/2.desktop";
+  const QString file3 = entryDir.path() + "/3.desktop";
+  writeEntry(file1, {"Chrome", "Web Browser", "chrome", "chrome", ""},
+             "Network");
+  writeEntry(file2, {"KMail", "Email Client", "kmail", "kmail", ""},
+             "Qt;KDE;Network;Office");
+  writeEntry(file3, {"Konsole", "Terminal", "konsole", "konsole", ""},
+             "System");
+  const QDateTime modified = QFileInfo(file1).lastModified();
+  ApplicationMenuConfig config({ entryDir.path() });
+  std::vector<ApplicationEntryChanges> changesList;
+  connect(&config, &ApplicationMenuConfig::entriesChanged,
+          [&changesList](const ApplicationEntryChanges& changes) {
+            changesList.push_back(changes);
+          });
+
+  // Nothing has changed.
+  config.updateEntries();
+  QVERIFY(changesList.empty());
+
+  // A modified file, a removed file and a new file.
+  writeEntry(file1, {"Chromx", "Web Browser", "chrome", "chrome", ""},
+             "Network");
+  setModified(file1, modified.addSecs(1));
+  QVERIFY(QFile::remove(file2));
+  writeEntry(entryDir.path() + "/4.desktop",
+             {"Dolphin", "File Manager", "dolphin", "dolphin", ""},
+             "System");
+  config.updateEntries();
+
+  QCOMPARE(static_cast<int>(changesList.size()), 1);
+  const auto& changes = changesList[0];
+  using RemovedEntry = std::pair<QString, QString>;
+  QCOMPARE(changes.removedEntries,
+           (std::vector<RemovedEntry>{{"Network", file1},
+                                      {"Network", file2},
+                                      {"Office", file2}}));
+  QCOMPARE(static_cast<int>(changes.addedEntries.size()), 2);
+  QCOMPARE(changes.addedEntries[0].first, QString("Network"));
+  QCOMPARE(changes.addedEntries[0].second.name, QString("Chromx"));
+  QCOMPARE(changes.addedEntries[1].first, QString("System"));
+  QCOMPARE(changes.addedEntries[1].second.name, QString("Dolphin"));
+
+  for (const auto& category : config.categories_) {
+    if (category.name == "Network") {
+      QCOMPARE(static_cast<int>(category.entries.size()), 1);
+    } else if (category.name == "System") {
+      QCOMPARE(static_cast<int>(category.entries.size()), 2);
+      QCOMPARE(category.entries.front().name, QString("Dolphin"));
+    } else {
+      QCOMPARE(static_cast<int>(category.entries.size()), 0);
+    }
+  }
+  const ApplicationEntry* entry = config.findApplication("chrome");
+  QVERIFY(entry != nullptr);
+  QCOMPARE(entry->name, QString("Chromx"));
+  QVERIFY(config.findApplication("kmail") == nullptr);
+  QVERIFY(config.findApplication("konsole") != nullptr);
+  QVERIFY(config.findApplication("dolphin") != nullptr);
+
+  // The index has been updated.
+  ApplicationMenuConfig config2({ entryDir.path() });
+  QCOMPARE(describe(config2), describe(config));
+}
+
+void ApplicationMenuConfigTest::updateEntries_debounce() {
+  QTemporaryDir entryDir;
+  QVERIFY(entryDir.isValid());
+  ApplicationMenuConfig config({ entryDir.path() });
+  int changesCount = 0;
+  connect(&config, &ApplicationMenuConfig::entriesChanged,
+          [&changesCount](const ApplicationEntryChanges&) { ++changesCount; });
+
+  for (int i = 0; i < 10; ++i) {
+    writeEntry(QString("%1/%2.desktop").arg(entryDir.path()).arg(i),
+               {QString("App %1").arg(i), "", "app", QString("app%1").arg(i),
+                ""},
+               "Utility");
+    config.updateTimer_.start();
+  }
+
+  QTRY_COMPARE(changesCount, 1);
+  QTest::qWait(2 * ApplicationMenuConfig::kUpdateDelay);
+  QCOMPARE(changesCount, 1);
+  QVERIFY(config.findApplication("app9") != nullptr);
+}
+
+void ApplicationMenuConfigTest::loadEntries_benchmark_data() {
+  QTest::addColumn<int>("threadCount");
+  QTest::addColumn<bool>("useIndex");
+  const int idealThreadCount = std::max(1, QThread::idealThreadCount());
+  for (int threadCount = 1; threadCount < idealThreadCount; threadCount *= 2) {
+    QTest::newRow(qPrintable(QString("%1 threads").arg(threadCount)))
+        << threadCount << false;
+  }
+  QTest::newRow(qPrintable(QString("%1 threads").arg(idealThreadCount)))
+      << idealThreadCount << false;
+  QTest::newRow("index") << idealThreadCount << true;
+}
+
+void ApplicationMenuConfigTest::loadEntries_benchmark() {
+  QFETCH(int, threadCount);
+  QFETCH(bool, useIndex);
+  QTemporaryDir entryDir;
+  QVERIFY(entryDir.isValid());
+  writeCorpus(entryDir.path(), 5000);
+  const QString indexPath =
+      ConfigHelper::desktopEntryIndexPath({ entryDir.path() });
+  { ApplicationMenuConfig config({ entryDir.path() }); }
+
+  auto* threadPool = QThreadPool::globalInstance();
+  const int maxThreadCount = threadPool->maxThreadCount();
+  threadPool->setMaxThreadCount(threadCount);
+  QBENCHMARK {
+    if (!useIndex) {
+      // Includes saving the index again.
+      QFile::remove(indexPath);
+    }
+    ApplicationMenuConfig config({ entryDir.path() });
+  }
+  threadPool->setMaxThreadCount(maxThreadCount);
+}
+
 }  // namespace ksmoothdock
 
 QTEST_MAIN(ksmoothdock::ApplicationMenuConfigTest)
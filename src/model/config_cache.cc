@@ -0,0 +1,225 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2019 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config_cache.h"
+
+#include <utility>
+
+#include <QDataStream>
+#include <QDir>
+
+#include <KLocalizedString>
+
+#include <utils/binary_file.h>
+
+namespace ksmoothdock {
+
+constexpr quint32 ConfigCache::kMagic;
+constexpr quint32 ConfigCache::kVersion;
+
+namespace {
+
+// Whether all the source files are unchanged since the cache was saved.
+bool readSources(QDataStream& in, int cacheSize) {
+  quint32 count;
+  if (!readCount(in, cacheSize, &count)) {
+    return false;
+  }
+  QString path;
+  qint64 cachedModified, cachedSize;
+  qint64 modified, size;
+  for (quint32 i = 0; i < count; ++i) {
+    in >> path >> cachedModified >> cachedSize;
+    if (in.status() != QDataStream::Ok) {
+      return false;
+    }
+    fileStamp(path, &modified, &size);
+    if (modified != cachedModified || size != cachedSize) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void writeAppearance(QDataStream& out, const AppearanceSettings& settings) {
+  out << static_cast<qint32>(settings.minIconSize)
+      << static_cast<qint32>(settings.maxIconSize)
+      << settings.spacingFactor
+      << settings.backgroundColor
+      << settings.showBorder
+      << settings.borderColor
+      << static_cast<qint32>(settings.tooltipFontSize)
+      << settings.applicationMenuName
+      << settings.applicationMenuIcon
+      << settings.applicationMenuStrut
+      << settings.showDesktopNumber
+      << settings.currentDesktopTasksOnly
+      << settings.currentScreenTasksOnly
+      << static_cast<qint32>(settings.taskEventCoalescingInterval)
+      << settings.use24HourClock
+      << settings.clockFontScaleFactor;
+}
+
+void readAppearance(QDataStream& in, AppearanceSettings* settings) {
+  qint32 minIconSize, maxIconSize, tooltipFontSize, taskEventCoalescingInterval;
+  in >> minIconSize
+     >> maxIconSize
+     >> settings->spacingFactor
+     >> settings->backgroundColor
+     >> settings->showBorder
+     >> settings->borderColor
+     >> tooltipFontSize
+     >> settings->applicationMenuName
+     >> settings->applicationMenuIcon
+     >> settings->applicationMenuStrut
+     >> settings->showDesktopNumber
+     >> settings->currentDesktopTasksOnly
+     >> settings->currentScreenTasksOnly
+     >> taskEventCoalescingInterval
+     >> settings->use24HourClock
+     >> settings->clockFontScaleFactor;
+  settings->minIconSize = minIconSize;
+  settings->maxIconSize = maxIconSize;
+  settings->tooltipFontSize = tooltipFontSize;
+  settings->taskEventCoalescingInterval = taskEventCoalescingInterval;
+}
+
+void writeDock(QDataStream& out, const ConfigCache::Dock& dock) {
+  const auto& settings = dock.settings;
+  out << dock.configPath
+      << dock.launchersPath
+      << static_cast<qint32>(settings.position)
+      << static_cast<qint32>(settings.screen)
+      << static_cast<qint32>(settings.visibility)
+      << settings.autoHide
+      << settings.showApplicationMenu
+      << settings.showPager
+      << settings.showTaskManager
+      << settings.showClock;
+
+  out << static_cast<quint32>(dock.launchers.size());
+  for (const auto& launcher : dock.launchers) {
+    out << launcher.name << launcher.icon << launcher.command
+        << launcher.taskCommand;
+  }
+}
+
+bool readDock(QDataStream& in, int cacheSize, ConfigCache::Dock* dock) {
+  auto& settings = dock->settings;
+  qint32 position, screen, visibility;
+  in >> dock->configPath
+     >> dock->launchersPath
+     >> position
+     >> screen
+     >> visibility
+     >> settings.autoHide
+     >> settings.showApplicationMenu
+     >> settings.showPager
+     >> settings.showTaskManager
+     >> settings.showClock;
+  settings.position = static_cast<PanelPosition>(position);
+  settings.screen = screen;
+  settings.visibility = static_cast<PanelVisibility>(visibility);
+
+  quint32 count;
+  if (!readCount(in, cacheSize, &count)) {
+    return false;
+  }
+  dock->launchers.resize(count);
+  for (auto& launcher : dock->launchers) {
+    in >> launcher.name >> launcher.icon >> launcher.command
+       >> launcher.taskCommand;
+  }
+  return in.status() == QDataStream::Ok;
+}
+
+}  // namespace
+
+/* static */ bool ConfigCache::load(const QString& cachePath,
+                                    AppearanceSettings* appearance,
+                                    std::vector<Dock>* docks) {
+  AppearanceSettings loadedAppearance;
+  std::vector<Dock> loadedDocks;
+  const bool loaded = readBinaryFile(
+      cachePath, [&](QDataStream& in, int cacheSize) {
+        quint32 magic, version;
+        QString defaultApplicationMenuName;
+        in >> magic >> version >> defaultApplicationMenuName;
+        // The settings' defaults depend on the language.
+        if (in.status() != QDataStream::Ok || magic != kMagic ||
+            version != kVersion ||
+            defaultApplicationMenuName != i18n(kDefaultApplicationMenuName) ||
+            !readSources(in, cacheSize)) {
+          return false;
+        }
+
+        readAppearance(in, &loadedAppearance);
+        quint32 count;
+        if (!readCount(in, cacheSize, &count)) {
+          return false;
+        }
+        for (quint32 i = 0; i < count; ++i) {
+          loadedDocks.emplace_back();
+          if (!readDock(in, cacheSize, &loadedDocks.back())) {
+            return false;
+          }
+        }
+        return true;
+      });
+
+  if (!loaded) {
+    return false;
+  }
+  *appearance = loadedAppearance;
+  *docks = std::move(loadedDocks);
+  return true;
+}
+
+/* static */ bool ConfigCache::save(const QString& cachePath,
+                                    const QStringList& sources,
+                                    const AppearanceSettings& appearance,
+                                    const std::vector<Dock>& docks) {
+  QStringList files = sources;
+  for (const auto& dock : docks) {
+    files.append(dock.configPath);
+    files.append(dock.launchersPath);
+    QDir launchersDir(dock.launchersPath);
+    for (const auto& file : launchersDir.entryList(QDir::Files, QDir::Name)) {
+      files.append(dock.launchersPath + "/" + file);
+    }
+  }
+
+  return writeBinaryFile(cachePath, [&](QDataStream& out) {
+    out << kMagic << kVersion << i18n(kDefaultApplicationMenuName);
+
+    out << static_cast<quint32>(files.size());
+    qint64 modified, size;
+    for (const auto& path : files) {
+      fileStamp(path, &modified, &size);
+      out << path << modified << size;
+    }
+
+    writeAppearance(out, appearance);
+    out << static_cast<quint32>(docks.size());
+    for (const auto& dock : docks) {
+      writeDock(out, dock);
+    }
+  });
+}
+
+}  // namespace ksmoothdock
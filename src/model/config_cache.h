@@ -0,0 +1,67 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2019 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KSMOOTHDOCK_CONFIG_CACHE_H_
+#define KSMOOTHDOCK_CONFIG_CACHE_H_
+
+#include <vector>
+
+#include <QString>
+#include <QStringList>
+
+#include "multi_dock_model.h"
+
+namespace ksmoothdock {
+
+// Compact binary cache of all the docks' configs: the appearance settings,
+// the dock settings and the launchers with their resolved task commands.
+//
+// The KConfig and desktop files remain the source of truth. The cache
+// records the modification times and sizes of the files that it has been
+// generated from, and is only used if none of them has changed. Loading it
+// is a single read of a memory-mapped file, instead of parsing every config
+// and launcher file.
+class ConfigCache {
+ public:
+  struct Dock {
+    QString configPath;
+    QString launchersPath;
+    DockSettings settings;
+    std::vector<LauncherConfig> launchers;
+  };
+
+  // Loads the cache. Returns false if there is no cache, if it is invalid or
+  // of another version, or if any of its source files has changed.
+  static bool load(const QString& cachePath, AppearanceSettings* appearance,
+                   std::vector<Dock>* docks);
+
+  // Saves the cache atomically. The sources are the files and directories
+  // that the cache depends on besides the docks' config files and launchers
+  // directories, which are always included with the launcher files.
+  static bool save(const QString& cachePath, const QStringList& sources,
+                   const AppearanceSettings& appearance,
+                   const std::vector<Dock>& docks);
+
+ private:
+  static constexpr quint32 kMagic = 0x55444343;  // "UDCC"
+  static constexpr quint32 kVersion = 1;
+};
+
+}  // namespace ksmoothdock
+
+#endif  // KSMOOTHDOCK_CONFIG_CACHE_H_
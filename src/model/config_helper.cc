@@ -18,8 +18,12 @@
 
 #include "config_helper.h"
 
+#include <QCryptographicHash>
 #include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
 #include <QStringList>
+#include <QTextStream>
 
 namespace ksmoothdock {
 
@@ -30,6 +34,8 @@ constexpr char ConfigHelper::kSingleDockLaunchers[];
 constexpr char ConfigHelper::kConfigPattern[];
 constexpr char ConfigHelper::kAppearanceConfig[];
 constexpr char ConfigHelper::kIconOverrideRules[];
+constexpr char ConfigHelper::kLaunchersIndex[];
+constexpr char ConfigHelper::kConfigCacheDir[];
 
 ConfigHelper::ConfigHelper(const QString& configDir)
     : configDir_{configDir} {
@@ -38,6 +44,25 @@ ConfigHelper::ConfigHelper(const QString& configDir)
   }
 }
 
+QString ConfigHelper::configCachePath() const {
+  // One cache per config dir.
+  const QByteArray hash = QCryptographicHash::hash(
+      configDir_.absolutePath().toUtf8(), QCryptographicHash::Sha1);
+  return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) +
+      "/" + kConfigCacheDir + "/config_" +
+      QString::fromLatin1(hash.toHex().left(16)) + ".cache";
+}
+
+/* static */ QString ConfigHelper::desktopEntryIndexPath(
+    const QStringList& entryDirs) {
+  // One index per set of entry dirs.
+  const QByteArray hash = QCryptographicHash::hash(
+      entryDirs.join('\n').toUtf8(), QCryptographicHash::Sha1);
+  return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) +
+      "/" + kConfigCacheDir + "/desktop_entries_" +
+      QString::fromLatin1(hash.toHex().left(16)) + ".index";
+}
+
 std::vector<std::tuple<QString, QString>> ConfigHelper::findAllDockConfigs()
     const {
   std::vector<std::tuple<QString, QString>> allConfigs;
@@ -75,6 +100,8 @@ void ConfigHelper::copyLaunchersDir(const QString& launchersDir,
     const auto destFile = newLaunchersDir + "/" + files.at(i);
     QFile::copy(srcFile, destFile);
   }
+  QFile::copy(launchersDir + "/" + kLaunchersIndex,
+              newLaunchersDir + "/" + kLaunchersIndex);
 }
 
 void ConfigHelper::removeLaunchersDir(const QString& launchersDir) {
@@ -84,7 +111,43 @@ void ConfigHelper::removeLaunchersDir(const QString& launchersDir) {
     const auto launcherFile = launchersDir + "/" + files.at(i);
     QFile::remove(launcherFile);
   }
+  QFile::remove(launchersDir + "/" + kLaunchersIndex);
   QDir::root().rmdir(launchersDir);
 }
 
+QStringList ConfigHelper::readLaunchersIndex(const QString& launchersDir) {
+  QStringList files;
+  QFile index(launchersDir + "/" + kLaunchersIndex);
+  if (!index.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    return files;
+  }
+
+  QTextStream in(&index);
+  in.setCodec("UTF-8");
+  while (!in.atEnd()) {
+    const QString file = in.readLine().trimmed();
+    if (!file.isEmpty()) {
+      files.append(file);
+    }
+  }
+  return files;
+}
+
+bool ConfigHelper::writeLaunchersIndex(const QString& launchersDir,
+                                       const QStringList& files) {
+  // QSaveFile writes to a temporary file then renames it on commit().
+  QSaveFile index(launchersDir + "/" + kLaunchersIndex);
+  if (!index.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    return false;
+  }
+
+  QTextStream out(&index);
+  out.setCodec("UTF-8");
+  for (const auto& file : files) {
+    out << file << "\n";
+  }
+  out.flush();
+  return index.commit();
+}
+
 }  // namespace ksmoothdock
@@ -23,6 +23,8 @@
 #include <vector>
 
 #include <QDir>
+#include <QString>
+#include <QStringList>
 
 namespace ksmoothdock {
 
@@ -45,9 +47,17 @@ class ConfigHelper  {
   // Global icon override rules (for task manager).
   static constexpr char kIconOverrideRules[] = "icon_override.rules";
 
+  // Launcher order in a launchers directory, one launcher file name per line.
+  static constexpr char kLaunchersIndex[] = "launchers.index";
+
+  // Directory of the binary config caches, in the user's cache directory.
+  static constexpr char kConfigCacheDir[] = "unicorndock";
+
   explicit ConfigHelper(const QString& configDir);
   ~ConfigHelper() = default;
 
+  QString configDirPath() const { return configDir_.path(); }
+
   // Gets the appearance config file path.
   QString appearanceConfigPath() const {
     return configDir_.filePath(kAppearanceConfig);
@@ -58,6 +68,14 @@ class ConfigHelper  {
     return configDir_.filePath(kIconOverrideRules);
   }
 
+  // Gets the binary config cache file path. It is outside of the config dir,
+  // so that writing it doesn't change the config dir's modification time.
+  QString configCachePath() const;
+
+  // Gets the desktop entry index file path for the application entry dirs,
+  // in the same directory as the config caches.
+  static QString desktopEntryIndexPath(const QStringList& entryDirs);
+
   static QString wallpaperConfigKey(int desktop, int screen) {
     // Screen is 0-based.
     return QString("wallpaper") + QString::number(desktop) +
@@ -78,6 +96,15 @@ class ConfigHelper  {
   // Removes a launchers directory.
   static void removeLaunchersDir(const QString& launchersDir);
 
+  // Reads the launcher file names of a launchers directory, in order.
+  // Returns an empty list if there is no index.
+  static QStringList readLaunchersIndex(const QString& launchersDir);
+
+  // Writes the launcher file names of a launchers directory atomically, so
+  // that the index is either the old or the new one, even after a crash.
+  static bool writeLaunchersIndex(const QString& launchersDir,
+                                  const QStringList& files);
+
   // For conversion from old single-dock config to the new multi-dock config.
 
   // Whether this is a old version of KSmoothDock using single-dock config.
@@ -0,0 +1,97 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2019 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config_writer.h"
+
+#include <algorithm>
+
+namespace ksmoothdock {
+
+ConfigWriter::ConfigWriter(int debounceInterval)
+    : debounceInterval_(debounceInterval),
+      thread_(&ConfigWriter::run, this) {}
+
+ConfigWriter::~ConfigWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wakeUp_.notify_one();
+  thread_.join();
+}
+
+void ConfigWriter::write(const QString& key, std::function<void()> writeFunc) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find_if(pending_.begin(), pending_.end(),
+                           [&key](const auto& write) { return write.first == key; });
+    if (it != pending_.end()) {
+      it->second = std::move(writeFunc);
+      return;
+    }
+
+    if (pending_.empty()) {
+      deadline_ = std::chrono::steady_clock::now() + debounceInterval_;
+    }
+    pending_.emplace_back(key, std::move(writeFunc));
+  }
+  wakeUp_.notify_one();
+}
+
+void ConfigWriter::flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  flushRequested_ = true;
+  wakeUp_.notify_one();
+  flushed_.wait(lock, [this]() { return pending_.empty() && !writing_; });
+  flushRequested_ = false;
+}
+
+void ConfigWriter::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    if (pending_.empty()) {
+      if (stop_) {
+        return;
+      }
+      wakeUp_.wait(lock);
+      continue;
+    }
+
+    if (!stop_ && !flushRequested_ &&
+        std::chrono::steady_clock::now() < deadline_) {
+      wakeUp_.wait_until(lock, deadline_);
+      continue;
+    }
+
+    auto writes = std::move(pending_);
+    pending_.clear();
+    writing_ = true;
+    lock.unlock();
+    for (const auto& write : writes) {
+      write.second();
+    }
+    lock.lock();
+    writing_ = false;
+    writeCount_ += static_cast<int>(writes.size());
+    if (pending_.empty()) {
+      flushed_.notify_all();
+    }
+  }
+}
+
+}  // namespace ksmoothdock
@@ -0,0 +1,90 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2019 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KSMOOTHDOCK_CONFIG_WRITER_H_
+#define KSMOOTHDOCK_CONFIG_WRITER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <QString>
+
+namespace ksmoothdock {
+
+constexpr int kDefaultConfigWriteDebounceInterval = 500;  // msecs
+
+// Writes config files on a background thread, so that disk I/O never blocks
+// the GUI thread.
+//
+// Each write is a self-contained function that works on an immutable
+// snapshot of the config, queued with a key (usually the file path). Writes
+// are applied together once the debounce interval since the first queued one
+// has passed, and a newer write with the same key replaces the pending one.
+class ConfigWriter {
+ public:
+  explicit ConfigWriter(
+      int debounceInterval = kDefaultConfigWriteDebounceInterval);
+  // Applies the pending writes then stops the thread.
+  ~ConfigWriter();
+
+  ConfigWriter(const ConfigWriter&) = delete;
+  ConfigWriter& operator=(const ConfigWriter&) = delete;
+
+  // Queues a write. It must not refer to any data owned by the caller.
+  void write(const QString& key, std::function<void()> writeFunc);
+
+  // Applies the pending writes now and waits until they are done.
+  void flush();
+
+  // The number of writes applied so far.
+  int writeCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return writeCount_;
+  }
+
+ private:
+  void run();
+
+  const std::chrono::milliseconds debounceInterval_;
+
+  mutable std::mutex mutex_;
+  // Signals the worker thread about new writes, flush and stop.
+  std::condition_variable wakeUp_;
+  // Signals flush() that the pending writes are done.
+  std::condition_variable flushed_;
+
+  // Pending writes in order of first arrival.
+  std::vector<std::pair<QString, std::function<void()>>> pending_;
+  std::chrono::steady_clock::time_point deadline_;
+  bool writing_ = false;
+  bool flushRequested_ = false;
+  bool stop_ = false;
+  int writeCount_ = 0;
+
+  // Declared last so that it starts after the other members are initialized.
+  std::thread thread_;
+};
+
+}  // namespace ksmoothdock
+
+#endif  // KSMOOTHDOCK_CONFIG_WRITER_H_
@@ -0,0 +1,98 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2019 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config_writer.h"
+
+#include <atomic>
+#include <memory>
+
+#include <QtTest>
+
+namespace ksmoothdock {
+
+class ConfigWriterTest: public QObject {
+  Q_OBJECT
+
+ private slots:
+  // Tests that writes with the same key are coalesced into the last one.
+  void write_coalesced();
+
+  // Tests that writes with different keys are all applied, in order.
+  void write_differentKeys();
+
+  // Tests that nothing is written before the debounce interval has passed.
+  void write_debounced();
+
+  // Tests that the destructor applies the pending writes.
+  void destructor_flushes();
+};
+
+void ConfigWriterTest::write_coalesced() {
+  ConfigWriter writer(/*debounceInterval=*/ 100);
+  auto value = std::make_shared<std::atomic<int>>(0);
+  auto calls = std::make_shared<std::atomic<int>>(0);
+  for (int i = 1; i <= 10; ++i) {
+    writer.write("file", [value, calls, i]() { *value = i; ++*calls; });
+  }
+  writer.flush();
+  QCOMPARE(value->load(), 10);
+  QCOMPARE(calls->load(), 1);
+  QCOMPARE(writer.writeCount(), 1);
+}
+
+void ConfigWriterTest::write_differentKeys() {
+  ConfigWriter writer(/*debounceInterval=*/ 100);
+  auto order = std::make_shared<QStringList>();
+  // Only the worker thread touches the list until flush() returns.
+  writer.write("a", [order]() { order->append("a"); });
+  writer.write("b", [order]() { order->append("b"); });
+  writer.write("a", [order]() { order->append("a2"); });
+  writer.write("c", [order]() { order->append("c"); });
+  writer.flush();
+  QCOMPARE(*order, QStringList({"a2", "b", "c"}));
+  QCOMPARE(writer.writeCount(), 3);
+
+  // Nothing pending.
+  writer.flush();
+  QCOMPARE(writer.writeCount(), 3);
+}
+
+void ConfigWriterTest::write_debounced() {
+  ConfigWriter writer(/*debounceInterval=*/ 200);
+  auto calls = std::make_shared<std::atomic<int>>(0);
+  writer.write("file", [calls]() { ++*calls; });
+  QTest::qWait(50);
+  QCOMPARE(calls->load(), 0);
+  QTRY_COMPARE_WITH_TIMEOUT(calls->load(), 1, 5000);
+  QCOMPARE(writer.writeCount(), 1);
+}
+
+void ConfigWriterTest::destructor_flushes() {
+  auto calls = std::make_shared<std::atomic<int>>(0);
+  {
+    ConfigWriter writer(/*debounceInterval=*/ 60000);
+    writer.write("a", [calls]() { ++*calls; });
+    writer.write("b", [calls]() { ++*calls; });
+  }
+  QCOMPARE(calls->load(), 2);
+}
+
+}  // namespace ksmoothdock
+
+QTEST_MAIN(ksmoothdock::ConfigWriterTest)
+#include "config_writer_test.moc"
@@ -0,0 +1,119 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2019 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "desktop_entry_index.h"
+
+#include <utility>
+
+#include <QDataStream>
+
+#include <utils/binary_file.h>
+#include <utils/desktop_file_parser.h>
+
+namespace ksmoothdock {
+
+constexpr quint32 DesktopEntryIndex::kMagic;
+constexpr quint32 DesktopEntryIndex::kVersion;
+
+namespace {
+
+void writeFile(QDataStream& out, const DesktopEntryIndex::File& file) {
+  out << file.path << file.modified << file.size;
+  const auto& entry = file.desktopEntry.entry;
+  out << entry.has_value();
+  if (entry) {
+    out << entry->name << entry->genericName << entry->icon << entry->command
+        << entry->taskCommand << file.desktopEntry.categories;
+  }
+}
+
+bool readFile(QDataStream& in, DesktopEntryIndex::File* file) {
+  bool hasEntry = false;
+  in >> file->path >> file->modified >> file->size >> hasEntry;
+  if (hasEntry) {
+    QString name, genericName, icon, command, taskCommand;
+    in >> name >> genericName >> icon >> command >> taskCommand
+       >> file->desktopEntry.categories;
+    file->desktopEntry.entry.emplace(name, genericName, icon, command,
+                                     taskCommand, file->path);
+  }
+  return in.status() == QDataStream::Ok;
+}
+
+}  // namespace
+
+/* static */ bool DesktopEntryIndex::load(const QString& indexPath,
+                                          std::vector<Dir>* dirs) {
+  std::vector<Dir> loadedDirs;
+  const bool loaded = readBinaryFile(
+      indexPath, [&](QDataStream& in, int indexSize) {
+        quint32 magic, version;
+        QString locale;
+        in >> magic >> version >> locale;
+        // The names are localized.
+        if (in.status() != QDataStream::Ok || magic != kMagic ||
+            version != kVersion ||
+            locale != DesktopFileParser::defaultLocale()) {
+          return false;
+        }
+
+        quint32 dirCount;
+        if (!readCount(in, indexSize, &dirCount)) {
+          return false;
+        }
+        for (quint32 i = 0; i < dirCount; ++i) {
+          loadedDirs.emplace_back();
+          Dir& dir = loadedDirs.back();
+          quint32 fileCount;
+          in >> dir.path >> dir.modified;
+          if (!readCount(in, indexSize, &fileCount)) {
+            return false;
+          }
+          for (quint32 j = 0; j < fileCount; ++j) {
+            dir.files.emplace_back();
+            if (!readFile(in, &dir.files.back())) {
+              return false;
+            }
+          }
+        }
+        return true;
+      });
+
+  if (!loaded) {
+    return false;
+  }
+  *dirs = std::move(loadedDirs);
+  return true;
+}
+
+/* static */ bool DesktopEntryIndex::save(const QString& indexPath,
+                                          const std::vector<Dir>& dirs) {
+  return writeBinaryFile(indexPath, [&](QDataStream& out) {
+    out << kMagic << kVersion << DesktopFileParser::defaultLocale();
+
+    out << static_cast<quint32>(dirs.size());
+    for (const auto& dir : dirs) {
+      out << dir.path << dir.modified << static_cast<quint32>(dir.files.size());
+      for (const auto& indexedFile : dir.files) {
+        writeFile(out, indexedFile);
+      }
+    }
+  });
+}
+
+}  // namespace ksmoothdock
@@ -0,0 +1,68 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2019 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KSMOOTHDOCK_DESKTOP_ENTRY_INDEX_H_
+#define KSMOOTHDOCK_DESKTOP_ENTRY_INDEX_H_
+
+#include <vector>
+
+#include <QString>
+
+#include "application_entry.h"
+
+namespace ksmoothdock {
+
+// Binary index of the parsed desktop files of the application entry dirs.
+//
+// The desktop files remain the source of truth. The index records the
+// modification time and size of every entry dir and desktop file, so that
+// only the new or changed files need to be parsed again.
+class DesktopEntryIndex {
+ public:
+  // A parsed desktop file.
+  struct File {
+    QString path;
+    qint64 modified = -1;
+    qint64 size = -1;
+    DesktopEntry desktopEntry;
+  };
+
+  // An entry dir with its desktop files, in the order of the file names.
+  struct Dir {
+    QString path;
+    qint64 modified = -1;
+    std::vector<File> files;
+  };
+
+  // Loads the index. Returns false if there is no index, if it is invalid or
+  // of another version, or if it has been saved for another locale.
+  static bool load(const QString& indexPath, std::vector<Dir>* dirs);
+
+  // Saves the index atomically.
+  static bool save(const QString& indexPath, const std::vector<Dir>& dirs);
+
+ private:
+  static constexpr quint32 kMagic = 0x55444549;  // "UDEI"
+  // Version 2: desktop files parsed by DesktopFileParser.
+  // Version 3: with the KConfig options and the locale modifiers.
+  static constexpr quint32 kVersion = 3;
+};
+
+}  // namespace ksmoothdock
+
+#endif  // KSMOOTHDOCK_DESKTOP_ENTRY_INDEX_H_
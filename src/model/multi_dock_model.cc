@@ -18,12 +18,19 @@
 
 #include "multi_dock_model.h"
 
+#include <algorithm>
 #include <iostream>
 
-#include <KDesktopFile>
+#include <QCryptographicHash>
+#include <QSet>
+#include <QSettings>
+
 #include <KWindowSystem>
 
+#include "config_cache.h"
+#include <utils/binary_file.h>
 #include <utils/command_utils.h>
+#include <utils/desktop_file_parser.h>
 
 namespace ksmoothdock {
 
@@ -54,17 +61,20 @@ constexpr char MultiDockModel::kShowDesktopNumber[];
 constexpr char MultiDockModel::kTaskManagerCategory[];
 constexpr char MultiDockModel::kCurrentDesktopTasksOnly[];
 constexpr char MultiDockModel::kCurrentScreenTasksOnly[];
+constexpr char MultiDockModel::kTaskEventCoalescingInterval[];
 constexpr char MultiDockModel::kClockCategory[];
 constexpr char MultiDockModel::kUse24HourClock[];
 constexpr char MultiDockModel::kFontScaleFactor[];
+constexpr int MultiDockModel::kConfigReloadDelay;
 
 LauncherConfig::LauncherConfig(const QString& desktopFile) {
-  KDesktopFile file(desktopFile);
-  name = file.readName();
-  icon = file.readIcon();
+  DesktopFileEntry entry;
+  DesktopFileParser().parse(desktopFile, &entry);
+  name = entry.name;
+  icon = entry.icon;
   std::cout << "Reading from  " << icon.toStdString() << "\n";
   std::cout << "\t with name " << name.toStdString() << "\n";
-  command = filterFieldCodes(file.entryMap("Desktop Entry")["Exec"]);
+  command = filterFieldCodes(entry.exec);
   taskCommand = getTaskCommand(command);
 }
 
@@ -79,16 +89,67 @@ void LauncherConfig::saveToFile(const QString &filePath) const {
   config.sync();
 }
 
+QString LauncherConfig::fileName() const {
+  const QByteArray contents = (name + "\n" + icon + "\n" + command).toUtf8();
+  const QByteArray hash = QCryptographicHash::hash(contents, QCryptographicHash::Sha1);
+  return QString::fromLatin1(hash.toHex().left(16)) + ".desktop";
+}
+
 MultiDockModel::MultiDockModel(const QString& configDir)
     : configHelper_(configDir),
-      appearanceConfig_(configHelper_.appearanceConfigPath(),
-                        KConfig::SimpleConfig) {
-  if (convertConfig()) {
-    appearanceConfig_.reparseConfiguration();
+      overrideConfig_(QSettings().fileName(), configHelper_.iconOverrideRulesPath()) {
+  convertConfig();
+  if (!loadConfigCache()) {
+    loadAppearanceSettings();
+    loadDocks();
+    saveConfigCache();
   }
-  loadDocks();
+  notifiedAppearanceSettings_ = appearanceSettings_;
   connect(&applicationMenuConfig_, SIGNAL(configChanged()),
           this, SIGNAL(applicationMenuConfigChanged()));
+  connect(&applicationMenuConfig_, &ApplicationMenuConfig::entriesChanged,
+          this, &MultiDockModel::applicationMenuEntriesChanged);
+
+  for (const auto& path : configPaths()) {
+    recordConfigStamp(configStamps_.get(), path);
+  }
+  watchConfigs();
+  configReloadTimer_.setSingleShot(true);
+  configReloadTimer_.setInterval(kConfigReloadDelay);
+  connect(&configReloadTimer_, SIGNAL(timeout()),
+          this, SLOT(reloadChangedConfigs()));
+  connect(&configWatcher_, SIGNAL(directoryChanged(const QString&)),
+          &configReloadTimer_, SLOT(start()));
+  connect(&configWatcher_, SIGNAL(fileChanged(const QString&)),
+          &configReloadTimer_, SLOT(start()));
+}
+
+MultiDockModel::~MultiDockModel() {
+  flushConfig();
+  if (configCacheOutdated_) {
+    // Saved after the config files, so that it records their final state and
+    // not a preview.
+    loadAppearanceSettings();
+    saveConfigCache();
+    flushConfig();
+  }
+}
+
+KConfig* MultiDockModel::appearanceConfig() const {
+  if (!appearanceConfig_) {
+    appearanceConfig_ = std::make_unique<KConfig>(
+        configHelper_.appearanceConfigPath(), KConfig::SimpleConfig);
+  }
+  return appearanceConfig_.get();
+}
+
+KConfig* MultiDockModel::dockConfig(int dockId) {
+  auto& dock = dockConfigs_[dockId];
+  if (!std::get<1>(dock)) {
+    std::get<1>(dock) = std::make_unique<KConfig>(std::get<0>(dock),
+                                                  KConfig::SimpleConfig);
+  }
+  return std::get<1>(dock).get();
 }
 
 void MultiDockModel::loadDocks() {
@@ -100,17 +161,151 @@ void MultiDockModel::loadDocks() {
     const auto& launchersPath = std::get<1>(configs);
     dockConfigs_[dockId] = std::make_tuple(
         configPath,
-        std::make_unique<KConfig>(configPath, KConfig::SimpleConfig),
+        std::unique_ptr<KConfig>(),
         launchersPath,
-        loadDockLaunchers(launchersPath));
+        loadDockLaunchers(launchersPath),
+        ++lastLaunchersGeneration_);
+    loadDockSettings(dockId);
     ++dockId;
   }
   nextDockId_ = dockId;
 }
 
+bool MultiDockModel::loadConfigCache() {
+  AppearanceSettings appearanceSettings;
+  std::vector<ConfigCache::Dock> docks;
+  if (!ConfigCache::load(configHelper_.configCachePath(), &appearanceSettings,
+                         &docks)) {
+    return false;
+  }
+
+  appearanceSettings_ = appearanceSettings;
+  // Dock ID starts from 1.
+  int dockId = 1;
+  dockConfigs_.clear();
+  dockSettings_.clear();
+  for (auto& dock : docks) {
+    dockConfigs_[dockId] = std::make_tuple(
+        dock.configPath,
+        std::unique_ptr<KConfig>(),
+        dock.launchersPath,
+        std::move(dock.launchers),
+        ++lastLaunchersGeneration_);
+    dockSettings_[dockId] = dock.settings;
+    ++dockId;
+  }
+  nextDockId_ = dockId;
+  ++settingsVersion_;
+  return true;
+}
+
+void MultiDockModel::saveConfigCache() {
+  std::vector<ConfigCache::Dock> docks;
+  docks.reserve(dockConfigs_.size());
+  for (const auto& dock : dockConfigs_) {
+    docks.push_back({std::get<0>(dock.second), std::get<2>(dock.second),
+                     dockSettings_[dock.first], std::get<3>(dock.second)});
+  }
+  // In the same order as loadDocks().
+  std::sort(docks.begin(), docks.end(),
+            [](const ConfigCache::Dock& dock1, const ConfigCache::Dock& dock2) {
+              return dock1.configPath < dock2.configPath;
+            });
+
+  const QString cachePath = configHelper_.configCachePath();
+  // The config dir, for docks added outside of the model.
+  const QStringList sources = {configHelper_.appearanceConfigPath(),
+                               configHelper_.configDirPath()};
+  const AppearanceSettings appearanceSettings = appearanceSettings_;
+  configWriter_.write(cachePath, [cachePath, sources, appearanceSettings, docks]() {
+    if (!ConfigCache::save(cachePath, sources, appearanceSettings, docks)) {
+      std::cerr << "Failed to save the config cache to "
+                << cachePath.toStdString() << std::endl;
+    }
+  });
+  configCacheOutdated_ = false;
+}
+
+void MultiDockModel::reloadSettings() {
+  configWriter_.flush();
+  appearanceConfig()->reparseConfiguration();
+  loadAppearanceSettings();
+  for (auto& dock : dockConfigs_) {
+    dockConfig(dock.first)->reparseConfiguration();
+    loadDockSettings(dock.first);
+  }
+  configCacheOutdated_ = true;
+}
+
+void MultiDockModel::reloadChangedConfigs() {
+  if (inTransaction()) {
+    // Re-parsing would sync the deferred changes.
+    configReloadTimer_.start();
+    return;
+  }
+
+  // The model's own writes record their stamps once done.
+  configWriter_.flush();
+  watchConfigs();
+  bool changed = false;
+  for (const auto& path : configPaths()) {
+    changed |= recordConfigStamp(configStamps_.get(), path);
+  }
+  if (!changed) {
+    return;
+  }
+
+  const auto oldDockSettings = dockSettings_;
+  reloadSettings();
+  notifyAppearanceChanges();
+  if (dockSettings_ != oldDockSettings) {
+    emit appearanceChanged();
+  }
+}
+
+/* static */ bool MultiDockModel::recordConfigStamp(ConfigStamps* configStamps,
+                                                    const QString& path) {
+  qint64 modified, size;
+  fileStamp(path, &modified, &size);
+  const auto stamp = std::make_pair(modified, size);
+  std::lock_guard<std::mutex> lock(configStamps->mutex);
+  auto it = configStamps->stamps.find(path);
+  if (it != configStamps->stamps.end() && it.value() == stamp) {
+    return false;
+  }
+  configStamps->stamps[path] = stamp;
+  return true;
+}
+
+QStringList MultiDockModel::configPaths() const {
+  QStringList paths = {configHelper_.appearanceConfigPath()};
+  for (const auto& dock : dockConfigs_) {
+    paths.append(std::get<0>(dock.second));
+  }
+  return paths;
+}
+
+void MultiDockModel::watchConfigs() {
+  // The dir tells when a file whose watch has ended is replaced again.
+  QStringList paths = configPaths();
+  paths.append(configHelper_.configDirPath());
+  const QStringList watched =
+      configWatcher_.files() + configWatcher_.directories();
+  QStringList newPaths;
+  for (const auto& path : paths) {
+    if (!watched.contains(path) && QFile::exists(path)) {
+      newPaths.append(path);
+    }
+  }
+  if (!newPaths.isEmpty()) {
+    configWatcher_.addPaths(newPaths);
+  }
+}
+
 void MultiDockModel::addDock(PanelPosition position, int screen,
                              bool showApplicationMenu, bool showPager,
                              bool showTaskManager, bool showClock) {
+  beginTransaction();
   auto configs = configHelper_.findNextDockConfigs();
   auto dockId = addDock(configs, position, screen);
   setVisibility(dockId, kDefaultVisibility);
@@ -118,7 +313,7 @@ void MultiDockModel::addDock(PanelPosition position, int screen,
   setShowPager(dockId, showPager);
   setShowTaskManager(dockId, showTaskManager);
   setShowClock(dockId, showClock);
-  emit dockAdded(dockId);
+  pendingChanges_.addedDocks.push_back(dockId);
 
   if (dockCount() == 1) {
     setMinIconSize(kDefaultMinSize);
@@ -140,6 +335,7 @@ void MultiDockModel::addDock(PanelPosition position, int screen,
   }
   syncDockConfig(dockId);
   syncDockLaunchersConfig(dockId);
+  commit();
 }
 
 int MultiDockModel::addDock(const std::tuple<QString, QString>& configs,
@@ -150,9 +346,12 @@ int MultiDockModel::addDock(const std::tuple<QString, QString>& configs,
   const auto& launchersPath = std::get<1>(configs);
   dockConfigs_[dockId] = std::make_tuple(
       configPath,
-      std::make_unique<KConfig>(configPath, KConfig::SimpleConfig),
+      std::unique_ptr<KConfig>(),
       launchersPath,
-      loadDockLaunchers(launchersPath));
+      loadDockLaunchers(launchersPath),
+      ++lastLaunchersGeneration_);
+  // A cloned dock starts with the settings of its source.
+  loadDockSettings(dockId);
   setPanelPosition(dockId, position);
   setScreen(dockId, screen);
 
@@ -163,22 +362,80 @@ void MultiDockModel::cloneDock(int srcDockId, PanelPosition position,
                                int screen) {
   auto configs = configHelper_.findNextDockConfigs();
 
-  // Clone the dock config and launchers.
+  // Clone the dock config and launchers, including the changes that an outer
+  // transaction has deferred.
+  if (pendingChanges_.dockConfigs.erase(srcDockId) > 0) {
+    writeConfig(dockConfigPath(srcDockId), dockConfig(srcDockId));
+  }
+  if (pendingChanges_.dockLaunchersConfigs.erase(srcDockId) > 0) {
+    writeDockLaunchersConfig(srcDockId);
+  }
+  configWriter_.flush();
   QFile::copy(dockConfigPath(srcDockId), std::get<0>(configs));
   ConfigHelper::copyLaunchersDir(dockLaunchersPath(srcDockId),
                                  std::get<1>(configs));
 
+  beginTransaction();
   auto dockId = addDock(configs, position, screen);
-  emit dockAdded(dockId);
+  pendingChanges_.addedDocks.push_back(dockId);
 
   syncDockConfig(dockId);
   syncDockLaunchersConfig(dockId);
+  commit();
+}
+
+void MultiDockModel::commit() {
+  if (!inTransaction() || --transactionDepth_ > 0) {
+    return;
+  }
+
+  // Slots may start new transactions.
+  PendingChanges changes;
+  std::swap(changes, pendingChanges_);
+
+  if (changes.appearanceConfig) {
+    syncAppearanceConfig();
+  }
+  for (const int dockId : changes.dockConfigs) {
+    syncDockConfig(dockId);
+  }
+  for (const int dockId : changes.dockLaunchersConfigs) {
+    syncDockLaunchersConfig(dockId);
+  }
+
+  for (const int dockId : changes.addedDocks) {
+    emit dockAdded(dockId);
+  }
+  if (changes.appearanceNotification) {
+    notifyAppearanceChanges();
+  }
+  for (const int dockId : changes.changedDockLaunchers) {
+    // New docks are created with their launchers.
+    if (std::find(changes.addedDocks.begin(), changes.addedDocks.end(),
+                  dockId) == changes.addedDocks.end()) {
+      emit dockLaunchersChanged(dockId);
+    }
+  }
+  for (const int screen : changes.wallpaperScreens) {
+    emit wallpaperChanged(screen);
+  }
 }
 
 void MultiDockModel::removeDock(int dockId) {
+  // So that no pending write re-creates the files.
+  configWriter_.flush();
   QFile::remove(dockConfigPath(dockId));
   ConfigHelper::removeLaunchersDir(dockLaunchersPath(dockId));
+  configCacheOutdated_ = true;
   dockConfigs_.erase(dockId);
+  dockSettings_.erase(dockId);
+  pendingChanges_.dockConfigs.erase(dockId);
+  pendingChanges_.dockLaunchersConfigs.erase(dockId);
+  auto& addedDocks = pendingChanges_.addedDocks;
+  addedDocks.erase(std::remove(addedDocks.begin(), addedDocks.end(), dockId),
+                   addedDocks.end());
+  pendingChanges_.changedDockLaunchers.erase(dockId);
+  ++settingsVersion_;
   // No need to emit a signal here.
 }
 
@@ -191,29 +448,229 @@ bool MultiDockModel::hasPager() const {
   return false;
 }
 
+void MultiDockModel::previewAppearanceSettings(
+    const AppearanceSettings& settings) {
+  appearanceSettings_ = settings;
+  ++settingsVersion_;
+  notifyAppearanceChanges();
+}
+
+void MultiDockModel::cancelAppearancePreview() {
+  // The preview has only changed the snapshot.
+  loadAppearanceSettings();
+  notifyAppearanceChanges();
+}
+
+void MultiDockModel::notifyAppearanceChanges() {
+  const AppearanceSettings old = notifiedAppearanceSettings_;
+  const AppearanceSettings& current = appearanceSettings_;
+  const bool wallpapers = wallpapersChanged_;
+  notifiedAppearanceSettings_ = current;
+  wallpapersChanged_ = false;
+
+  // The task filters change which items a dock has.
+  if (current.currentDesktopTasksOnly != old.currentDesktopTasksOnly ||
+      current.currentScreenTasksOnly != old.currentScreenTasksOnly) {
+    emit appearanceChanged();
+    return;
+  }
+
+  if (current.minIconSize != old.minIconSize ||
+      current.maxIconSize != old.maxIconSize ||
+      current.spacingFactor != old.spacingFactor) {
+    emit iconSizesChanged();
+  }
+  if (current.backgroundColor != old.backgroundColor ||
+      current.showBorder != old.showBorder ||
+      current.borderColor != old.borderColor) {
+    emit colorsChanged();
+  }
+  if (current.tooltipFontSize != old.tooltipFontSize) {
+    emit tooltipFontSizeChanged();
+  }
+  if (current.applicationMenuName != old.applicationMenuName ||
+      current.applicationMenuIcon != old.applicationMenuIcon) {
+    emit applicationMenuAppearanceChanged();
+  }
+  if (wallpapers) {
+    emit wallpapersChanged();
+  }
+  // The items read these when painting. The other settings are read when
+  // they are used.
+  if (current.showDesktopNumber != old.showDesktopNumber ||
+      current.use24HourClock != old.use24HourClock ||
+      current.clockFontScaleFactor != old.clockFontScaleFactor) {
+    emit appearanceOutdated();
+  }
+}
+
+void MultiDockModel::loadAppearanceSettings() {
+  auto& settings = appearanceSettings_;
+  settings.minIconSize = appearanceProperty(kGeneralCategory, kMinimumIconSize,
+                                            kDefaultMinSize);
+  settings.maxIconSize = appearanceProperty(kGeneralCategory, kMaximumIconSize,
+                                            kDefaultMaxSize);
+  settings.spacingFactor = appearanceProperty(kGeneralCategory, kSpacingFactor,
+                                              kDefaultSpacingFactor);
+  QColor defaultBackgroundColor(kDefaultBackgroundColor);
+  defaultBackgroundColor.setAlphaF(kDefaultBackgroundAlpha);
+  settings.backgroundColor = appearanceProperty(kGeneralCategory, kBackgroundColor,
+                                                defaultBackgroundColor);
+  settings.showBorder = appearanceProperty(kGeneralCategory, kShowBorder,
+                                           kDefaultShowBorder);
+  settings.borderColor = appearanceProperty(kGeneralCategory, kBorderColor,
+                                            QColor(kDefaultBorderColor));
+  settings.tooltipFontSize = appearanceProperty(kGeneralCategory, kTooltipFontSize,
+                                                kDefaultTooltipFontSize);
+
+  settings.applicationMenuName = appearanceProperty(
+      kApplicationMenuCategory, kLabel, i18n(kDefaultApplicationMenuName));
+  settings.applicationMenuIcon = appearanceProperty(
+      kApplicationMenuCategory, kIcon, QString(kDefaultApplicationMenuIcon));
+  settings.applicationMenuStrut = appearanceProperty(
+      kApplicationMenuCategory, kStrut, kDefaultApplicationMenuStrut);
+
+  settings.showDesktopNumber = appearanceProperty(
+      kPagerCategory, kShowDesktopNumber, kDefaultShowDesktopNumber);
+
+  settings.currentDesktopTasksOnly = appearanceProperty(
+      kTaskManagerCategory, kCurrentDesktopTasksOnly, kDefaultCurrentDesktopTasksOnly);
+  settings.currentScreenTasksOnly = appearanceProperty(
+      kTaskManagerCategory, kCurrentScreenTasksOnly, kDefaultCurrentScreenTasksOnly);
+  settings.taskEventCoalescingInterval = appearanceProperty(
+      kTaskManagerCategory, kTaskEventCoalescingInterval,
+      kDefaultTaskEventCoalescingInterval);
+
+  settings.use24HourClock = appearanceProperty(kClockCategory, kUse24HourClock,
+                                               kDefaultUse24HourClock);
+  settings.clockFontScaleFactor = appearanceProperty(
+      kClockCategory, kFontScaleFactor, kDefaultClockFontScaleFactor);
+
+  ++settingsVersion_;
+}
+
+void MultiDockModel::loadDockSettings(int dockId) {
+  auto& settings = dockSettings_[dockId];
+  settings.position = static_cast<PanelPosition>(dockProperty(
+      dockId, kGeneralCategory, kPosition,
+      static_cast<int>(PanelPosition::Bottom)));
+  settings.screen = dockProperty(dockId, kGeneralCategory, kScreen, 0);
+  settings.autoHide = dockProperty(dockId, kGeneralCategory, kAutoHide,
+                                   kDefaultAutoHide);
+  // For backward compatibility.
+  settings.visibility = settings.autoHide
+      ? PanelVisibility::AutoHide
+      : static_cast<PanelVisibility>(dockProperty(
+            dockId, kGeneralCategory, kVisibility,
+            static_cast<int>(kDefaultVisibility)));
+  settings.showApplicationMenu = dockProperty(
+      dockId, kGeneralCategory, kShowApplicationMenu, kDefaultShowApplicationMenu);
+  settings.showPager = dockProperty(dockId, kGeneralCategory, kShowPager,
+                                    kDefaultShowPager);
+  settings.showTaskManager = dockProperty(
+      dockId, kGeneralCategory, kShowTaskManager, kDefaultShowTaskManager);
+  settings.showClock = dockProperty(dockId, kGeneralCategory, kShowClock,
+                                    kDefaultShowClock);
+
+  ++settingsVersion_;
+}
+
 void MultiDockModel::syncDockLaunchersConfig(int dockId) {
-  const auto& launchersPath = dockLaunchersPath(dockId);
-  QDir launchersDir(launchersPath);
-  QStringList files = launchersDir.entryList(QDir::Files, QDir::Name);
-  for (int i = 0; i < files.size(); ++i) {
-    launchersDir.remove(files.at(i));
+  if (inTransaction()) {
+    pendingChanges_.dockLaunchersConfigs.insert(dockId);
+    return;
+  }
+  writeDockLaunchersConfig(dockId);
+}
+
+void MultiDockModel::writeDockLaunchersConfig(int dockId) {
+  const QString launchersPath = dockLaunchersPath(dockId);
+  const std::vector<LauncherConfig> launchers = dockLauncherConfigs(dockId);
+  configCacheOutdated_ = true;
+  configWriter_.write(launchersPath, [launchersPath, launchers]() {
+    writeDockLaunchers(launchersPath, launchers);
+  });
+}
+
+void MultiDockModel::writeConfig(const QString& path, KConfig* config) {
+  std::vector<std::pair<QString, QMap<QString, QString>>> snapshot;
+  for (const auto& group : config->groupList()) {
+    snapshot.emplace_back(group, config->group(group).entryMap());
+  }
+  // The snapshot will be written, so the model's config doesn't need to be.
+  config->markAsClean();
+  configCacheOutdated_ = true;
+
+  const auto configStamps = configStamps_;
+  configWriter_.write(path, [path, snapshot, configStamps]() {
+    // Written over the existing file, which KConfig replaces atomically, so
+    // the groups and entries that are no longer in the config are deleted.
+    KConfig file(path, KConfig::SimpleConfig);
+    QStringList removedGroups = file.groupList();
+    for (const auto& group : snapshot) {
+      removedGroups.removeAll(group.first);
+      KConfigGroup fileGroup(&file, group.first);
+      for (const auto& key : fileGroup.keyList()) {
+        if (!group.second.contains(key)) {
+          fileGroup.deleteEntry(key);
+        }
+      }
+      for (auto it = group.second.cbegin(); it != group.second.cend(); ++it) {
+        fileGroup.writeEntry(it.key(), it.value());
+      }
+    }
+    for (const auto& group : removedGroups) {
+      file.deleteGroup(group);
+    }
+    file.sync();
+    recordConfigStamp(configStamps.get(), path);
+  });
+}
+
+/* static */ void MultiDockModel::writeDockLaunchers(
+    const QString& launchersPath, const std::vector<LauncherConfig>& launchers) {
+  QDir::root().mkpath(launchersPath);
+
+  // Only writes the launchers that don't have a file yet.
+  QStringList files;
+  for (const auto& launcher : launchers) {
+    const QString file = launcher.fileName();
+    const QString filePath = launchersPath + "/" + file;
+    if (!QFile::exists(filePath)) {
+      launcher.saveToFile(filePath);
+    }
+    files.append(file);
+  }
+
+  if (ConfigHelper::readLaunchersIndex(launchersPath) != files &&
+      !ConfigHelper::writeLaunchersIndex(launchersPath, files)) {
+    std::cerr << "Failed to write the launchers index in "
+              << launchersPath.toStdString() << std::endl;
+    // Keeps the old launcher files that the old index refers to.
+    return;
   }
 
-  int launcherId = 1;
-  for (const auto& item : dockLauncherConfigs(dockId)) {
-    item.saveToFile(QString("%1/%2 - %3.desktop")
-        .arg(launchersPath)
-        .arg(launcherId, 2, 10, QChar('0'))
-        .arg(item.name));
-    ++launcherId;
+  // Removes the launcher files that are no longer in the index.
+  QSet<QString> fileSet;
+  for (const auto& file : files) {
+    fileSet.insert(file);
+  }
+  QDir launchersDir(launchersPath);
+  for (const auto& file : launchersDir.entryList({"*.desktop"}, QDir::Files)) {
+    if (!fileSet.contains(file)) {
+      launchersDir.remove(file);
+    }
   }
 }
 
 std::vector<LauncherConfig> MultiDockModel::loadDockLaunchers(
     const QString& dockLaunchersPath) {
-  QDir launchersDir(dockLaunchersPath);
-  QStringList files = launchersDir.entryList({"*.desktop"}, QDir::Files,
-                                             QDir::Name);
+  QStringList files = ConfigHelper::readLaunchersIndex(dockLaunchersPath);
+  if (files.empty()) {
+    // Launchers saved by older versions, ordered by their numbered names.
+    QDir launchersDir(dockLaunchersPath);
+    files = launchersDir.entryList({"*.desktop"}, QDir::Files, QDir::Name);
+  }
   if (files.empty()) {
     return createDefaultLaunchers();
   }
@@ -222,7 +679,9 @@ std::vector<LauncherConfig> MultiDockModel::loadDockLaunchers(
   launchers.reserve(files.size());
   for (int i = 0; i < files.size(); ++i) {
     const QString& desktopFile = dockLaunchersPath + "/" + files.at(i);
-    launchers.push_back(LauncherConfig(desktopFile));
+    if (QFile::exists(desktopFile)) {
+      launchers.push_back(LauncherConfig(desktopFile));
+    }
   }
 
   return launchers;
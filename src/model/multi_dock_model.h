@@ -20,14 +20,21 @@
 #define KSMOOTHDOCK_MULTI_DOCK_MODEL_H_
 
 #include <memory>
+#include <mutex>
+#include <set>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include <QColor>
 #include <QDir>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QMap>
 #include <QObject>
 #include <QString>
+#include <QStringList>
+#include <QTimer>
 
 #include <KConfig>
 #include <KConfigGroup>
@@ -35,6 +42,8 @@
 
 #include "application_menu_config.h"
 #include "config_helper.h"
+#include "config_writer.h"
+#include "override_config.h"
 #include <utils/command_utils.h>
 
 namespace ksmoothdock {
@@ -69,6 +78,7 @@ constexpr bool kDefaultApplicationMenuStrut = true;
 constexpr bool kDefaultShowDesktopNumber = true;
 constexpr bool kDefaultCurrentDesktopTasksOnly = true;
 constexpr bool kDefaultCurrentScreenTasksOnly = false;
+constexpr int kDefaultTaskEventCoalescingInterval = 0;  // msecs
 constexpr bool kDefaultUse24HourClock = true;
 constexpr float kDefaultClockFontScaleFactor = kLargeClockFontScaleFactor;
 
@@ -87,6 +97,64 @@ struct LauncherConfig {
 
   // Saves to file in desktop file format.
   void saveToFile(const QString& filePath) const;
+
+  // Gets the launcher's file name in the launchers directory. It is derived
+  // from the contents, so that an unchanged launcher keeps its file.
+  QString fileName() const;
+
+  bool operator==(const LauncherConfig& other) const {
+    return name == other.name && icon == other.icon && command == other.command &&
+        taskCommand == other.taskCommand;
+  }
+
+  bool operator!=(const LauncherConfig& other) const { return !(*this == other); }
+};
+
+// Typed snapshot of the global appearance settings.
+struct AppearanceSettings {
+  int minIconSize = kDefaultMinSize;
+  int maxIconSize = kDefaultMaxSize;
+  float spacingFactor = kDefaultSpacingFactor;
+  QColor backgroundColor;
+  bool showBorder = kDefaultShowBorder;
+  QColor borderColor;
+  int tooltipFontSize = kDefaultTooltipFontSize;
+
+  QString applicationMenuName;
+  QString applicationMenuIcon;
+  bool applicationMenuStrut = kDefaultApplicationMenuStrut;
+
+  bool showDesktopNumber = kDefaultShowDesktopNumber;
+
+  bool currentDesktopTasksOnly = kDefaultCurrentDesktopTasksOnly;
+  bool currentScreenTasksOnly = kDefaultCurrentScreenTasksOnly;
+  int taskEventCoalescingInterval = kDefaultTaskEventCoalescingInterval;
+
+  bool use24HourClock = kDefaultUse24HourClock;
+  float clockFontScaleFactor = kDefaultClockFontScaleFactor;
+};
+
+// Typed snapshot of a dock's settings.
+struct DockSettings {
+  PanelPosition position = PanelPosition::Bottom;
+  int screen = 0;
+  PanelVisibility visibility = kDefaultVisibility;
+  bool autoHide = kDefaultAutoHide;
+  bool showApplicationMenu = kDefaultShowApplicationMenu;
+  bool showPager = kDefaultShowPager;
+  bool showTaskManager = kDefaultShowTaskManager;
+  bool showClock = kDefaultShowClock;
+
+  bool operator==(const DockSettings& other) const {
+    return position == other.position && screen == other.screen &&
+        visibility == other.visibility && autoHide == other.autoHide &&
+        showApplicationMenu == other.showApplicationMenu &&
+        showPager == other.showPager &&
+        showTaskManager == other.showTaskManager &&
+        showClock == other.showClock;
+  }
+
+  bool operator!=(const DockSettings& other) const { return !(*this == other); }
 };
 
 // The model.
@@ -95,7 +163,7 @@ class MultiDockModel : public QObject {
 
  public:
   MultiDockModel(const QString& configDir);
-  ~MultiDockModel() = default;
+  ~MultiDockModel();
 
   MultiDockModel(const MultiDockModel&) = delete;
   MultiDockModel& operator=(const MultiDockModel&) = delete;
@@ -117,94 +185,111 @@ class MultiDockModel : public QObject {
   // Removes a dock.
   void removeDock(int dockId);
 
-  int minIconSize() const {
-    return appearanceProperty(kGeneralCategory, kMinimumIconSize,
-                              kDefaultMinSize);
+  // Typed snapshots of the settings. They are loaded from the configs on
+  // start-up and by reloadSettings(), and updated field by field by the
+  // setters, so that reading a setting is a plain field access.
+  const AppearanceSettings& appearanceSettings() const {
+    return appearanceSettings_;
+  }
+
+  const DockSettings& dockSettings(int dockId) const {
+    return dockSettings_.at(dockId);
   }
 
+  // Incremented on every snapshot refresh, so that values derived from the
+  // settings can be cached.
+  quint64 settingsVersion() const { return settingsVersion_; }
+
+  // Re-reads all the settings from the config files. This is done
+  // automatically, and the views notified, when the appearance config or the
+  // dock configs are changed outside of the model.
+  void reloadSettings();
+
+  // Config changes are written to disk in the background. This waits until
+  // all the pending writes have been done.
+  void flushConfig() { configWriter_.flush(); }
+
+  // Batches changes: until the matching commit(), the config syncs and the
+  // change signals are deferred. commit() then syncs each changed config once
+  // and emits one consolidated set of signals, so that a bulk change costs a
+  // single write per file and a single view refresh. Transactions can be
+  // nested, only the outermost commit() applies the changes.
+  void beginTransaction() { ++transactionDepth_; }
+  void commit();
+
+  bool inTransaction() const { return transactionDepth_ > 0; }
+
+  int minIconSize() const { return appearanceSettings_.minIconSize; }
+
   void setMinIconSize(int value) {
+    appearanceSettings_.minIconSize = value;
     setAppearanceProperty(kGeneralCategory, kMinimumIconSize, value);
   }
 
-  int maxIconSize() const {
-    return appearanceProperty(kGeneralCategory, kMaximumIconSize,
-                              kDefaultMaxSize);
-  }
+  int maxIconSize() const { return appearanceSettings_.maxIconSize; }
 
   void setMaxIconSize(int value) {
+    appearanceSettings_.maxIconSize = value;
     setAppearanceProperty(kGeneralCategory, kMaximumIconSize, value);
   }
 
-  float spacingFactor() const {
-    return appearanceProperty(kGeneralCategory, kSpacingFactor, kDefaultSpacingFactor);
-  }
+  float spacingFactor() const { return appearanceSettings_.spacingFactor; }
 
   void setSpacingFactor(float value) {
+    appearanceSettings_.spacingFactor = value;
     setAppearanceProperty(kGeneralCategory, kSpacingFactor, value);
   }
 
-  QColor backgroundColor() const {
-    QColor defaultBackgroundColor(kDefaultBackgroundColor);
-    defaultBackgroundColor.setAlphaF(kDefaultBackgroundAlpha);
-    return appearanceProperty(kGeneralCategory, kBackgroundColor,
-                              defaultBackgroundColor);
-  }
+  const QColor& backgroundColor() const { return appearanceSettings_.backgroundColor; }
 
   void setBackgroundColor(const QColor& value) {
+    appearanceSettings_.backgroundColor = configColor(value);
     setAppearanceProperty(kGeneralCategory, kBackgroundColor, value);
   }
 
-  bool showBorder() const {
-    return appearanceProperty(kGeneralCategory, kShowBorder,
-                              kDefaultShowBorder);
-  }
+  bool showBorder() const { return appearanceSettings_.showBorder; }
 
   void setShowBorder(bool value) {
+    appearanceSettings_.showBorder = value;
     setAppearanceProperty(kGeneralCategory, kShowBorder, value);
   }
 
-  QColor borderColor() const {
-    return appearanceProperty(kGeneralCategory, kBorderColor,
-                              QColor(kDefaultBorderColor));
-  }
+  const QColor& borderColor() const { return appearanceSettings_.borderColor; }
 
   void setBorderColor(const QColor& value) {
+    appearanceSettings_.borderColor = configColor(value);
     setAppearanceProperty(kGeneralCategory, kBorderColor, value);
   }
 
-  int tooltipFontSize() const {
-    return appearanceProperty(kGeneralCategory, kTooltipFontSize,
-                              kDefaultTooltipFontSize);
-  }
+  int tooltipFontSize() const { return appearanceSettings_.tooltipFontSize; }
 
   void setTooltipFontSize(int value) {
+    appearanceSettings_.tooltipFontSize = value;
     setAppearanceProperty(kGeneralCategory, kTooltipFontSize, value);
   }
 
-  QString applicationMenuName() const {
-    return appearanceProperty(kApplicationMenuCategory, kLabel,
-                              i18n(kDefaultApplicationMenuName));
+  const QString& applicationMenuName() const {
+    return appearanceSettings_.applicationMenuName;
   }
 
   void setApplicationMenuName(const QString& value) {
+    appearanceSettings_.applicationMenuName = value;
     setAppearanceProperty(kApplicationMenuCategory, kLabel, value);
   }
 
-  QString applicationMenuIcon() const {
-    return appearanceProperty(kApplicationMenuCategory, kIcon,
-                              QString(kDefaultApplicationMenuIcon));
+  const QString& applicationMenuIcon() const {
+    return appearanceSettings_.applicationMenuIcon;
   }
 
   void setApplicationMenuIcon(const QString& value) {
+    appearanceSettings_.applicationMenuIcon = value;
     setAppearanceProperty(kApplicationMenuCategory, kIcon, value);
   }
 
-  bool applicationMenuStrut() const {
-    return appearanceProperty(kApplicationMenuCategory, kStrut,
-                              kDefaultApplicationMenuStrut);
-  }
+  bool applicationMenuStrut() const { return appearanceSettings_.applicationMenuStrut; }
 
   void setApplicationMenuStrut(bool value) {
+    appearanceSettings_.applicationMenuStrut = value;
     setAppearanceProperty(kApplicationMenuCategory, kStrut, value);
   }
 
@@ -218,144 +303,171 @@ class MultiDockModel : public QObject {
     setAppearanceProperty(kPagerCategory,
                           ConfigHelper::wallpaperConfigKey(desktop, screen),
                           value);
+    wallpapersChanged_ = true;
   }
 
   // Notifies that the wallpaper for the current desktop for the specified
   // screen has been changed.
   void notifyWallpaperChanged(int screen) {
-    emit wallpaperChanged(screen);
+    if (inTransaction()) {
+      pendingChanges_.wallpaperScreens.insert(screen);
+    } else {
+      emit wallpaperChanged(screen);
+    }
   }
 
-  bool showDesktopNumber() const {
-    return appearanceProperty(kPagerCategory, kShowDesktopNumber,
-                              kDefaultShowDesktopNumber);
-  }
+  bool showDesktopNumber() const { return appearanceSettings_.showDesktopNumber; }
 
   void setShowDesktopNumber(bool value) {
+    appearanceSettings_.showDesktopNumber = value;
     setAppearanceProperty(kPagerCategory, kShowDesktopNumber, value);
   }
 
   bool currentDesktopTasksOnly() const {
-    return appearanceProperty(kTaskManagerCategory, kCurrentDesktopTasksOnly,
-                              kDefaultCurrentDesktopTasksOnly);
+    return appearanceSettings_.currentDesktopTasksOnly;
   }
 
   void setCurrentDesktopTasksOnly(bool value) {
+    appearanceSettings_.currentDesktopTasksOnly = value;
     setAppearanceProperty(kTaskManagerCategory, kCurrentDesktopTasksOnly, value);
   }
 
   bool currentScreenTasksOnly() const {
-    return appearanceProperty(kTaskManagerCategory, kCurrentScreenTasksOnly,
-                              kDefaultCurrentScreenTasksOnly);
+    return appearanceSettings_.currentScreenTasksOnly;
   }
 
   void setCurrentScreenTasksOnly(bool value) {
+    appearanceSettings_.currentScreenTasksOnly = value;
     setAppearanceProperty(kTaskManagerCategory, kCurrentScreenTasksOnly, value);
   }
 
-  bool use24HourClock() const {
-    return appearanceProperty(kClockCategory, kUse24HourClock,
-                              kDefaultUse24HourClock);
+  // How long task events are queued before being applied to the docks
+  // together, in msecs. 0 means once per event-loop turn.
+  int taskEventCoalescingInterval() const {
+    return appearanceSettings_.taskEventCoalescingInterval;
+  }
+
+  void setTaskEventCoalescingInterval(int value) {
+    appearanceSettings_.taskEventCoalescingInterval = value;
+    setAppearanceProperty(kTaskManagerCategory, kTaskEventCoalescingInterval, value);
   }
 
+  bool use24HourClock() const { return appearanceSettings_.use24HourClock; }
+
   void setUse24HourClock(bool value) {
+    appearanceSettings_.use24HourClock = value;
     setAppearanceProperty(kClockCategory, kUse24HourClock, value);
   }
 
-  float clockFontScaleFactor() const {
-    return appearanceProperty(kClockCategory, kFontScaleFactor,
-                              kDefaultClockFontScaleFactor);
-  }
+  float clockFontScaleFactor() const { return appearanceSettings_.clockFontScaleFactor; }
 
   void setClockFontScaleFactor(float value) {
+    appearanceSettings_.clockFontScaleFactor = value;
     setAppearanceProperty(kClockCategory, kFontScaleFactor, value);
   }
 
-  void saveAppearanceConfig(bool repaintOnly = false) {
+  // Saves the appearance config and notifies the views of what has changed
+  // since the last save.
+  void saveAppearanceConfig() {
     syncAppearanceConfig();
-    if (repaintOnly) {
-      emit appearanceOutdated();
+    if (inTransaction()) {
+      pendingChanges_.appearanceNotification = true;
     } else {
-      emit appearanceChanged();
+      notifyAppearanceChanges();
     }
   }
 
+  // Previews the appearance settings: they replace the in-memory snapshot and
+  // the views are notified as if they had been saved, but the config is left
+  // untouched. The preview ends when the settings are set and saved, or when
+  // it is cancelled.
+  void previewAppearanceSettings(const AppearanceSettings& settings);
+
+  // Restores the saved appearance settings and notifies the views.
+  void cancelAppearancePreview();
+
   PanelPosition panelPosition(int dockId) const {
-    return static_cast<PanelPosition>(dockProperty(
-        dockId, kGeneralCategory, kPosition,
-        static_cast<int>(PanelPosition::Bottom)));
+    return dockSettings_.at(dockId).position;
   }
 
   void setPanelPosition(int dockId, PanelPosition value) {
+    dockSettings_[dockId].position = value;
     setDockProperty(dockId, kGeneralCategory, kPosition,
                     static_cast<int>(value));
   }
 
   int screen(int dockId) const {
-    return dockProperty(dockId, kGeneralCategory, kScreen, 0);
+    return dockSettings_.at(dockId).screen;
   }
 
   void setScreen(int dockId, int value) {
+    dockSettings_[dockId].screen = value;
     setDockProperty(dockId, kGeneralCategory, kScreen, value);
   }
 
   PanelVisibility visibility(int dockId) const {
-    if (autoHide(dockId)) {  // for backward compatibility.
-      return PanelVisibility::AutoHide;
-    }
-    return static_cast<PanelVisibility>(dockProperty(
-        dockId, kGeneralCategory, kVisibility,
-        static_cast<int>(kDefaultVisibility)));
+    return dockSettings_.at(dockId).visibility;
   }
 
   void setVisibility(int dockId, PanelVisibility value) {
+    auto& settings = dockSettings_[dockId];
+    settings.visibility = value;
+    // For backward compatibility.
+    settings.autoHide = value == PanelVisibility::AutoHide;
     setDockProperty(dockId, kGeneralCategory, kVisibility,
                     static_cast<int>(value));
-    // For backward compatibility.
-    setAutoHide(dockId, value == PanelVisibility::AutoHide);
+    setDockProperty(dockId, kGeneralCategory, kAutoHide, settings.autoHide);
   }
 
   bool autoHide(int dockId) const {
-    return dockProperty(dockId, kGeneralCategory, kAutoHide, kDefaultAutoHide);
+    return dockSettings_.at(dockId).autoHide;
   }
 
   void setAutoHide(int dockId, bool value) {
+    auto& settings = dockSettings_[dockId];
+    settings.autoHide = value;
+    // For backward compatibility, as in loadDockSettings().
+    settings.visibility = value
+        ? PanelVisibility::AutoHide
+        : static_cast<PanelVisibility>(dockProperty(
+              dockId, kGeneralCategory, kVisibility,
+              static_cast<int>(kDefaultVisibility)));
     setDockProperty(dockId, kGeneralCategory, kAutoHide, value);
   }
 
   bool showApplicationMenu(int dockId) const {
-    return dockProperty(dockId, kGeneralCategory, kShowApplicationMenu,
-                        kDefaultShowApplicationMenu);
+    return dockSettings_.at(dockId).showApplicationMenu;
   }
 
   void setShowApplicationMenu(int dockId, bool value) {
+    dockSettings_[dockId].showApplicationMenu = value;
     setDockProperty(dockId, kGeneralCategory, kShowApplicationMenu, value);
   }
 
   bool showPager(int dockId) const {
-    return dockProperty(dockId, kGeneralCategory, kShowPager,
-                        kDefaultShowPager);
+    return dockSettings_.at(dockId).showPager;
   }
 
   void setShowPager(int dockId, bool value) {
+    dockSettings_[dockId].showPager = value;
     setDockProperty(dockId, kGeneralCategory, kShowPager, value);
   }
 
   bool showTaskManager(int dockId) const {
-    return dockProperty(dockId, kGeneralCategory, kShowTaskManager,
-                        kDefaultShowTaskManager);
+    return dockSettings_.at(dockId).showTaskManager;
   }
 
   void setShowTaskManager(int dockId, bool value) {
+    dockSettings_[dockId].showTaskManager = value;
     setDockProperty(dockId, kGeneralCategory, kShowTaskManager, value);
   }
 
   bool showClock(int dockId) const {
-    return dockProperty(dockId, kGeneralCategory, kShowClock,
-                        kDefaultShowClock);
+    return dockSettings_.at(dockId).showClock;
   }
 
   void setShowClock(int dockId, bool value) {
+    dockSettings_[dockId].showClock = value;
     setDockProperty(dockId, kGeneralCategory, kShowClock, value);
   }
 
@@ -368,18 +480,32 @@ class MultiDockModel : public QObject {
     return std::get<2>(dockConfigs_.at(dockId));
   }
 
-  const std::vector<LauncherConfig> dockLauncherConfigs(int dockId) const {
+  const std::vector<LauncherConfig>& dockLauncherConfigs(int dockId) const {
     return std::get<3>(dockConfigs_.at(dockId));
   }
 
+  // Generation of a dock's launcher configs. It changes whenever the launcher
+  // configs change, so that views can skip rebuilding when it hasn't.
+  quint64 dockLaunchersGeneration(int dockId) const {
+    return std::get<4>(dockConfigs_.at(dockId));
+  }
+
   void setDockLauncherConfigs(
       int dockId, const std::vector<LauncherConfig>& launcherConfigs) {
-    std::get<3>(dockConfigs_[dockId]) = launcherConfigs;
+    auto& launchers = std::get<3>(dockConfigs_[dockId]);
+    if (launchers != launcherConfigs) {
+      launchers = launcherConfigs;
+      touchDockLaunchers(dockId);
+    }
   }
 
   void saveDockLauncherConfigs(int dockId) {
     syncDockLaunchersConfig(dockId);
-    emit dockLaunchersChanged(dockId);
+    if (inTransaction()) {
+      pendingChanges_.changedDockLaunchers.insert(dockId);
+    } else {
+      emit dockLaunchersChanged(dockId);
+    }
   }
 
   void addLauncher(int dockId, const LauncherConfig& launcher) {
@@ -387,6 +513,7 @@ class MultiDockModel : public QObject {
     unsigned int i = 0;
     for (; i < launchers.size() && launchers[i].taskCommand < launcher.taskCommand; ++i) {}
     launchers.insert(launchers.begin() + i, launcher);
+    touchDockLaunchers(dockId);
     syncDockLaunchersConfig(dockId);
   }
 
@@ -395,6 +522,7 @@ class MultiDockModel : public QObject {
     for (unsigned i = 0; i < launchers.size(); ++i) {
       if (launchers[i].command == command) {
         launchers.erase(launchers.begin() + i);
+        touchDockLaunchers(dockId);
         syncDockLaunchersConfig(dockId);
         return;
       }
@@ -412,10 +540,23 @@ class MultiDockModel : public QObject {
     return applicationMenuConfig_.findApplication(command);
   }
 
+  const OverrideConfig& overrideConfig() const { return overrideConfig_; }
+
  signals:
   // Minor appearance changes that require view update (repaint).
   void appearanceOutdated();
-  // Major appearance changes that require view reload.
+  // The icon sizes or the spacing have been changed, which require relayout
+  // and resizing the items' icon caches.
+  void iconSizesChanged();
+  // The background color, the border color or the border visibility have
+  // been changed.
+  void colorsChanged();
+  void tooltipFontSizeChanged();
+  // The application menu's name or icon have been changed.
+  void applicationMenuAppearanceChanged();
+  // The pager wallpapers have been changed.
+  void wallpapersChanged();
+  // Major appearance changes that change the items, and require view reload.
   void appearanceChanged();
   void dockAdded(int dockId);
   void dockLaunchersChanged(int dockId);
@@ -423,6 +564,12 @@ class MultiDockModel : public QObject {
   // Will require calling Plasma D-Bus to update the wallpaper.
   void wallpaperChanged(int screen);
   void applicationMenuConfigChanged();
+  void applicationMenuEntriesChanged(const ApplicationEntryChanges& changes);
+
+ private slots:
+  // Reloads the settings if the config files have been changed outside of
+  // the model, and notifies the views.
+  void reloadChangedConfigs();
 
  private:
   // Dock config's categories/properties.
@@ -459,48 +606,78 @@ class MultiDockModel : public QObject {
   static constexpr char kTaskManagerCategory[] = "TaskManager";
   static constexpr char kCurrentDesktopTasksOnly[] = "currentDesktopTasksOnly";
   static constexpr char kCurrentScreenTasksOnly[] = "currentScreenTasksOnly";
+  static constexpr char kTaskEventCoalescingInterval[] = "taskEventCoalescingInterval";
 
   static constexpr char kClockCategory[] = "Clock";
   static constexpr char kUse24HourClock[] = "use24HourClock";
   static constexpr char kFontScaleFactor[] = "fontScaleFactor";
 
+  // Bursts of config file changes are handled at once after this delay, in
+  // milliseconds.
+  static constexpr int kConfigReloadDelay = 500;
+
+  // The modification times and sizes of the config files, as last written or
+  // reloaded by the model, so that its own writes can be told from external
+  // changes. The writes update them from the config writer's thread.
+  struct ConfigStamps {
+    std::mutex mutex;
+    QHash<QString, std::pair<qint64, qint64>> stamps;
+  };
+
   template <typename T>
   T appearanceProperty(QString category, QString name, T defaultValue) const {
-    KConfigGroup group(&appearanceConfig_, category);
+    KConfigGroup group(appearanceConfig(), category);
     return group.readEntry(name, defaultValue);
   }
 
+  // Writes a property to the config. The caller updates the matching field
+  // of the typed snapshot.
   template <typename T>
   void setAppearanceProperty(QString category, QString name, T value) {
-    KConfigGroup group(&appearanceConfig_, category);
+    KConfigGroup group(appearanceConfig(), category);
     group.writeEntry(name, value);
+    ++settingsVersion_;
   }
 
   template <typename T>
-  T dockProperty(int dockId, QString category, QString name, T defaultValue)
-      const {
+  T dockProperty(int dockId, QString category, QString name, T defaultValue) {
     KConfigGroup group(dockConfig(dockId), category);
     return group.readEntry(name, defaultValue);
   }
 
+  // Writes a property to the config. The caller updates the matching field
+  // of the typed snapshot.
   template <typename T>
   void setDockProperty(int dockId, QString category, QString name, T value) {
     KConfigGroup group(dockConfig(dockId), category);
     group.writeEntry(name, value);
+    ++settingsVersion_;
   }
 
-  QString dockConfigPath(int dockId) const {
-    return std::get<0>(dockConfigs_.at(dockId));
+  // The color as it reads back from the config, which only keeps 8 bits per
+  // component.
+  static QColor configColor(const QColor& color) {
+    return QColor::fromRgba(color.rgba());
   }
 
-  const KConfig* dockConfig(int dockId) const {
-    return std::get<1>(dockConfigs_.at(dockId)).get();
-  }
+  // Emits the signals for the appearance settings that have changed since the
+  // last notification.
+  void notifyAppearanceChanges();
 
-  KConfig* dockConfig(int dockId) {
-    return std::get<1>(dockConfigs_[dockId]).get();
+  // Refreshes the typed snapshots from the configs.
+  void loadAppearanceSettings();
+  void loadDockSettings(int dockId);
+
+  QString dockConfigPath(int dockId) const {
+    return std::get<0>(dockConfigs_.at(dockId));
   }
 
+  // The configs are only parsed when they are first used, which is never for
+  // the docks whose settings have been loaded from the config cache and
+  // haven't been changed.
+  KConfig* appearanceConfig() const;
+  KConfig* dockConfig(int dockId);
+
   static std::vector<LauncherConfig> loadDockLaunchers(
       const QString& dockLaunchersPath);
 
@@ -508,19 +685,59 @@ class MultiDockModel : public QObject {
 
   void loadDocks();
 
+  // Loads the appearance settings, the docks' settings and launchers from the
+  // config cache. Returns false if the cache is missing or outdated.
+  bool loadConfigCache();
+
+  // Queues saving the config cache from the current settings and launchers.
+  void saveConfigCache();
+
   int addDock(const std::tuple<QString, QString>& configs,
               PanelPosition position, int screen);
 
   void syncAppearanceConfig() {
-    appearanceConfig_.sync();
+    if (inTransaction()) {
+      pendingChanges_.appearanceConfig = true;
+      return;
+    }
+    writeConfig(configHelper_.appearanceConfigPath(), appearanceConfig());
   }
 
   void syncDockConfig(int dockId) {
-    dockConfig(dockId)->sync();
+    if (inTransaction()) {
+      pendingChanges_.dockConfigs.insert(dockId);
+      return;
+    }
+    writeConfig(dockConfigPath(dockId), dockConfig(dockId));
   }
 
   void syncDockLaunchersConfig(int dockId);
 
+  // Queues writing a snapshot of the dock's launchers.
+  void writeDockLaunchersConfig(int dockId);
+
+  // Queues writing a snapshot of the config to the file.
+  void writeConfig(const QString& path, KConfig* config);
+
+  // Records the current stamp of the config file. Returns whether it has
+  // changed since the last record.
+  static bool recordConfigStamp(ConfigStamps* configStamps,
+                                const QString& path);
+
+  // The appearance config and the dock configs.
+  QStringList configPaths() const;
+
+  // Watches the config files and the config dir. Saving a file replaces it,
+  // which ends its watch, so this is called again after every change.
+  void watchConfigs();
+
+  static void writeDockLaunchers(const QString& launchersPath,
+                                 const std::vector<LauncherConfig>& launchers);
+
+  void touchDockLaunchers(int dockId) {
+    std::get<4>(dockConfigs_[dockId]) = ++lastLaunchersGeneration_;
+  }
+
   static void copyEntry(const QString& key, const KConfigGroup& sourceGroup,
                         KConfigGroup* destGroup) {
     destGroup->writeEntry(key, sourceGroup.readEntry(key));
@@ -531,27 +748,71 @@ class MultiDockModel : public QObject {
 
   // Helper(s).
   ConfigHelper configHelper_;
+  // Declared before the configs so that it outlives them.
+  ConfigWriter configWriter_;
 
   // Model data.
 
-  // Appearance config.
-  KConfig appearanceConfig_;
+  // Appearance config, parsed on first use.
+  mutable std::unique_ptr<KConfig> appearanceConfig_;
 
   // Dock configs, as map from dockIds to tuples of:
   // (dock config file path,
-  //  dock config,
+  //  dock config, parsed on first use,
   //  launchers dir path,
-  //  list of launcher configs)
+  //  list of launcher configs,
+  //  generation of the launcher configs)
   std::unordered_map<int,
                      std::tuple<QString,
                                 std::unique_ptr<KConfig>,
                                 QString,
-                                std::vector<LauncherConfig>>> dockConfigs_;
+                                std::vector<LauncherConfig>,
+                                quint64>> dockConfigs_;
+
+  // Launcher config generations are unique across docks and reloads.
+  quint64 lastLaunchersGeneration_ = 0;
+
+  // Typed snapshots of the appearance config and of the dock configs.
+  AppearanceSettings appearanceSettings_;
+  std::unordered_map<int, DockSettings> dockSettings_;
+  quint64 settingsVersion_ = 0;
+
+  // The appearance settings that the views have last been notified of.
+  AppearanceSettings notifiedAppearanceSettings_;
+  bool wallpapersChanged_ = false;
+
+  // Syncs and signals deferred until the end of the current transaction.
+  struct PendingChanges {
+    bool appearanceConfig = false;
+    bool appearanceNotification = false;
+    std::set<int> dockConfigs;
+    std::set<int> dockLaunchersConfigs;
+    // In the order they have been added.
+    std::vector<int> addedDocks;
+    std::set<int> changedDockLaunchers;
+    std::set<int> wallpaperScreens;
+  };
+
+  int transactionDepth_ = 0;
+  PendingChanges pendingChanges_;
 
   // ID for the next dock.
   int nextDockId_;
 
+  // Whether the config files have changed since the config cache was saved.
+  bool configCacheOutdated_ = false;
+
   ApplicationMenuConfig applicationMenuConfig_;
+
+  // Task and icon overrides.
+  OverrideConfig overrideConfig_;
+
+  std::shared_ptr<ConfigStamps> configStamps_ =
+      std::make_shared<ConfigStamps>();
+  QFileSystemWatcher configWatcher_;
+  QTimer configReloadTimer_;
+
+  friend class MultiDockModelTest;
 };
 
 }  // namespace ksmoothdock
@@ -18,22 +18,91 @@
 
 #include "multi_dock_model.h"
 
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
 #include <QFile>
+#include <QSignalSpy>
+#include <QStandardPaths>
 #include <QTemporaryDir>
 #include <QtTest>
 
+// Counts the heap allocations made through operator new in this test.
+static std::atomic<int> allocationCount(0);
+
+void* operator new(std::size_t size) {
+  ++allocationCount;
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
 namespace ksmoothdock {
 
 class MultiDockModelTest: public QObject {
   Q_OBJECT
 
  private slots:
+  void initTestCase() {
+    // Keeps the config caches out of the user's cache dir.
+    QStandardPaths::setTestModeEnabled(true);
+  }
+
   void load_noDock();
 
   void load_singleDock();
 
   void load_multipleDocks();
 
+  // Tests that the settings snapshots follow the setters and the config files.
+  void settingsSnapshot();
+
+  // Tests that reading the launcher configs doesn't allocate.
+  void dockLauncherConfigs_noAllocation();
+
+  // Tests that the launchers generation only changes with the launchers.
+  void dockLaunchersGeneration();
+
+  // Tests that saving the launchers only writes the changed launchers.
+  void syncDockLaunchers_incremental();
+
+  // Tests loading numbered launcher files without an index.
+  void loadDockLaunchers_noIndex();
+
+  // Tests that the settings and launchers are loaded from the config cache,
+  // without parsing the configs.
+  void load_configCache();
+
+  // Tests that the config cache isn't used after a config file has changed.
+  void load_configCacheOutdated();
+
+  // Tests that saving the appearance config only notifies the changes.
+  void saveAppearanceConfig_signals();
+
+  // Tests that a transaction syncs and notifies the changes once on commit.
+  void transaction();
+
+  // Tests that a dock cloned in a transaction has the source dock's deferred
+  // changes.
+  void cloneDock_transaction();
+
+  // Tests that the groups and entries removed from a config are removed from
+  // its file.
+  void writeConfig_removed();
+
+  // Tests that the settings are reloaded when the config files are changed
+  // outside of the model, but not after the model's own writes.
+  void reloadChangedConfigs();
+
+  // Compares loading from the config files and from the config cache.
+  void load_benchmark_data();
+  void load_benchmark();
+
  private:
   void createDockConfig(const QTemporaryDir& configDir, int fileId) {
     QFile dockConfig(configDir.path() + "/" +
@@ -68,6 +137,469 @@ void MultiDockModelTest::load_multipleDocks() {
   QCOMPARE(model.dockCount(), 3);
 }
 
+void MultiDockModelTest::settingsSnapshot() {
+  QTemporaryDir configDir;
+  QVERIFY(configDir.isValid());
+  createDockConfig(configDir, 1);
+
+  MultiDockModel model(configDir.path());
+  QCOMPARE(model.minIconSize(), kDefaultMinSize);
+  QCOMPARE(model.dockSettings(1).showPager, kDefaultShowPager);
+
+  const auto version = model.settingsVersion();
+  model.setMinIconSize(48);
+  model.setUse24HourClock(false);
+  model.setShowPager(1, true);
+  model.setVisibility(1, PanelVisibility::AutoHide);
+  QVERIFY(model.settingsVersion() > version);
+  QCOMPARE(model.appearanceSettings().minIconSize, 48);
+  QCOMPARE(model.minIconSize(), 48);
+  QVERIFY(!model.use24HourClock());
+  QVERIFY(model.dockSettings(1).showPager);
+  QCOMPARE(model.visibility(1), PanelVisibility::AutoHide);
+  model.saveAppearanceConfig();
+  model.saveDockConfig(1);
+  model.flushConfig();
+
+  MultiDockModel reloaded(configDir.path());
+  QCOMPARE(reloaded.minIconSize(), 48);
+  QVERIFY(!reloaded.use24HourClock());
+  QVERIFY(reloaded.showPager(1));
+  QCOMPARE(reloaded.visibility(1), PanelVisibility::AutoHide);
+
+  // Changed outside of the model.
+  reloaded.setMinIconSize(64);
+  reloaded.saveAppearanceConfig();
+  reloaded.flushConfig();
+  QCOMPARE(model.minIconSize(), 48);
+  model.reloadSettings();
+  QCOMPARE(model.minIconSize(), 64);
+}
+
+void MultiDockModelTest::dockLauncherConfigs_noAllocation() {
+  QTemporaryDir configDir;
+  QVERIFY(configDir.isValid());
+  createDockConfig(configDir, 1);
+  MultiDockModel model(configDir.path());
+  QVERIFY(!model.dockLauncherConfigs(1).empty());
+  model.flushConfig();
+
+  // What returning the launcher configs by value used to cost.
+  int count = allocationCount;
+  const std::vector<LauncherConfig> copy = model.dockLauncherConfigs(1);
+  const int copyAllocations = allocationCount - count;
+  QVERIFY(copyAllocations > 0);
+  QCOMPARE(copy.size(), model.dockLauncherConfigs(1).size());
+
+  count = allocationCount;
+  size_t launcherCount = 0;
+  for (int i = 0; i < 1000; ++i) {
+    launcherCount += model.dockLauncherConfigs(1).size();
+  }
+  QCOMPARE(allocationCount - count, 0);
+  QCOMPARE(launcherCount, 1000 * copy.size());
+}
+
+void MultiDockModelTest::dockLaunchersGeneration() {
+  QTemporaryDir configDir;
+  QVERIFY(configDir.isValid());
+  createDockConfig(configDir, 1);
+  createDockConfig(configDir, 2);
+  MultiDockModel model(configDir.path());
+
+  const auto generation = model.dockLaunchersGeneration(1);
+  const auto generation2 = model.dockLaunchersGeneration(2);
+  QVERIFY(generation != generation2);
+
+  // Unchanged.
+  const auto launchers = model.dockLauncherConfigs(1);
+  model.setDockLauncherConfigs(1, launchers);
+  QCOMPARE(model.dockLaunchersGeneration(1), generation);
+
+  model.addLauncher(1, LauncherConfig("Kate", "kate", "kate"));
+  const auto addedGeneration = model.dockLaunchersGeneration(1);
+  QVERIFY(addedGeneration != generation);
+  QCOMPARE(model.dockLaunchersGeneration(2), generation2);
+
+  model.setDockLauncherConfigs(1, launchers);
+  QVERIFY(model.dockLaunchersGeneration(1) != addedGeneration);
+  QCOMPARE(model.dockLauncherConfigs(1).size(), launchers.size());
+}
+
+void MultiDockModelTest::syncDockLaunchers_incremental() {
+  QTemporaryDir configDir;
+  QVERIFY(configDir.isValid());
+  createDockConfig(configDir, 1);
+  MultiDockModel model(configDir.path());
+  model.saveDockLauncherConfigs(1);
+  model.flushConfig();
+
+  const QString launchersPath = model.dockLaunchersPath(1);
+  QDir launchersDir(launchersPath);
+  const auto launchers = model.dockLauncherConfigs(1);
+  const QStringList index = ConfigHelper::readLaunchersIndex(launchersPath);
+  QCOMPARE(index.size(), static_cast<int>(launchers.size()));
+  const QStringList files = launchersDir.entryList({"*.desktop"}, QDir::Files,
+                                                   QDir::Name);
+  QCOMPARE(files.size(), index.size());
+
+  model.addLauncher(1, LauncherConfig("KWrite", "kwrite", "kwrite"));
+  model.flushConfig();
+  const QStringList newFiles = launchersDir.entryList({"*.desktop"}, QDir::Files,
+                                                      QDir::Name);
+  QCOMPARE(newFiles.size(), files.size() + 1);
+  for (const auto& file : files) {
+    QVERIFY(newFiles.contains(file));
+  }
+  QCOMPARE(ConfigHelper::readLaunchersIndex(launchersPath).size(), index.size() + 1);
+
+  model.removeLauncher(1, "kwrite");
+  model.flushConfig();
+  QCOMPARE(launchersDir.entryList({"*.desktop"}, QDir::Files, QDir::Name), files);
+  QCOMPARE(ConfigHelper::readLaunchersIndex(launchersPath), index);
+
+  // The order is kept.
+  MultiDockModel reloaded(configDir.path());
+  QVERIFY(reloaded.dockLauncherConfigs(1) == launchers);
+}
+
+void MultiDockModelTest::loadDockLaunchers_noIndex() {
+  QTemporaryDir configDir;
+  QVERIFY(configDir.isValid());
+  createDockConfig(configDir, 1);
+  const QString launchersPath =
+      configDir.path() + "/" + ConfigHelper::dockLaunchersDir(1);
+  QDir::root().mkpath(launchersPath);
+  LauncherConfig("Terminal", "utilities-terminal", "konsole")
+      .saveToFile(launchersPath + "/01 - Terminal.desktop");
+  LauncherConfig("File Manager", "system-file-manager", "dolphin")
+      .saveToFile(launchersPath + "/02 - File Manager.desktop");
+
+  MultiDockModel model(configDir.path());
+  QCOMPARE(static_cast<int>(model.dockLauncherConfigs(1).size()), 2);
+  QCOMPARE(model.dockLauncherConfigs(1)[0].command, QString("konsole"));
+  QCOMPARE(model.dockLauncherConfigs(1)[1].command, QString("dolphin"));
+
+  // Converted to the indexed layout on save.
+  model.saveDockLauncherConfigs(1);
+  model.flushConfig();
+  QCOMPARE(ConfigHelper::readLaunchersIndex(launchersPath).size(), 2);
+  QVERIFY(!QFile::exists(launchersPath + "/01 - Terminal.desktop"));
+  MultiDockModel reloaded(configDir.path());
+  QCOMPARE(reloaded.dockLauncherConfigs(1)[0].command, QString("konsole"));
+  QCOMPARE(reloaded.dockLauncherConfigs(1)[1].command, QString("dolphin"));
+}
+
+void MultiDockModelTest::load_configCache() {
+  QTemporaryDir configDir;
+  QVERIFY(configDir.isValid());
+  createDockConfig(configDir, 1);
+  createDockConfig(configDir, 2);
+  {
+    MultiDockModel model(configDir.path());
+    QVERIFY(model.appearanceConfig_ != nullptr);
+    model.setMaxIconSize(96);
+    model.setBackgroundColor(QColor(10, 20, 30, 40));
+    model.setApplicationMenuName("Start");
+    model.setClockFontScaleFactor(kSmallClockFontScaleFactor);
+    model.saveAppearanceConfig();
+    model.setPanelPosition(2, PanelPosition::Left);
+    model.setShowClock(2, true);
+    model.saveDockConfig(2);
+    model.addLauncher(1, LauncherConfig("KWrite", "kwrite", "kwrite"));
+  }
+  const QString cachePath = ConfigHelper(configDir.path()).configCachePath();
+  QVERIFY(QFile::exists(cachePath));
+
+  MultiDockModel cached(configDir.path());
+  QVERIFY(cached.appearanceConfig_ == nullptr);
+  QVERIFY(std::get<1>(cached.dockConfigs_[1]) == nullptr);
+  QVERIFY(std::get<1>(cached.dockConfigs_[2]) == nullptr);
+
+  QFile::remove(cachePath);
+  MultiDockModel parsed(configDir.path());
+  QVERIFY(parsed.appearanceConfig_ != nullptr);
+
+  QCOMPARE(cached.dockCount(), 2);
+  QCOMPARE(cached.maxIconSize(), 96);
+  QCOMPARE(cached.maxIconSize(), parsed.maxIconSize());
+  QCOMPARE(cached.minIconSize(), parsed.minIconSize());
+  QCOMPARE(cached.backgroundColor(), parsed.backgroundColor());
+  QCOMPARE(cached.applicationMenuName(), QString("Start"));
+  QCOMPARE(cached.clockFontScaleFactor(), parsed.clockFontScaleFactor());
+  QCOMPARE(cached.panelPosition(2), PanelPosition::Left);
+  QCOMPARE(cached.showClock(2), parsed.showClock(2));
+  QCOMPARE(cached.visibility(1), parsed.visibility(1));
+  QCOMPARE(cached.dockConfigPath(2), parsed.dockConfigPath(2));
+  QCOMPARE(cached.dockLaunchersPath(1), parsed.dockLaunchersPath(1));
+  QVERIFY(cached.dockLauncherConfigs(1) == parsed.dockLauncherConfigs(1));
+  QVERIFY(cached.dockLauncherConfigs(2) == parsed.dockLauncherConfigs(2));
+
+  // The configs are parsed when they are changed.
+  cached.setShowPager(1, true);
+  QVERIFY(std::get<1>(cached.dockConfigs_[1]) != nullptr);
+  QVERIFY(cached.showPager(1));
+  QCOMPARE(cached.panelPosition(1), parsed.panelPosition(1));
+}
+
+void MultiDockModelTest::load_configCacheOutdated() {
+  QTemporaryDir configDir;
+  QVERIFY(configDir.isValid());
+  createDockConfig(configDir, 1);
+  {
+    MultiDockModel model(configDir.path());
+    model.setMinIconSize(40);
+    model.saveAppearanceConfig();
+  }
+  {
+    MultiDockModel model(configDir.path());
+    QVERIFY(model.appearanceConfig_ == nullptr);
+    QCOMPARE(model.minIconSize(), 40);
+  }
+
+  // Changed outside of the model.
+  {
+    KConfig config(configDir.path() + "/" + ConfigHelper::kAppearanceConfig,
+                   KConfig::SimpleConfig);
+    KConfigGroup group(&config, "General");
+    group.writeEntry("minimumIconSize", 100);
+    config.sync();
+  }
+  createDockConfig(configDir, 2);
+
+  MultiDockModel model(configDir.path());
+  QCOMPARE(model.minIconSize(), 100);
+  QCOMPARE(model.dockCount(), 2);
+}
+
+void MultiDockModelTest::saveAppearanceConfig_signals() {
+  QTemporaryDir configDir;
+  QVERIFY(configDir.isValid());
+  createDockConfig(configDir, 1);
+  MultiDockModel model(configDir.path());
+  QSignalSpy repaintSpy(&model, SIGNAL(appearanceOutdated()));
+  QSignalSpy iconSizesSpy(&model, SIGNAL(iconSizesChanged()));
+  QSignalSpy colorsSpy(&model, SIGNAL(colorsChanged()));
+  QSignalSpy tooltipSpy(&model, SIGNAL(tooltipFontSizeChanged()));
+  QSignalSpy applicationMenuSpy(&model, SIGNAL(applicationMenuAppearanceChanged()));
+  QSignalSpy wallpapersSpy(&model, SIGNAL(wallpapersChanged()));
+  QSignalSpy reloadSpy(&model, SIGNAL(appearanceChanged()));
+  const auto signalCount = [&]() {
+    return repaintSpy.count() + iconSizesSpy.count() + colorsSpy.count() +
+        tooltipSpy.count() + applicationMenuSpy.count() + wallpapersSpy.count() +
+        reloadSpy.count();
+  };
+
+  // Unchanged.
+  model.setMinIconSize(model.minIconSize());
+  model.saveAppearanceConfig();
+  QCOMPARE(signalCount(), 0);
+
+  model.setTooltipFontSize(model.tooltipFontSize() + 1);
+  model.saveAppearanceConfig();
+  QCOMPARE(tooltipSpy.count(), 1);
+  QCOMPARE(signalCount(), 1);
+
+  model.setBorderColor(QColor("#123456"));
+  model.setShowBorder(!model.showBorder());
+  model.saveAppearanceConfig();
+  QCOMPARE(colorsSpy.count(), 1);
+  QCOMPARE(signalCount(), 2);
+
+  model.setMaxIconSize(model.maxIconSize() + 1);
+  model.setApplicationMenuName("Start");
+  model.saveAppearanceConfig();
+  QCOMPARE(iconSizesSpy.count(), 1);
+  QCOMPARE(applicationMenuSpy.count(), 1);
+  QCOMPARE(signalCount(), 4);
+
+  model.setWallpaper(1, 0, "/tmp/wallpaper.png");
+  model.setUse24HourClock(!model.use24HourClock());
+  model.saveAppearanceConfig();
+  QCOMPARE(wallpapersSpy.count(), 1);
+  QCOMPARE(repaintSpy.count(), 1);
+  QCOMPARE(signalCount(), 6);
+
+  // Changes the items, which supersedes the other changes.
+  model.setCurrentDesktopTasksOnly(!model.currentDesktopTasksOnly());
+  model.setSpacingFactor(model.spacingFactor() + 0.1);
+  model.saveAppearanceConfig();
+  QCOMPARE(reloadSpy.count(), 1);
+  QCOMPARE(signalCount(), 7);
+}
+
+void MultiDockModelTest::transaction() {
+  QTemporaryDir configDir;
+  QVERIFY(configDir.isValid());
+  createDockConfig(configDir, 1);
+  MultiDockModel model(configDir.path());
+  model.flushConfig();
+  QSignalSpy launchersSpy(&model, SIGNAL(dockLaunchersChanged(int)));
+  QSignalSpy iconSizesSpy(&model, SIGNAL(iconSizesChanged()));
+  QSignalSpy dockAddedSpy(&model, SIGNAL(dockAdded(int)));
+  const int writeCount = model.configWriter_.writeCount();
+  const auto launcherCount = model.dockLauncherConfigs(1).size() + 10;
+
+  model.beginTransaction();
+  for (int i = 0; i < 10; ++i) {
+    model.addLauncher(1, LauncherConfig(QString("Launcher %1").arg(i), "xterm",
+                                        QString("command%1").arg(i)));
+    model.saveDockLauncherConfigs(1);
+  }
+  model.setMinIconSize(model.minIconSize() + 1);
+  model.saveAppearanceConfig();
+  model.setMaxIconSize(model.maxIconSize() + 1);
+  model.saveAppearanceConfig();
+  // Nested.
+  model.addDock();
+  model.flushConfig();
+
+  QCOMPARE(model.configWriter_.writeCount(), writeCount);
+  QCOMPARE(launchersSpy.count(), 0);
+  QCOMPARE(iconSizesSpy.count(), 0);
+  QCOMPARE(dockAddedSpy.count(), 0);
+  QCOMPARE(model.dockCount(), 2);
+  QCOMPARE(model.dockLauncherConfigs(1).size(), launcherCount);
+
+  model.commit();
+  model.flushConfig();
+
+  // The appearance config, the launchers of the first dock, and the config
+  // and launchers of the new dock.
+  QCOMPARE(model.configWriter_.writeCount(), writeCount + 4);
+  QCOMPARE(launchersSpy.count(), 1);
+  QCOMPARE(launchersSpy.takeFirst().at(0).toInt(), 1);
+  QCOMPARE(iconSizesSpy.count(), 1);
+  QCOMPARE(dockAddedSpy.count(), 1);
+
+  MultiDockModel reloadedModel(configDir.path());
+  QCOMPARE(reloadedModel.dockCount(), 2);
+  QCOMPARE(reloadedModel.minIconSize(), model.minIconSize());
+  QCOMPARE(reloadedModel.maxIconSize(), model.maxIconSize());
+  QCOMPARE(reloadedModel.dockLauncherConfigs(1).size(), launcherCount);
+}
+
+void MultiDockModelTest::cloneDock_transaction() {
+  QTemporaryDir configDir;
+  QVERIFY(configDir.isValid());
+  createDockConfig(configDir, 1);
+  MultiDockModel model(configDir.path());
+
+  model.beginTransaction();
+  model.setShowClock(1, true);
+  model.saveDockConfig(1);
+  model.addLauncher(1, LauncherConfig("Launcher", "xterm", "command"));
+  model.saveDockLauncherConfigs(1);
+  model.cloneDock(1, PanelPosition::Top, 0);
+  model.commit();
+
+  QCOMPARE(model.dockCount(), 2);
+  QCOMPARE(model.panelPosition(2), PanelPosition::Top);
+  QVERIFY(model.showClock(2));
+  QVERIFY(model.dockLauncherConfigs(2) == model.dockLauncherConfigs(1));
+}
+
+void MultiDockModelTest::writeConfig_removed() {
+  QTemporaryDir configDir;
+  QVERIFY(configDir.isValid());
+  createDockConfig(configDir, 1);
+  MultiDockModel model(configDir.path());
+  model.setMinIconSize(48);
+  model.setTooltipFontSize(24);
+  model.setWallpaper(1, 0, "/tmp/wallpaper.png");
+  model.saveAppearanceConfig();
+  model.flushConfig();
+
+  model.appearanceConfig()->deleteGroup("Pager");
+  KConfigGroup(model.appearanceConfig(), "General")
+      .deleteEntry("minimumIconSize");
+  model.saveAppearanceConfig();
+  model.flushConfig();
+
+  KConfig file(configDir.path() + "/" + ConfigHelper::kAppearanceConfig,
+               KConfig::SimpleConfig);
+  QVERIFY(!file.hasGroup("Pager"));
+  KConfigGroup general(&file, "General");
+  QVERIFY(!general.hasKey("minimumIconSize"));
+  QCOMPARE(general.readEntry("tooltipFontSize", 0), 24);
+}
+
+void MultiDockModelTest::reloadChangedConfigs() {
+  QTemporaryDir configDir;
+  QVERIFY(configDir.isValid());
+  createDockConfig(configDir, 1);
+  MultiDockModel model(configDir.path());
+  QSignalSpy iconSizesSpy(&model, SIGNAL(iconSizesChanged()));
+  QSignalSpy reloadSpy(&model, SIGNAL(appearanceChanged()));
+
+  model.setMinIconSize(48);
+  model.saveAppearanceConfig();
+  model.setShowPager(1, !model.showPager(1));
+  model.saveDockConfig(1);
+  model.flushConfig();
+  const auto version = model.settingsVersion();
+  QTest::qWait(2 * MultiDockModel::kConfigReloadDelay);
+  QCOMPARE(model.settingsVersion(), version);
+  QCOMPARE(iconSizesSpy.count(), 1);
+  QCOMPARE(reloadSpy.count(), 0);
+
+  // Changed outside of the model.
+  {
+    KConfig config(configDir.path() + "/" + ConfigHelper::kAppearanceConfig,
+                   KConfig::SimpleConfig);
+    KConfigGroup group(&config, "General");
+    group.writeEntry("minimumIconSize", 100);
+    config.sync();
+  }
+  QTRY_COMPARE(model.minIconSize(), 100);
+  QCOMPARE(iconSizesSpy.count(), 2);
+  QCOMPARE(reloadSpy.count(), 0);
+
+  const bool showClock = !model.showClock(1);
+  {
+    KConfig config(configDir.path() + "/" + ConfigHelper::dockConfigFile(1),
+                   KConfig::SimpleConfig);
+    KConfigGroup group(&config, "General");
+    group.writeEntry("showClock", showClock);
+    config.sync();
+  }
+  QTRY_COMPARE(model.showClock(1), showClock);
+  QCOMPARE(reloadSpy.count(), 1);
+  QCOMPARE(model.minIconSize(), 100);
+}
+
+void MultiDockModelTest::load_benchmark_data() {
+  QTest::addColumn<bool>("useCache");
+  // Includes saving the config cache again.
+  QTest::newRow("config files") << false;
+  QTest::newRow("config cache") << true;
+}
+
+void MultiDockModelTest::load_benchmark() {
+  QFETCH(bool, useCache);
+  QTemporaryDir configDir;
+  QVERIFY(configDir.isValid());
+  for (int fileId = 1; fileId <= 3; ++fileId) {
+    createDockConfig(configDir, fileId);
+  }
+  {
+    MultiDockModel model(configDir.path());
+    for (int dockId = 1; dockId <= 3; ++dockId) {
+      model.saveDockConfig(dockId);
+      model.saveDockLauncherConfigs(dockId);
+    }
+    model.saveAppearanceConfig();
+  }
+  const QString cachePath = ConfigHelper(configDir.path()).configCachePath();
+
+  QBENCHMARK {
+    if (!useCache) {
+      QFile::remove(cachePath);
+    }
+    MultiDockModel model(configDir.path());
+  }
+}
+
 }  // namespace ksmoothdock
 
 QTEST_MAIN(ksmoothdock::MultiDockModelTest)
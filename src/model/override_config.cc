@@ -0,0 +1,165 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2019 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "override_config.h"
+
+#include <iostream>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QStringList>
+#include <QTextStream>
+
+namespace ksmoothdock {
+
+OverrideConfig::OverrideConfig(const QString& settingsPath,
+                               const QString& iconOverrideRulesPath)
+    : settingsPath_(settingsPath),
+      iconOverrideRulesPath_(iconOverrideRulesPath) {
+  loadSettings();
+  loadIconOverrideRules();
+  updateWatchedPaths();
+  connect(&fileWatcher_, SIGNAL(directoryChanged(const QString&)),
+          this, SLOT(reload()));
+  connect(&fileWatcher_, SIGNAL(fileChanged(const QString&)),
+          this, SLOT(reload()));
+}
+
+QString OverrideConfig::iconForTask(const QString& taskCommand) const {
+  const auto cached = iconRuleCache_.constFind(taskCommand);
+  if (cached != iconRuleCache_.constEnd()) {
+    return cached.value();
+  }
+
+  QString icon = exactIconRules_.value(taskCommand);
+  if (icon.isEmpty()) {
+    for (const auto& rule : regexIconRules_) {
+      if (rule.first.match(taskCommand).hasMatch()) {
+        icon = rule.second;
+        break;
+      }
+    }
+  }
+  iconRuleCache_.insert(taskCommand, icon);
+  return icon;
+}
+
+void OverrideConfig::reload() {
+  loadSettings();
+  loadIconOverrideRules();
+  updateWatchedPaths();
+  emit configChanged();
+}
+
+void OverrideConfig::loadSettings() {
+  taskOverrides_.clear();
+  iconOverrides_.clear();
+  iconPath_.clear();
+  if (settingsPath_.isEmpty()) {
+    return;
+  }
+
+  QSettings settings(settingsPath_, QSettings::IniFormat);
+  settings.beginGroup("taskoverrides");
+  for (const auto& key : settings.childKeys()) {
+    taskOverrides_.insert(key, settings.value(key).toString());
+  }
+  settings.endGroup();
+
+  settings.beginGroup("iconoverrides");
+  for (const auto& key : settings.childKeys()) {
+    iconOverrides_.insert(key, settings.value(key).toString());
+  }
+  settings.endGroup();
+
+  iconPath_ = settings.value("global/iconPath").toString();
+}
+
+void OverrideConfig::loadIconOverrideRules() {
+  exactIconRules_.clear();
+  regexIconRules_.clear();
+  iconRuleCache_.clear();
+
+  QFile file(iconOverrideRulesPath_);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    return;
+  }
+
+  QTextStream in(&file);
+  int lineNumber = 0;
+  while (!in.atEnd()) {
+    const QString line = in.readLine().trimmed();
+    ++lineNumber;
+    if (line.isEmpty() || line.startsWith('#')) {
+      continue;
+    }
+
+    // The separator is the last '=', as regular expressions may contain '='.
+    const int separator = line.lastIndexOf('=');
+    if (separator <= 0) {
+      std::cerr << "Invalid icon override rule at line " << lineNumber << ": "
+                << line.toStdString() << std::endl;
+      continue;
+    }
+
+    const QString pattern = line.left(separator).trimmed();
+    const QString icon = line.mid(separator + 1).trimmed();
+    if (pattern.size() > 2 && pattern.startsWith('/') && pattern.endsWith('/')) {
+      QRegularExpression regex(pattern.mid(1, pattern.size() - 2));
+      if (!regex.isValid()) {
+        std::cerr << "Invalid regular expression at line " << lineNumber << ": "
+                  << regex.errorString().toStdString() << std::endl;
+        continue;
+      }
+      regex.optimize();
+      regexIconRules_.emplace_back(regex, icon);
+    } else if (!exactIconRules_.contains(pattern)) {
+      exactIconRules_.insert(pattern, icon);
+    }
+  }
+}
+
+void OverrideConfig::updateWatchedPaths() {
+  QStringList paths;
+  for (const auto& path : {settingsPath_, iconOverrideRulesPath_}) {
+    if (path.isEmpty()) {
+      continue;
+    }
+
+    const QFileInfo fileInfo(path);
+    const QString watchedPath = fileInfo.exists() ? path : fileInfo.absolutePath();
+    if (QFileInfo::exists(watchedPath) && !paths.contains(watchedPath)) {
+      paths << watchedPath;
+    }
+  }
+
+  const QStringList watchedPaths = fileWatcher_.files() + fileWatcher_.directories();
+  for (const auto& path : watchedPaths) {
+    if (!paths.contains(path)) {
+      fileWatcher_.removePath(path);
+    }
+  }
+  for (const auto& path : paths) {
+    if (!watchedPaths.contains(path)) {
+      fileWatcher_.addPath(path);
+    }
+  }
+}
+
+}  // namespace ksmoothdock
@@ -0,0 +1,108 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2019 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KSMOOTHDOCK_OVERRIDE_CONFIG_H_
+#define KSMOOTHDOCK_OVERRIDE_CONFIG_H_
+
+#include <utility>
+#include <vector>
+
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QObject>
+#include <QRegularExpression>
+#include <QString>
+
+namespace ksmoothdock {
+
+// Task name and icon overrides.
+//
+// They are parsed once from the settings file and the icon override rules
+// file into hash maps, and re-parsed when either file changes, so that
+// look-ups don't touch the files.
+//
+// Settings file (INI) sections used:
+//   [taskoverrides]  <window class>=<program name>
+//   [iconoverrides]  <item label>=<icon name>
+//   [global]         iconPath=<dir of the PNG icons>
+//
+// Icon override rules file, one rule per line. Exact rules take precedence,
+// then regular expression rules are tried in order:
+//   # comment
+//   <window class name>=<icon name>
+//   /<regular expression>/=<icon name>
+class OverrideConfig : public QObject {
+  Q_OBJECT
+
+ public:
+  OverrideConfig(const QString& settingsPath, const QString& iconOverrideRulesPath);
+  ~OverrideConfig() = default;
+
+  // Gets the overridden program name for a window class, or an empty string
+  // if there is no override.
+  QString taskOverride(const QString& program) const {
+    return taskOverrides_.value(program);
+  }
+
+  // Gets the overridden icon name for an item label, or an empty string
+  // if there is no override.
+  QString iconOverride(const QString& label) const {
+    return iconOverrides_.value(label);
+  }
+
+  const QString& iconPath() const { return iconPath_; }
+
+  // Gets the icon name from the icon override rules for a window class name,
+  // or an empty string if no rule matches.
+  QString iconForTask(const QString& taskCommand) const;
+
+ signals:
+  void configChanged();
+
+ public slots:
+  void reload();
+
+ private:
+  void loadSettings();
+  void loadIconOverrideRules();
+
+  // (Re-)watches the files. Files replaced by editors drop their watches,
+  // and files that don't exist yet are watched via their directories.
+  void updateWatchedPaths();
+
+  const QString settingsPath_;
+  const QString iconOverrideRulesPath_;
+
+  QHash<QString, QString> taskOverrides_;
+  QHash<QString, QString> iconOverrides_;
+  QString iconPath_;
+
+  // Compiled icon override rules.
+  QHash<QString, QString> exactIconRules_;
+  std::vector<std::pair<QRegularExpression, QString>> regexIconRules_;
+  // Memoized results of iconForTask(), including misses.
+  mutable QHash<QString, QString> iconRuleCache_;
+
+  QFileSystemWatcher fileWatcher_;
+
+  friend class OverrideConfigTest;
+};
+
+}  // namespace ksmoothdock
+
+#endif  // KSMOOTHDOCK_OVERRIDE_CONFIG_H_
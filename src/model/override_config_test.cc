@@ -0,0 +1,129 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2019 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "override_config.h"
+
+#include <memory>
+
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QTextStream>
+
+namespace ksmoothdock {
+
+class OverrideConfigTest: public QObject {
+  Q_OBJECT
+
+ private slots:
+  void init() {
+    configDir_ = std::make_unique<QTemporaryDir>();
+    settingsPath_ = configDir_->filePath("unicorndock.ini");
+    rulesPath_ = configDir_->filePath("icon_override.rules");
+  }
+
+  void cleanup() {
+    config_.reset();
+    configDir_.reset();
+  }
+
+  // Tests loading the overrides from the settings file.
+  void loadSettings();
+
+  // Tests matching the icon override rules.
+  void iconOverrideRules();
+
+  // Tests that the overrides are reloaded when the files change.
+  void reloadOnChange();
+
+ private:
+  void writeFile(const QString& path, const QString& content) {
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text));
+    QTextStream out(&file);
+    out << content;
+  }
+
+  void createConfig() {
+    config_ = std::make_unique<OverrideConfig>(settingsPath_, rulesPath_);
+  }
+
+  std::unique_ptr<QTemporaryDir> configDir_;
+  QString settingsPath_;
+  QString rulesPath_;
+  std::unique_ptr<OverrideConfig> config_;
+};
+
+void OverrideConfigTest::loadSettings() {
+  writeFile(settingsPath_,
+            "[global]\n"
+            "iconPath=/icons\n"
+            "[taskoverrides]\n"
+            "VirtualBox%20Machine=VirtualBox\n"
+            "[iconoverrides]\n"
+            "Terminal=konsole\n");
+  createConfig();
+
+  QCOMPARE(config_->iconPath(), QString("/icons"));
+  QCOMPARE(config_->taskOverride("VirtualBox Machine"), QString("VirtualBox"));
+  QCOMPARE(config_->taskOverride("Dolphin"), QString());
+  QCOMPARE(config_->iconOverride("Terminal"), QString("konsole"));
+  QCOMPARE(config_->iconOverride("Files"), QString());
+}
+
+void OverrideConfigTest::iconOverrideRules() {
+  writeFile(rulesPath_,
+            "# Comment\n"
+            "\n"
+            "gimp-2.10=gimp\n"
+            "/^libreoffice-.*$/=libreoffice\n"
+            "/^lib.*/=library\n"
+            "invalid rule\n"
+            "/(/=broken\n");
+  createConfig();
+
+  QCOMPARE(config_->iconForTask("gimp-2.10"), QString("gimp"));
+  QCOMPARE(config_->iconForTask("libreoffice-writer"), QString("libreoffice"));
+  QCOMPARE(config_->iconForTask("libfoo"), QString("library"));
+  QCOMPARE(config_->iconForTask("dolphin"), QString());
+  // Memoized, including misses.
+  QCOMPARE(config_->iconRuleCache_.size(), 4);
+  QCOMPARE(config_->iconForTask("dolphin"), QString());
+  QCOMPARE(config_->regexIconRules_.size(), static_cast<size_t>(2));
+}
+
+void OverrideConfigTest::reloadOnChange() {
+  createConfig();
+  QCOMPARE(config_->iconForTask("gimp-2.10"), QString());
+
+  QSignalSpy spy(config_.get(), SIGNAL(configChanged()));
+  writeFile(rulesPath_, "gimp-2.10=gimp\n");
+  QTRY_VERIFY(spy.count() > 0);
+  QCOMPARE(config_->iconForTask("gimp-2.10"), QString("gimp"));
+
+  spy.clear();
+  writeFile(rulesPath_, "gimp-2.10=gimp-new\n");
+  QTRY_VERIFY(spy.count() > 0);
+  QCOMPARE(config_->iconForTask("gimp-2.10"), QString("gimp-new"));
+}
+
+}  // namespace ksmoothdock
+
+QTEST_MAIN(ksmoothdock::OverrideConfigTest)
+#include "override_config_test.moc"
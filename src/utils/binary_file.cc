@@ -0,0 +1,94 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2019 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "binary_file.h"
+
+#include <limits>
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+namespace ksmoothdock {
+
+void fileStamp(const QString& path, qint64* modified, qint64* size) {
+  const QFileInfo info(path);
+  if (!info.exists()) {
+    *modified = -1;
+    *size = -1;
+    return;
+  }
+  *modified = info.lastModified().toMSecsSinceEpoch();
+  *size = info.size();
+}
+
+bool readCount(QDataStream& in, int fileSize, quint32* count) {
+  in >> *count;
+  return in.status() == QDataStream::Ok &&
+      *count <= static_cast<quint32>(fileSize);
+}
+
+bool readBinaryFile(const QString& path,
+                    const std::function<bool(QDataStream& in, int fileSize)>&
+                        read) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly) || file.size() == 0 ||
+      file.size() > std::numeric_limits<int>::max()) {
+    return false;
+  }
+  const int fileSize = static_cast<int>(file.size());
+  uchar* data = file.map(0, fileSize);
+  if (data == nullptr) {
+    return false;
+  }
+
+  bool loaded = false;
+  {
+    const QByteArray bytes = QByteArray::fromRawData(
+        reinterpret_cast<const char*>(data), fileSize);
+    QDataStream in(bytes);
+    in.setVersion(kBinaryFileStreamVersion);
+    loaded = read(in, fileSize);
+  }
+  file.unmap(data);
+  return loaded;
+}
+
+bool writeBinaryFile(const QString& path,
+                     const std::function<void(QDataStream& out)>& write) {
+  QDir::root().mkpath(QFileInfo(path).path());
+  QSaveFile file(path);
+  if (!file.open(QIODevice::WriteOnly)) {
+    return false;
+  }
+
+  QDataStream out(&file);
+  out.setVersion(kBinaryFileStreamVersion);
+  write(out);
+
+  if (out.status() != QDataStream::Ok) {
+    file.cancelWriting();
+    return false;
+  }
+  return file.commit();
+}
+
+}  // namespace ksmoothdock
@@ -0,0 +1,57 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2019 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KSMOOTHDOCK_BINARY_FILE_H_
+#define KSMOOTHDOCK_BINARY_FILE_H_
+
+#include <functional>
+
+#include <QDataStream>
+#include <QString>
+
+namespace ksmoothdock {
+
+// Helpers for the binary caches and indexes, which are read from a
+// memory-mapped file and saved atomically.
+
+constexpr QDataStream::Version kBinaryFileStreamVersion = QDataStream::Qt_5_11;
+
+// Gets the last modification time and the size of a file or directory, or -1
+// if it doesn't exist.
+void fileStamp(const QString& path, qint64* modified, qint64* size);
+
+// Reads an element count, rejecting counts that can't fit in a file of
+// fileSize bytes so that an invalid file can't cause a huge allocation.
+bool readCount(QDataStream& in, int fileSize, quint32* count);
+
+// Maps a binary file into memory and reads it with the given function.
+// Returns false if the file doesn't exist, is empty or too large, or if the
+// function returns false. The data must be copied out of the stream before
+// the function returns.
+bool readBinaryFile(const QString& path,
+                    const std::function<bool(QDataStream& in, int fileSize)>&
+                        read);
+
+// Writes a binary file atomically with the given function, creating its
+// parent directories if needed. The file is left unchanged if writing fails.
+bool writeBinaryFile(const QString& path,
+                     const std::function<void(QDataStream& out)>& write);
+
+}  // namespace ksmoothdock
+
+#endif  // KSMOOTHDOCK_BINARY_FILE_H_
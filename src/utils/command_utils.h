@@ -71,6 +71,18 @@ inline bool areTheSameCommand(const QString& appTaskCommand, const QString& task
   return appTaskCommand == taskCommand;
 }
 
+// Normalizes a task command so that commands considered the same by
+// areTheSameCommand() map to the same key, e.g. for hash look-ups.
+inline QString normalizeTaskCommand(const QString& taskCommand) {
+  if (taskCommand == "Navigator" || taskCommand == "firefox-esr") {
+    return "firefox";
+  }
+  if (taskCommand == "Mail") {
+    return "thunderbird";
+  }
+  return taskCommand;
+}
+
 }  // namespace ksmoothdock
 
 #endif  // KSMOOTHDOCK_COMMAND_UTILS_H_
@@ -0,0 +1,406 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2019 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "desktop_file_parser.h"
+
+#include <cstring>
+
+#include <QFile>
+#include <QLocale>
+
+namespace ksmoothdock {
+
+namespace {
+
+// The keys that are read, as indices into the values.
+enum Key {
+  kName, kGenericName, kIcon, kExec, kCategories, kStartupWMClass, kNoDisplay,
+  kHidden, kOnlyShowIn, kNotShowIn, kNumKeys
+};
+
+const char* const kKeyNames[kNumKeys] = {
+  "Name", "GenericName", "Icon", "Exec", "Categories", "StartupWMClass",
+  "NoDisplay", "Hidden", "OnlyShowIn", "NotShowIn"
+};
+
+constexpr char kGroup[] = "[Desktop Entry]";
+constexpr int kGroupSize = sizeof(kGroup) - 1;
+
+// How well the locale of a key matches ours. The locales that match are
+// numbered from 1 up.
+constexpr int kNoMatch = -1;
+constexpr int kUnlocalized = 0;
+
+// A raw value in the file, how well its locale matches ours, and its KConfig
+// options.
+struct Value {
+  const char* begin = nullptr;
+  const char* end = nullptr;
+  int match = kNoMatch;
+  bool expand = false;
+  bool immutable = false;
+};
+
+int findKey(const char* key, int size) {
+  for (int i = 0; i < kNumKeys; ++i) {
+    if (std::strlen(kKeyNames[i]) == static_cast<size_t>(size) &&
+        std::memcmp(kKeyNames[i], key, size) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+const char* lastIndexOf(const char* begin, const char* end, char c) {
+  for (const char* p = end; p > begin; --p) {
+    if (p[-1] == c) {
+      return p - 1;
+    }
+  }
+  return nullptr;
+}
+
+inline bool isSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+void trim(const char** begin, const char** end) {
+  while (*begin < *end && isSpace(**begin)) {
+    ++*begin;
+  }
+  while (*end > *begin && isSpace((*end)[-1])) {
+    --*end;
+  }
+}
+
+int hexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+QString decodeValue(const Value& value) {
+  const int size = static_cast<int>(value.end - value.begin);
+  if (std::memchr(value.begin, '\\', size) == nullptr) {
+    return QString::fromUtf8(value.begin, size);
+  }
+
+  QByteArray decoded;
+  decoded.reserve(size);
+  for (const char* p = value.begin; p < value.end; ++p) {
+    if (*p != '\\' || p + 1 == value.end) {
+      decoded.append(*p);
+      continue;
+    }
+    switch (*++p) {
+      case 's':
+        decoded.append(' ');
+        break;
+      case 't':
+        decoded.append('\t');
+        break;
+      case 'n':
+        decoded.append('\n');
+        break;
+      case 'r':
+        decoded.append('\r');
+        break;
+      case '\\':
+        decoded.append('\\');
+        break;
+      case 'x':
+        if (value.end - p > 2 && hexValue(p[1]) >= 0 && hexValue(p[2]) >= 0) {
+          decoded.append(static_cast<char>(hexValue(p[1]) * 16 +
+                                           hexValue(p[2])));
+          p += 2;
+        } else {
+          decoded.append("\\x");
+        }
+        break;
+      default:
+        // Other escapes, e.g. \; in lists, are kept as they are.
+        decoded.append('\\').append(*p);
+    }
+  }
+  return QString::fromUtf8(decoded);
+}
+
+// As KConfig does for [$e] values: $VAR and ${VAR} are replaced by the
+// environment variable, which is empty if not set, and $$ by $.
+QString expandValue(const QString& value) {
+  QString expanded = value;
+  int dollar = expanded.indexOf('$');
+  while (dollar >= 0 && dollar + 1 < expanded.size()) {
+    if (expanded[dollar + 1] == '$') {
+      expanded.remove(dollar, 1);
+      dollar = expanded.indexOf('$', dollar + 1);
+      continue;
+    }
+
+    int end;
+    QString name;
+    if (expanded[dollar + 1] == '{') {
+      const int close = expanded.indexOf('}', dollar + 2);
+      end = (close >= 0) ? close + 1 : expanded.size();
+      name = expanded.mid(dollar + 2,
+                          ((close >= 0) ? close : expanded.size()) - dollar - 2);
+    } else {
+      end = dollar + 1;
+      while (end < expanded.size() &&
+             (expanded[end].isLetterOrNumber() || expanded[end] == '_')) {
+        ++end;
+      }
+      name = expanded.mid(dollar + 1, end - dollar - 1);
+    }
+    if (name.isEmpty()) {
+      dollar = expanded.indexOf('$', end);
+      continue;
+    }
+    const QString variable = QString::fromLocal8Bit(qgetenv(name.toLatin1()));
+    expanded.replace(dollar, end - dollar, variable);
+    dollar = expanded.indexOf('$', dollar + variable.size());
+  }
+  return expanded;
+}
+
+// As KConfigGroup::readEntry() for bools: anything but false, no, off and 0
+// is true.
+bool toBool(const QString& value) {
+  return !value.isEmpty() &&
+      value.compare("false", Qt::CaseInsensitive) != 0 &&
+      value.compare("no", Qt::CaseInsensitive) != 0 &&
+      value.compare("off", Qt::CaseInsensitive) != 0 &&
+      value != "0";
+}
+
+}  // namespace
+
+DesktopFileParser::DesktopFileParser(const QString& locale) {
+  QByteArray name = locale.toUtf8();
+  const int at = name.indexOf('@');
+  const QByteArray modifier = (at >= 0) ? name.mid(at) : QByteArray();
+  name.truncate(at >= 0 ? at : name.size());
+  const int dot = name.indexOf('.');
+  if (dot >= 0) {
+    name.truncate(dot);
+  }
+  const int underscore = name.indexOf('_');
+  const QByteArray language = name.left(underscore);
+  if (language.isEmpty()) {
+    return;
+  }
+
+  locales_.push_back(language);
+  if (!modifier.isEmpty()) {
+    locales_.push_back(language + modifier);
+  }
+  if (underscore >= 0) {
+    locales_.push_back(name);
+    if (!modifier.isEmpty()) {
+      locales_.push_back(name + modifier);
+    }
+  }
+}
+
+/* static */ QString DesktopFileParser::defaultLocale() {
+  for (const char* variable : {"LC_ALL", "LC_MESSAGES", "LANG"}) {
+    QString locale = QString::fromLocal8Bit(qgetenv(variable));
+    if (locale.isEmpty()) {
+      continue;
+    }
+    if (locale == "C" || locale == "POSIX") {
+      break;
+    }
+    const int dot = locale.indexOf('.');
+    if (dot >= 0) {
+      const int at = locale.indexOf('@', dot);
+      locale.remove(dot, (at >= 0 ? at : locale.size()) - dot);
+    }
+    return locale;
+  }
+  return QLocale().name();
+}
+
+bool DesktopFileParser::parse(const QString& path,
+                              DesktopFileEntry* entry) const {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+
+  const qint64 size = file.size();
+  uchar* data = (size > 0) ? file.map(0, size) : nullptr;
+  if (data == nullptr) {
+    // Empty, or not mappable.
+    const QByteArray contents = file.readAll();
+    parse(contents.constData(), contents.size(), entry);
+    return true;
+  }
+  parse(reinterpret_cast<const char*>(data), size, entry);
+  file.unmap(data);
+  return true;
+}
+
+void DesktopFileParser::parse(const char* data, qint64 size,
+                              DesktopFileEntry* entry) const {
+  Value values[kNumKeys];
+  bool inGroup = false;
+  const char* const end = data + size;
+  const char* next = data;
+  while (next < end) {
+    const char* lineEnd =
+        static_cast<const char*>(std::memchr(next, '\n', end - next));
+    if (lineEnd == nullptr) {
+      lineEnd = end;
+    }
+    const char* begin = next;
+    next = (lineEnd < end) ? lineEnd + 1 : end;
+    trim(&begin, &lineEnd);
+    if (begin == lineEnd || *begin == '#') {
+      continue;
+    }
+
+    if (*begin == '[') {
+      if (inGroup) {
+        // The rest of the file is about the other groups, e.g. actions.
+        break;
+      }
+      inGroup = (lineEnd - begin == kGroupSize) &&
+          std::memcmp(begin, kGroup, kGroupSize) == 0;
+      continue;
+    }
+    if (!inGroup) {
+      continue;
+    }
+
+    const char* equals =
+        static_cast<const char*>(std::memchr(begin, '=', lineEnd - begin));
+    if (equals == nullptr) {
+      continue;
+    }
+    const char* keyEnd = equals;
+    trim(&begin, &keyEnd);
+    // As KConfig: the [$options] and [locale] groups after the key are
+    // removed from the last one, in any order.
+    const char* locale = nullptr;
+    int localeSize = 0;
+    bool expand = false;
+    bool immutable = false;
+    bool deleted = false;
+    bool valid = true;
+    const char* bracket = nullptr;
+    while (valid && !deleted &&
+           (bracket = lastIndexOf(begin, keyEnd, '[')) != nullptr) {
+      const char* close = static_cast<const char*>(
+          std::memchr(bracket, ']', keyEnd - bracket));
+      if (close == nullptr) {
+        valid = false;
+      } else if (close > bracket + 1 && bracket[1] == '$') {
+        for (const char* option = bracket + 2; option < close; ++option) {
+          expand |= *option == 'e';
+          immutable |= *option == 'i';
+          deleted |= *option == 'd';
+        }
+      } else if (locale != nullptr) {
+        // More than one locale.
+        valid = false;
+      } else {
+        locale = bracket + 1;
+        localeSize = static_cast<int>(close - locale);
+      }
+      keyEnd = bracket;
+    }
+    if (!valid) {
+      continue;
+    }
+    if (deleted) {
+      // KConfig deletes the unlocalized key, or a key such as "Key[locale]"
+      // that no one reads if the locale comes first.
+      if (std::memchr(begin, '[', keyEnd - begin) != nullptr) {
+        continue;
+      }
+      localeSize = 0;
+    }
+
+    int match = kUnlocalized;
+    if (localeSize > 0) {
+      match = localeMatch(locale, localeSize);
+      if (match == kNoMatch) {
+        continue;
+      }
+    }
+
+    const int key = findKey(begin, static_cast<int>(keyEnd - begin));
+    if (key < 0 || match < values[key].match ||
+        (match == values[key].match && values[key].immutable)) {
+      continue;
+    }
+    Value& value = values[key];
+    value.match = match;
+    value.immutable = immutable;
+    if (deleted) {
+      value.begin = value.end = nullptr;
+      value.expand = false;
+      continue;
+    }
+    value.begin = equals + 1;
+    value.end = lineEnd;
+    trim(&value.begin, &value.end);
+    value.expand = expand;
+  }
+
+  const auto readString = [&values](Key key) {
+    const Value& value = values[key];
+    if (value.begin == nullptr) {
+      return QString();
+    }
+    return value.expand ? expandValue(decodeValue(value)) : decodeValue(value);
+  };
+  entry->name = readString(kName);
+  entry->genericName = readString(kGenericName);
+  entry->icon = readString(kIcon);
+  entry->exec = readString(kExec);
+  entry->categories =
+      readString(kCategories).split(';', QString::SkipEmptyParts);
+  entry->startupWMClass = readString(kStartupWMClass);
+  entry->noDisplay = toBool(readString(kNoDisplay)) ||
+      (values[kOnlyShowIn].begin != nullptr &&
+       !readString(kOnlyShowIn).split(';').contains("KDE")) ||
+      readString(kNotShowIn).split(';').contains("KDE");
+  entry->hidden = readString(kHidden).toLower() == "true";
+}
+
+int DesktopFileParser::localeMatch(const char* locale, int size) const {
+  for (int i = static_cast<int>(locales_.size()) - 1; i >= 0; --i) {
+    if (size == locales_[i].size() &&
+        std::memcmp(locale, locales_[i].constData(), size) == 0) {
+      return i + 1;
+    }
+  }
+  return kNoMatch;
+}
+
+}  // namespace ksmoothdock
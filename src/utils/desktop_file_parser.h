@@ -0,0 +1,89 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2019 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KSMOOTHDOCK_DESKTOP_FILE_PARSER_H_
+#define KSMOOTHDOCK_DESKTOP_FILE_PARSER_H_
+
+#include <vector>
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+namespace ksmoothdock {
+
+// The keys of the [Desktop Entry] group of a desktop file that the dock uses.
+struct DesktopFileEntry {
+  QString name;
+  QString genericName;
+  QString icon;
+  // The command with its field codes, e.g. 'chrome %U'.
+  QString exec;
+  QStringList categories;
+  QString startupWMClass;
+  // As KDesktopFile::noDisplay(): NoDisplay is set, or OnlyShowIn/NotShowIn
+  // exclude KDE.
+  bool noDisplay = false;
+  bool hidden = false;
+};
+
+// Single-pass parser of the [Desktop Entry] group of desktop files.
+//
+// Unlike KDesktopFile, it doesn't build a map of all the groups and entries:
+// it reads the mapped file once, skips the other groups and stops after the
+// [Desktop Entry] group, and only decodes the values of the keys above.
+//
+// Values are read as KConfig does: trimmed, with the \s, \t, \n, \r, \\ and
+// \xHH escapes decoded, the last one winning for duplicate keys. The KConfig
+// options after a key are honored: [$e] expands the environment variables
+// in the value, [$i] makes it immune to later duplicates and [$d] deletes
+// it. Localized values, e.g. Name[de_DE], are chosen as in the desktop entry
+// spec: the one for lang_COUNTRY@MODIFIER, then lang_COUNTRY, then
+// lang@MODIFIER, then lang, then the unlocalized one.
+//
+// It is stateless after construction, so it can be used from several threads.
+class DesktopFileParser {
+ public:
+  // The locale name is in the form lang_COUNTRY.ENCODING@MODIFIER, e.g.
+  // 'de_DE' or 'sr_RS.UTF-8@latin', where all but lang are optional.
+  explicit DesktopFileParser(const QString& locale = defaultLocale());
+
+  // The locale of the messages, from the environment as in the desktop entry
+  // spec, without the encoding. Unlike QLocale::name(), it keeps the
+  // modifier, e.g. 'sr_RS@latin'.
+  static QString defaultLocale();
+
+  // Parses a desktop file. Returns false if it can't be read.
+  bool parse(const QString& path, DesktopFileEntry* entry) const;
+
+  // Parses the contents of a desktop file, in UTF-8.
+  void parse(const char* data, qint64 size, DesktopFileEntry* entry) const;
+
+ private:
+  // How well the locale of a key matches ours: -1 for none, otherwise the
+  // higher the better.
+  int localeMatch(const char* locale, int size) const;
+
+  // The locales that match ours, from the least to the most specific.
+  std::vector<QByteArray> locales_;
+};
+
+}  // namespace ksmoothdock
+
+#endif  // KSMOOTHDOCK_DESKTOP_FILE_PARSER_H_
@@ -0,0 +1,412 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2019 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "desktop_file_parser.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QtTest>
+
+#include <KConfigGroup>
+#include <KDesktopFile>
+
+namespace ksmoothdock {
+
+class DesktopFileParserTest: public QObject {
+  Q_OBJECT
+
+ private slots:
+  void parse();
+
+  // Tests that localized values are chosen by locale, then language.
+  void parse_locale();
+
+  // Tests the KConfig options after the keys: [$e], [$i] and [$d].
+  void parse_options();
+
+  // Tests NoDisplay, OnlyShowIn and NotShowIn.
+  void parse_noDisplay();
+
+  // Tests that random desktop files are read the same as by KDesktopFile.
+  void parse_matchesKDesktopFile();
+
+  // Parses a synthetic corpus of desktop files, with the parser and with
+  // KDesktopFile.
+  void parse_benchmark_data();
+  void parse_benchmark();
+
+ private:
+  static DesktopFileEntry parseContents(const QByteArray& contents,
+                                        const QString& locale = "en_US") {
+    DesktopFileEntry entry;
+    DesktopFileParser(locale).parse(contents.constData(), contents.size(),
+                                    &entry);
+    return entry;
+  }
+
+  // The reference implementation.
+  static DesktopFileEntry readWithKDesktopFile(const QString& path,
+                                               const QString& locale) {
+    KDesktopFile file(path);
+    file.setLocale(locale);
+    const KConfigGroup group = file.desktopGroup();
+    DesktopFileEntry entry;
+    entry.name = file.readName();
+    entry.genericName = file.readGenericName();
+    entry.icon = file.readIcon();
+    entry.exec = group.readEntry("Exec", QString());
+    entry.categories = group.readEntry("Categories", QString())
+        .split(';', QString::SkipEmptyParts);
+    entry.startupWMClass = group.readEntry("StartupWMClass", QString());
+    entry.noDisplay = file.noDisplay();
+    entry.hidden =
+        group.readEntry("Hidden", QString()).trimmed().toLower() == "true";
+    return entry;
+  }
+
+  static QStringList describe(const DesktopFileEntry& entry) {
+    return { entry.name, entry.genericName, entry.icon, entry.exec,
+             entry.categories.join('|'), entry.startupWMClass,
+             entry.noDisplay ? "noDisplay" : "", entry.hidden ? "hidden" : "" };
+  }
+
+  // Writes a random desktop file, with comments, other groups, random
+  // whitespace, duplicate keys, escapes and localized values.
+  static void writeRandomFile(const QString& path, std::mt19937* random) {
+    static const std::vector<std::string> kKeys = {
+      "Type", "Name", "GenericName", "Comment", "Icon", "Exec", "Categories",
+      "StartupWMClass", "NoDisplay", "Hidden", "OnlyShowIn", "NotShowIn",
+      "X-KDE-Other", "name"
+    };
+    static const std::vector<std::string> kStrings = {
+      "Chrome", "Web Browser", "chrome %U", "/usr/bin/app --flag %F",
+      "Ünïcødé 日本語", "a\\sb", "tab\\there", "back\\\\slash", "semi\\;colon",
+      "x = y", "", "[brackets]", "$HOME/icon.png", "${HOME}/bin/app %U",
+      "price $$5", "$KSMOOTHDOCK_UNSET_VARIABLE/app", "trailing $"
+    };
+    static const std::vector<std::string> kBools = {
+      "true", "false", "True", "FALSE", "1", "0", "yes", "no", "on", "off"
+    };
+    static const std::vector<std::string> kLists = {
+      "KDE;", "GNOME;", "GNOME;KDE;", "XFCE", "KDE", "Network;",
+      "Qt;KDE;Office;", "Game;;Education", ""
+    };
+    static const std::vector<std::string> kLocales = {
+      "de", "de_DE", "fr", "de_AT", "sr@latin"
+    };
+    static const std::vector<std::string> kSpaces = { "", "", " ", "\t", "  " };
+
+    const auto pick = [random](const std::vector<std::string>& values) {
+      return values[std::uniform_int_distribution<size_t>(
+          0, values.size() - 1)(*random)];
+    };
+    const auto chance = [random](double p) {
+      return std::bernoulli_distribution(p)(*random);
+    };
+    const std::string newLine = chance(0.2) ? "\r\n" : "\n";
+    const auto value = [&](const std::string& key) {
+      if (key == "NoDisplay" || key == "Hidden") {
+        return pick(kBools);
+      }
+      if (key == "OnlyShowIn" || key == "NotShowIn" || key == "Categories") {
+        return pick(kLists);
+      }
+      return pick(kStrings);
+    };
+    const auto line = [&](const std::string& key, const std::string& text) {
+      return pick(kSpaces) + key + pick(kSpaces) + "=" + pick(kSpaces) +
+          text + pick(kSpaces) + newLine;
+    };
+
+    std::string contents;
+    if (chance(0.3)) {
+      contents += "# A comment" + newLine + newLine;
+    }
+    if (chance(0.2)) {
+      contents += "[X-Other Group]" + newLine + line("Name", "Other");
+    }
+    contents += "[Desktop Entry]" + newLine;
+    std::vector<std::string> keys = kKeys;
+    std::shuffle(keys.begin(), keys.end(), *random);
+    for (const auto& key : keys) {
+      if (chance(0.3)) {
+        continue;
+      }
+      // At most one localized value per key, as KConfig and the spec differ
+      // on which of lang_COUNTRY and lang wins when both are present.
+      const bool localized = (key == "Name" || key == "GenericName" ||
+                              key == "Icon") && chance(0.5);
+      // KConfig options, e.g. Icon[$e] or Name[de][$i].
+      const auto options = [&]() -> std::string {
+        return chance(0.2) ? (chance(0.5) ? "[$e]" : "[$i]") : "";
+      };
+      const std::string localizedLine =
+          localized ? line(key + "[" + pick(kLocales) + "]" + options(),
+                           value(key))
+                    : "";
+      const bool localizedFirst = chance(0.5);
+      if (localizedFirst) {
+        contents += localizedLine;
+      }
+      // [$i] would keep the first of the duplicate keys.
+      const auto unlocalizedOptions = [&]() -> std::string {
+        return chance(0.2) ? "[$e]" : "";
+      };
+      contents += line(key + unlocalizedOptions(), value(key));
+      if (chance(0.1)) {
+        // Duplicate key.
+        contents += line(key + unlocalizedOptions(), value(key));
+      }
+      if (!localizedFirst) {
+        contents += localizedLine;
+      }
+      if (chance(0.05)) {
+        contents += "  # Indented comment" + newLine;
+      }
+      if (chance(0.05)) {
+        contents += "Not an entry" + newLine;
+      }
+    }
+    if (chance(0.5)) {
+      contents += newLine + "[Desktop Action new-window]" + newLine +
+          line("Name", "New Window") + line("Exec", "app --new-window") +
+          line("NoDisplay", "true");
+    }
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(contents.data(), contents.size());
+  }
+
+  // Writes desktop files like the ones of a typical distribution: names and
+  // comments translated into many languages, and a few actions.
+  static void writeCorpus(const QString& dir, int fileCount) {
+    static const char* const kLanguages[] = {
+      "ar", "bg", "ca", "cs", "da", "de", "el", "en_GB", "es", "et", "fi",
+      "fr", "gl", "he", "hu", "id", "it", "ja", "ko", "lt", "nl", "nn", "pl",
+      "pt", "pt_BR", "ro", "ru", "sk", "sl", "sr", "sr@latin", "sv", "tr",
+      "uk", "zh_CN", "zh_TW"
+    };
+    for (int i = 0; i < fileCount; ++i) {
+      QFile file(QString("%1/app%2.desktop").arg(dir).arg(i, 5, 10, QChar('0')));
+      QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+      QTextStream out(&file);
+      out.setCodec("UTF-8");
+      out << "[Desktop Entry]\n"
+          << "Type=Application\n"
+          << "Name=App " << i << "\n";
+      for (const char* language : kLanguages) {
+        out << "Name[" << language << "]=Anwendung " << i << "\n";
+      }
+      out << "GenericName=Generic " << i << "\n";
+      for (const char* language : kLanguages) {
+        out << "GenericName[" << language << "]=Generisch " << i << "\n";
+      }
+      out << "Comment=A synthetic application for benchmarking\n";
+      for (const char* language : kLanguages) {
+        out << "Comment[" << language << "]=Eine synthetische Anwendung\n";
+      }
+      out << "Icon=icon" << i << "\n"
+          << "Exec=/usr/bin/app" << i << " %U\n"
+          << "Categories=Qt;KDE;Utility;\n"
+          << "StartupWMClass=app" << i << "\n"
+          << "Actions=new-window;\n"
+          << "\n"
+          << "[Desktop Action new-window]\n"
+          << "Name=New Window\n";
+      for (const char* language : kLanguages) {
+        out << "Name[" << language << "]=Neues Fenster\n";
+      }
+      out << "Exec=/usr/bin/app" << i << " --new-window\n";
+    }
+  }
+};
+
+void DesktopFileParserTest::parse() {
+  const DesktopFileEntry entry = parseContents(
+      "# A comment\n"
+      "Name=Outside\n"
+      "\n"
+      "[Desktop Entry]\n"
+      "Type=Application\n"
+      "Name=Chrome\n"
+      "GenericName = Web Browser \n"
+      "Icon=chrome\r\n"
+      "Exec=chrome\\s--incognito\\t%U\n"
+      "Exec[fr]=chrome-fr\n"
+      "Categories=Network;WebBrowser;\n"
+      "StartupWMClass=Google-chrome\n"
+      "Hidden=false\n"
+      "name=lower case\n"
+      "Not an entry\n"
+      "\n"
+      "[Desktop Action new-window]\n"
+      "Name=New Window\n"
+      "Exec=chrome --new-window\n");
+  QCOMPARE(entry.name, QString("Chrome"));
+  QCOMPARE(entry.genericName, QString("Web Browser"));
+  QCOMPARE(entry.icon, QString("chrome"));
+  QCOMPARE(entry.exec, QString("chrome --incognito\t%U"));
+  QCOMPARE(entry.categories, QStringList({"Network", "WebBrowser"}));
+  QCOMPARE(entry.startupWMClass, QString("Google-chrome"));
+  QVERIFY(!entry.noDisplay);
+  QVERIFY(!entry.hidden);
+
+  // Missing keys.
+  const DesktopFileEntry empty = parseContents("[Desktop Entry]\n");
+  QVERIFY(empty.name.isEmpty());
+  QVERIFY(empty.exec.isEmpty());
+  QVERIFY(empty.categories.isEmpty());
+  QVERIFY(!empty.noDisplay);
+  QVERIFY(parseContents("").name.isEmpty());
+
+  // Missing file.
+  DesktopFileEntry missing;
+  QVERIFY(!DesktopFileParser().parse("/file-not-exist.desktop", &missing));
+}
+
+void DesktopFileParserTest::parse_locale() {
+  const QByteArray contents =
+      "[Desktop Entry]\n"
+      "Name[de_DE]=Deutsch (Deutschland)\n"
+      "Name=English\n"
+      "Name[de]=Deutsch\n"
+      "GenericName[fr]=Navigateur\n"
+      "GenericName=Web Browser\n"
+      "Icon[sr@latin]=latin\n"
+      "Icon=chrome\n"
+      "Icon[sr]=cyrillic\n"
+      "Exec=chrome\n";
+  QCOMPARE(parseContents(contents, "de_DE").name,
+           QString("Deutsch (Deutschland)"));
+  QCOMPARE(parseContents(contents, "de_AT").name, QString("Deutsch"));
+  QCOMPARE(parseContents(contents, "de").name, QString("Deutsch"));
+  QCOMPARE(parseContents(contents, "fr_FR").name, QString("English"));
+  QCOMPARE(parseContents(contents, "fr_FR").genericName,
+           QString("Navigateur"));
+  QCOMPARE(parseContents(contents, "de_DE").genericName,
+           QString("Web Browser"));
+  QCOMPARE(parseContents(contents, "sr_RS").icon, QString("cyrillic"));
+  QCOMPARE(parseContents(contents, "sr_RS@latin").icon, QString("latin"));
+  QCOMPARE(parseContents(contents, "sr@latin").icon, QString("latin"));
+  QCOMPARE(parseContents(contents, "sr_RS.UTF-8@latin").icon, QString("latin"));
+  QCOMPARE(parseContents(contents, "en_US").icon, QString("chrome"));
+  QCOMPARE(parseContents(contents, "de_DE").exec, QString("chrome"));
+}
+
+void DesktopFileParserTest::parse_options() {
+  qputenv("KSMOOTHDOCK_TEST_DIR", "/opt/app");
+  qunsetenv("KSMOOTHDOCK_UNSET_VARIABLE");
+  const DesktopFileEntry entry = parseContents(
+      "[Desktop Entry]\n"
+      "Name=English\n"
+      "Name[de][$i]=Deutsch\n"
+      "Name[de]=Ignored\n"
+      "GenericName[$e]=$KSMOOTHDOCK_UNSET_VARIABLE/generic\n"
+      "Icon[$e]=${KSMOOTHDOCK_TEST_DIR}/icon.png\n"
+      "Exec[$e]=$KSMOOTHDOCK_TEST_DIR/bin/app --price $$5 %U\n"
+      "StartupWMClass=$KSMOOTHDOCK_TEST_DIR\n"
+      "Categories=Game;\n"
+      "Categories[$d]=\n",
+      "de_DE");
+  QCOMPARE(entry.name, QString("Deutsch"));
+  QCOMPARE(entry.genericName, QString("/generic"));
+  QCOMPARE(entry.icon, QString("/opt/app/icon.png"));
+  QCOMPARE(entry.exec, QString("/opt/app/bin/app --price $5 %U"));
+  QCOMPARE(entry.startupWMClass, QString("$KSMOOTHDOCK_TEST_DIR"));
+  QVERIFY(entry.categories.isEmpty());
+
+  // The locale can come before or after the options.
+  QCOMPARE(parseContents("[Desktop Entry]\nName[$i][de]=Deutsch\n", "de_DE")
+               .name,
+           QString("Deutsch"));
+  // More than one locale.
+  QVERIFY(parseContents("[Desktop Entry]\nName[de][de_DE]=Deutsch\n",
+                        "de_DE").name.isEmpty());
+}
+
+void DesktopFileParserTest::parse_noDisplay() {
+  QVERIFY(!parseContents("[Desktop Entry]\nNoDisplay=false\n").noDisplay);
+  QVERIFY(parseContents("[Desktop Entry]\nNoDisplay=true\n").noDisplay);
+  QVERIFY(parseContents("[Desktop Entry]\nNoDisplay=True\n").noDisplay);
+  QVERIFY(!parseContents("[Desktop Entry]\nOnlyShowIn=KDE;\n").noDisplay);
+  QVERIFY(parseContents("[Desktop Entry]\nOnlyShowIn=GNOME;XFCE;\n").noDisplay);
+  QVERIFY(!parseContents("[Desktop Entry]\nNotShowIn=GNOME;\n").noDisplay);
+  QVERIFY(parseContents("[Desktop Entry]\nNotShowIn=GNOME;KDE\n").noDisplay);
+  QVERIFY(parseContents("[Desktop Entry]\nHidden=true\n").hidden);
+  QVERIFY(!parseContents("[Desktop Entry]\nHidden=1\n").hidden);
+}
+
+void DesktopFileParserTest::parse_matchesKDesktopFile() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  std::mt19937 random(42);
+  for (int i = 0; i < 500; ++i) {
+    const QString path = QString("%1/%2.desktop").arg(dir.path()).arg(i);
+    writeRandomFile(path, &random);
+    for (const QString& locale : QStringList{"de_DE", "en_US"}) {
+      DesktopFileEntry entry;
+      QVERIFY(DesktopFileParser(locale).parse(path, &entry));
+      QCOMPARE(describe(entry),
+               describe(readWithKDesktopFile(path, locale)));
+    }
+  }
+}
+
+void DesktopFileParserTest::parse_benchmark_data() {
+  QTest::addColumn<bool>("useKDesktopFile");
+  QTest::newRow("parser") << false;
+  QTest::newRow("KDesktopFile") << true;
+}
+
+void DesktopFileParserTest::parse_benchmark() {
+  QFETCH(bool, useKDesktopFile);
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  constexpr int kFileCount = 1000;
+  writeCorpus(dir.path(), kFileCount);
+  QStringList files;
+  for (int i = 0; i < kFileCount; ++i) {
+    files.append(QString("%1/app%2.desktop").arg(dir.path())
+                     .arg(i, 5, 10, QChar('0')));
+  }
+
+  const QString locale = "de_DE";
+  QBENCHMARK {
+    for (const QString& file : files) {
+      if (useKDesktopFile) {
+        readWithKDesktopFile(file, locale);
+      } else {
+        DesktopFileEntry entry;
+        DesktopFileParser(locale).parse(file, &entry);
+      }
+    }
+  }
+}
+
+}  // namespace ksmoothdock
+
+QTEST_MAIN(ksmoothdock::DesktopFileParserTest)
+#include "desktop_file_parser_test.moc"
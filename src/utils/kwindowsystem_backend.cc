@@ -0,0 +1,149 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2018 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "kwindowsystem_backend.h"
+
+#include <QDBusInterface>
+#include <QDBusReply>
+#include <QX11Info>
+
+#include <KWindowInfo>
+#include <KWindowSystem>
+#include <netwm.h>
+
+namespace ksmoothdock {
+
+KWindowSystemBackend::KWindowSystemBackend() {
+  // Calling DBus to get current activity. This is more convenient than waiting for
+  // KActivities::Consumer's status change then calling it.
+  QDBusInterface activityManagerDBus("org.kde.ActivityManager", "/ActivityManager/Activities",
+                                     "org.kde.ActivityManager.Activities");
+  if (activityManagerDBus.isValid()) {
+    const QDBusReply<QString> reply = activityManagerDBus.call("CurrentActivity");
+    if (reply.isValid()) {
+      currentActivity_ = reply.value();
+    }
+  }
+
+  connect(KWindowSystem::self(), SIGNAL(windowAdded(WId)),
+          this, SIGNAL(windowAdded(WId)));
+  connect(KWindowSystem::self(), SIGNAL(windowRemoved(WId)),
+          this, SIGNAL(windowRemoved(WId)));
+  connect(KWindowSystem::self(),
+          SIGNAL(windowChanged(WId, NET::Properties, NET::Properties2)),
+          this,
+          SIGNAL(windowChanged(WId, NET::Properties, NET::Properties2)));
+  connect(KWindowSystem::self(), SIGNAL(activeWindowChanged(WId)),
+          this, SIGNAL(activeWindowChanged(WId)));
+  connect(KWindowSystem::self(), SIGNAL(currentDesktopChanged(int)),
+          this, SIGNAL(currentDesktopChanged(int)));
+  connect(KWindowSystem::self(), SIGNAL(numberOfDesktopsChanged(int)),
+          this, SIGNAL(numberOfDesktopsChanged(int)));
+  connect(&activityManager_, &KActivities::Consumer::currentActivityChanged,
+          this, [this](const QString& activity) {
+            currentActivity_ = activity;
+            emit currentActivityChanged(activity);
+          });
+}
+
+QList<WId> KWindowSystemBackend::windows() const {
+  return KWindowSystem::windows();
+}
+
+bool KWindowSystemBackend::hasWId(WId wId) const {
+  return KWindowSystem::hasWId(wId);
+}
+
+WId KWindowSystemBackend::activeWindow() const {
+  return KWindowSystem::activeWindow();
+}
+
+int KWindowSystemBackend::currentDesktop() const {
+  return KWindowSystem::currentDesktop();
+}
+
+int KWindowSystemBackend::numberOfDesktops() const {
+  return KWindowSystem::numberOfDesktops();
+}
+
+void KWindowSystemBackend::windowInfo(WId wId, NET::Properties properties,
+                                      NET::Properties2 properties2,
+                                      WindowProperties* windowProperties) const {
+  KWindowInfo info(wId, properties, properties2);
+  windowProperties->valid = info.valid();
+  if (!windowProperties->valid) {
+    return;
+  }
+
+  if (properties & NET::WMState) {
+    windowProperties->state = info.state();
+  }
+  if (properties & NET::WMWindowType) {
+    windowProperties->windowType = info.windowType(NET::DockMask | NET::DesktopMask);
+  }
+  if (properties & NET::WMVisibleName) {
+    windowProperties->visibleName = info.visibleName();
+  }
+  if (properties & NET::WMDesktop) {
+    windowProperties->desktop = info.desktop();
+    windowProperties->onAllDesktops = info.onAllDesktops();
+  }
+  if (properties & NET::WMFrameExtents) {
+    windowProperties->frameGeometry = info.frameGeometry();
+  }
+  if (properties2 & NET::WM2WindowClass) {
+    windowProperties->windowClassClass = QString(info.windowClassClass());
+    windowProperties->windowClassName = QString(info.windowClassName());
+  }
+  if (properties2 & NET::WM2Activities) {
+    windowProperties->activities = info.activities();
+  }
+}
+
+QPixmap KWindowSystemBackend::icon(WId wId, int width, int height) const {
+  return KWindowSystem::icon(wId, width, height, true /* scale */);
+}
+
+void KWindowSystemBackend::activateWindow(WId wId) {
+  KWindowSystem::forceActiveWindow(wId);
+}
+
+void KWindowSystemBackend::minimizeWindow(WId wId) {
+  KWindowSystem::minimizeWindow(wId);
+}
+
+void KWindowSystemBackend::raiseWindows(const QList<WId>& wIds) {
+  if (!QX11Info::isPlatformX11()) {
+    for (const auto wId : wIds) {
+      KWindowSystem::raiseWindow(wId);
+    }
+    return;
+  }
+
+  // KWindowSystem::raiseWindow() queries the root window for every window,
+  // so we send all the restack requests to the window manager ourselves,
+  // then flush once.
+  NETRootInfo rootInfo(QX11Info::connection(), NET::Supported);
+  for (const auto wId : wIds) {
+    rootInfo.restackRequest(wId, NET::FromTool, XCB_WINDOW_NONE,
+                            XCB_STACK_MODE_ABOVE, QX11Info::appUserTime());
+  }
+  xcb_flush(QX11Info::connection());
+}
+
+}  // namespace ksmoothdock
@@ -0,0 +1,62 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2018 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KSMOOTHDOCK_KWINDOWSYSTEM_BACKEND_H_
+#define KSMOOTHDOCK_KWINDOWSYSTEM_BACKEND_H_
+
+#include "window_system_backend.h"
+
+#include <kactivities/consumer.h>
+
+namespace ksmoothdock {
+
+// The real window system, backed by KWindowSystem and KActivities.
+class KWindowSystemBackend : public WindowSystemBackend {
+  Q_OBJECT
+
+ public:
+  KWindowSystemBackend();
+  ~KWindowSystemBackend() = default;
+
+  QList<WId> windows() const override;
+  bool hasWId(WId wId) const override;
+  WId activeWindow() const override;
+  int currentDesktop() const override;
+  int numberOfDesktops() const override;
+  QString currentActivity() const override { return currentActivity_; }
+
+  void windowInfo(WId wId, NET::Properties properties,
+                  NET::Properties2 properties2,
+                  WindowProperties* windowProperties) const override;
+
+  QPixmap icon(WId wId, int width, int height) const override;
+
+  void activateWindow(WId wId) override;
+  void minimizeWindow(WId wId) override;
+  void raiseWindows(const QList<WId>& wIds) override;
+
+ private:
+  // ID of the current activity.
+  QString currentActivity_;
+
+  KActivities::Consumer activityManager_;
+};
+
+}  // namespace ksmoothdock
+
+#endif  // KSMOOTHDOCK_KWINDOWSYSTEM_BACKEND_H_
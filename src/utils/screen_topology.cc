@@ -0,0 +1,153 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2018 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "screen_topology.h"
+
+#include <algorithm>
+
+#include <QGuiApplication>
+#include <QScreen>
+
+namespace ksmoothdock {
+
+namespace {
+
+// Index of the grid interval that contains coordinate v, given the sorted
+// edges. Coordinates before the first edge map to -1.
+int intervalIndex(const std::vector<int>& edges, int v) {
+  return static_cast<int>(std::upper_bound(edges.begin(), edges.end(), v) -
+                          edges.begin()) - 1;
+}
+
+std::vector<QRect> screenGeometries() {
+  std::vector<QRect> geometries;
+  for (const auto* screen : QGuiApplication::screens()) {
+    geometries.push_back(screen->geometry());
+  }
+  return geometries;
+}
+
+}  // namespace
+
+ScreenTopology::ScreenTopology() {
+  auto* app = qobject_cast<QGuiApplication*>(QCoreApplication::instance());
+  if (app != nullptr) {
+    connect(app, &QGuiApplication::screenAdded, this, &ScreenTopology::onScreenAdded);
+    connect(app, &QGuiApplication::screenRemoved, this, &ScreenTopology::onScreenRemoved);
+    for (auto* screen : QGuiApplication::screens()) {
+      connect(screen, &QScreen::geometryChanged, this, &ScreenTopology::reload);
+    }
+  }
+
+  geometries_ = screenGeometries();
+  buildIndex();
+}
+
+int ScreenTopology::screenForFrame(const QRect& frame) const {
+  if (screenCount() == 1) {
+    return 0;
+  }
+
+  if (frame.width() <= 0 || frame.height() <= 0 || cells_.empty()) {
+    return -1;
+  }
+
+  const int columns = static_cast<int>(xEdges_.size()) - 1;
+  const int rows = static_cast<int>(yEdges_.size()) - 1;
+  const int left = std::max(intervalIndex(xEdges_, frame.x()), 0);
+  const int right = std::min(intervalIndex(xEdges_, frame.x() + frame.width() - 1),
+                             columns - 1);
+  const int top = std::max(intervalIndex(yEdges_, frame.y()), 0);
+  const int bottom = std::min(intervalIndex(yEdges_, frame.y() + frame.height() - 1),
+                              rows - 1);
+
+  int result = -1;
+  for (int row = top; row <= bottom; ++row) {
+    for (int column = left; column <= right; ++column) {
+      const int screen = cells_[row * columns + column];
+      if (screen >= 0 && (result < 0 || screen < result)) {
+        result = screen;
+      }
+    }
+  }
+  return result;
+}
+
+void ScreenTopology::setGeometries(const std::vector<QRect>& geometries) {
+  geometries_ = geometries;
+  buildIndex();
+  emit screensChanged();
+}
+
+void ScreenTopology::onScreenAdded(QScreen* screen) {
+  connect(screen, &QScreen::geometryChanged, this, &ScreenTopology::reload);
+  reload();
+}
+
+void ScreenTopology::onScreenRemoved(QScreen* screen) {
+  disconnect(screen, nullptr, this, nullptr);
+  reload();
+}
+
+void ScreenTopology::reload() {
+  setGeometries(screenGeometries());
+}
+
+void ScreenTopology::buildIndex() {
+  xEdges_.clear();
+  yEdges_.clear();
+  cells_.clear();
+  for (const auto& geometry : geometries_) {
+    if (geometry.width() <= 0 || geometry.height() <= 0) {
+      continue;
+    }
+    xEdges_.push_back(geometry.x());
+    xEdges_.push_back(geometry.x() + geometry.width());
+    yEdges_.push_back(geometry.y());
+    yEdges_.push_back(geometry.y() + geometry.height());
+  }
+  for (auto* edges : {&xEdges_, &yEdges_}) {
+    std::sort(edges->begin(), edges->end());
+    edges->erase(std::unique(edges->begin(), edges->end()), edges->end());
+  }
+  if (xEdges_.size() < 2 || yEdges_.size() < 2) {
+    return;
+  }
+
+  const int columns = static_cast<int>(xEdges_.size()) - 1;
+  const int rows = static_cast<int>(yEdges_.size()) - 1;
+  cells_.assign(columns * rows, -1);
+  // Iterates in reverse so that lower screen indices win.
+  for (int screen = screenCount() - 1; screen >= 0; --screen) {
+    const auto& geometry = geometries_[screen];
+    if (geometry.width() <= 0 || geometry.height() <= 0) {
+      continue;
+    }
+    const int left = intervalIndex(xEdges_, geometry.x());
+    const int right = intervalIndex(xEdges_, geometry.x() + geometry.width() - 1);
+    const int top = intervalIndex(yEdges_, geometry.y());
+    const int bottom = intervalIndex(yEdges_, geometry.y() + geometry.height() - 1);
+    for (int row = top; row <= bottom; ++row) {
+      for (int column = left; column <= right; ++column) {
+        cells_[row * columns + column] = screen;
+      }
+    }
+  }
+}
+
+}  // namespace ksmoothdock
@@ -0,0 +1,89 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2018 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KSMOOTHDOCK_SCREEN_TOPOLOGY_H_
+#define KSMOOTHDOCK_SCREEN_TOPOLOGY_H_
+
+#include <vector>
+
+#include <QObject>
+#include <QRect>
+
+class QScreen;
+
+namespace ksmoothdock {
+
+// Cached geometries of the screens, kept up to date on screen hot-plug and
+// geometry changes.
+//
+// Screens are indexed as in QGuiApplication::screens().
+class ScreenTopology : public QObject {
+  Q_OBJECT
+
+ public:
+  ScreenTopology();
+  ~ScreenTopology() = default;
+
+  int screenCount() const { return static_cast<int>(geometries_.size()); }
+
+  bool isValidScreen(int screen) const {
+    return screen >= 0 && screen < screenCount();
+  }
+
+  // Gets the geometry of a screen, or an empty rect if the screen index is
+  // out of range.
+  QRect geometry(int screen) const {
+    return isValidScreen(screen) ? geometries_[screen] : QRect();
+  }
+
+  // Gets the screen that owns a window frame, i.e. the first screen that
+  // intersects it, or -1 if none does.
+  int screenForFrame(const QRect& frame) const;
+
+  // Sets the screen geometries directly. For testing.
+  void setGeometries(const std::vector<QRect>& geometries);
+
+ signals:
+  // Emitted after screens have been added/removed or their geometries have
+  // changed.
+  void screensChanged();
+
+ private slots:
+  void onScreenAdded(QScreen* screen);
+  void onScreenRemoved(QScreen* screen);
+  void reload();
+
+ private:
+  // Rebuilds the spatial look-up from geometries_.
+  void buildIndex();
+
+  std::vector<QRect> geometries_;
+
+  // Spatial look-up: the plane is cut into a grid along all the screens'
+  // edges, and each grid cell stores the lowest index of the screens that
+  // cover it, or -1. Edges are exclusive on the right/bottom.
+  std::vector<int> xEdges_;
+  std::vector<int> yEdges_;
+  std::vector<int> cells_;  // (xEdges_.size() - 1) * (yEdges_.size() - 1)
+
+  friend class ScreenTopologyTest;
+};
+
+}  // namespace ksmoothdock
+
+#endif  // KSMOOTHDOCK_SCREEN_TOPOLOGY_H_
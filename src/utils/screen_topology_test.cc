@@ -0,0 +1,117 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2018 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "screen_topology.h"
+
+#include <random>
+#include <vector>
+
+#include <QSignalSpy>
+#include <QtTest>
+
+namespace ksmoothdock {
+
+class ScreenTopologyTest: public QObject {
+  Q_OBJECT
+
+ private slots:
+  // Tests the screen look-up with side-by-side screens.
+  void screenForFrame();
+
+  // Tests that the look-up matches the first intersecting screen for
+  // overlapping and non-contiguous layouts.
+  void screenForFrame_matchesLinearSearch();
+
+  // Tests screen index bounds.
+  void geometry();
+
+ private:
+  // The reference implementation: the first screen that intersects the frame.
+  static int linearSearch(const std::vector<QRect>& screens, const QRect& frame) {
+    for (int screen = 0; screen < static_cast<int>(screens.size()); ++screen) {
+      if (screens[screen].intersects(frame)) {
+        return screen;
+      }
+    }
+    return -1;
+  }
+};
+
+void ScreenTopologyTest::screenForFrame() {
+  ScreenTopology topology;
+  QSignalSpy spy(&topology, SIGNAL(screensChanged()));
+  topology.setGeometries({QRect(0, 0, 1920, 1080), QRect(1920, 0, 2560, 1440)});
+  QCOMPARE(spy.count(), 1);
+
+  QCOMPARE(topology.screenForFrame(QRect(100, 100, 800, 600)), 0);
+  QCOMPARE(topology.screenForFrame(QRect(2000, 100, 800, 600)), 1);
+  // Spanning both screens.
+  QCOMPARE(topology.screenForFrame(QRect(1800, 100, 800, 600)), 0);
+  // Below the first screen, on the second one.
+  QCOMPARE(topology.screenForFrame(QRect(1000, 1200, 1000, 100)), 1);
+  // Off-screen.
+  QCOMPARE(topology.screenForFrame(QRect(-1000, -1000, 500, 500)), -1);
+  QCOMPARE(topology.screenForFrame(QRect(0, 1080, 1920, 100)), -1);
+  // Empty frame.
+  QCOMPARE(topology.screenForFrame(QRect(100, 100, 0, 0)), -1);
+}
+
+void ScreenTopologyTest::screenForFrame_matchesLinearSearch() {
+  const std::vector<std::vector<QRect>> layouts = {
+    // Overlapping (cloned) screens.
+    {QRect(0, 0, 1920, 1080), QRect(0, 0, 1280, 1024)},
+    // Vertical stack with a gap.
+    {QRect(0, 1200, 1920, 1080), QRect(0, 0, 1920, 1080)},
+    // Three screens of different sizes, one offset.
+    {QRect(0, 200, 1280, 800), QRect(1280, 0, 1920, 1080),
+     QRect(3200, 500, 1024, 768)},
+  };
+
+  std::mt19937 random(42);
+  std::uniform_int_distribution<int> position(-500, 4500);
+  std::uniform_int_distribution<int> size(0, 1500);
+  for (const auto& layout : layouts) {
+    ScreenTopology topology;
+    topology.setGeometries(layout);
+    for (int i = 0; i < 10000; ++i) {
+      const QRect frame(position(random), position(random), size(random), size(random));
+      QCOMPARE(topology.screenForFrame(frame), linearSearch(layout, frame));
+    }
+  }
+}
+
+void ScreenTopologyTest::geometry() {
+  ScreenTopology topology;
+  topology.setGeometries({QRect(0, 0, 1920, 1080), QRect(1920, 0, 2560, 1440)});
+  QCOMPARE(topology.screenCount(), 2);
+  QVERIFY(topology.isValidScreen(1));
+  QCOMPARE(topology.geometry(1), QRect(1920, 0, 2560, 1440));
+  QVERIFY(!topology.isValidScreen(2));
+  QVERIFY(!topology.isValidScreen(-1));
+  QCOMPARE(topology.geometry(2), QRect());
+
+  // Screen unplugged.
+  topology.setGeometries({QRect(0, 0, 1920, 1080)});
+  QVERIFY(!topology.isValidScreen(1));
+  QCOMPARE(topology.screenForFrame(QRect(2000, 100, 800, 600)), 0);
+}
+
+}  // namespace ksmoothdock
+
+QTEST_MAIN(ksmoothdock::ScreenTopologyTest)
+#include "screen_topology_test.moc"
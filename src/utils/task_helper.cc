@@ -20,57 +20,48 @@
 
 #include <algorithm>
 #include <iostream>
+#include <memory>
 #include <regex>
 #include <utility>
 
-#include <QDBusInterface>
-#include <QDBusReply>
-#include <QGuiApplication>
-#include <QScreen>
-
-#include <KWindowSystem>
-
 namespace ksmoothdock {
 
-bool TaskInfo::operator<(const TaskInfo& taskInfo) const {
-  if (program == taskInfo.program) {
-    // If same program, sort by creation time.
-    bool found = false;
-    for (const auto window : KWindowSystem::windows()) {
-      if (window == wId) {
-        found = true;
-      } else if (window == taskInfo.wId) {
-        return found;
-      }
-    }
-    return true;
-  }
-  return program < taskInfo.program;
-}
-
-TaskHelper::TaskHelper()
-    : currentDesktop_(KWindowSystem::currentDesktop()) {
-  // Calling DBus to get current activity. This is more convenient than waiting for
-  // KActivities::Consumer's status change then calling it.
-  QDBusInterface activityManagerDBus("org.kde.ActivityManager", "/ActivityManager/Activities",
-                                     "org.kde.ActivityManager.Activities");
-  if (activityManagerDBus.isValid()) {
-    const QDBusReply<QString> reply = activityManagerDBus.call("CurrentActivity");
-    if (reply.isValid()) {
-      currentActivity_ = reply.value();
-    }
-  }
-
-  connect(KWindowSystem::self(), &KWindowSystem::currentDesktopChanged,
+TaskHelper::TaskHelper(WindowSystemBackend* windowSystem,
+                       ScreenTopology* screenTopology)
+    : windowSystem_(windowSystem),
+      screenTopology_(screenTopology),
+      currentDesktop_(windowSystem->currentDesktop()),
+      currentActivity_(windowSystem->currentActivity()),
+      activeWindow_(windowSystem->activeWindow()),
+      nextCreationOrder_(0) {
+  connect(windowSystem_, &WindowSystemBackend::currentDesktopChanged,
           this, &TaskHelper::onCurrentDesktopChanged);
-  connect(&activityManager_, &KActivities::Consumer::currentActivityChanged,
+  connect(windowSystem_, &WindowSystemBackend::currentActivityChanged,
           this, &TaskHelper::onCurrentActivityChanged);
+  connect(windowSystem_, &WindowSystemBackend::activeWindowChanged,
+          this, &TaskHelper::onActiveWindowChanged);
+  connect(windowSystem_, &WindowSystemBackend::windowAdded,
+          this, &TaskHelper::onWindowAdded);
+  connect(windowSystem_, &WindowSystemBackend::windowRemoved,
+          this, &TaskHelper::onWindowRemoved);
+  connect(windowSystem_, &WindowSystemBackend::windowChanged,
+          this, &TaskHelper::onWindowChanged);
+  connect(screenTopology_, &ScreenTopology::screensChanged,
+          this, &TaskHelper::onScreensChanged);
 }
 
-std::vector<TaskInfo> TaskHelper::loadTasks(int screen, bool currentDesktopOnly) {
+std::vector<TaskInfo> TaskHelper::registerDock(int dockId, int screen,
+                                               bool currentDesktopOnly) {
+  auto& dock = docks_[dockId];
+  dock.screen = screen;
+  dock.currentDesktopOnly = currentDesktopOnly;
+  dock.tasks.clear();
+  loadCreationOrder();
+
   std::vector<TaskInfo> tasks;
-  for (const auto wId : KWindowSystem::windows()) {
-    if (isValidTask(wId, screen, currentDesktopOnly)) {
+  for (const auto wId : windowSystem_->windows()) {
+    if (isValidTask(wId, dock)) {
+      dock.tasks.insert(wId);
       tasks.push_back(getTaskInfo(wId));
     }
   }
@@ -79,29 +70,36 @@ std::vector<TaskInfo> TaskHelper::loadTasks(int screen, bool currentDesktopOnly)
   return tasks;
 }
 
+void TaskHelper::setDockScreen(int dockId, int screen) {
+  auto dock = docks_.find(dockId);
+  if (dock == docks_.end() || dock->second.screen == screen) {
+    return;
+  }
+
+  dock->second.screen = screen;
+  updateDockTasks();
+}
+
 bool TaskHelper::isValidTask(WId wId) {
-  if (!KWindowSystem::hasWId(wId)) {
+  if (!windowSystem_->hasWId(wId)) {
     return false;
   }
 
-  KWindowInfo info(wId, NET::WMState | NET::WMWindowType, NET::WM2WindowClass);
-  if (!info.valid()) {
+  const auto& info = windowProperties(wId);
+  if (!info.valid) {
     return false;
   }
 
-  const auto windowType = info.windowType(NET::DockMask | NET::DesktopMask);
-  if (windowType != NET::Normal && windowType != NET::Unknown) {
+  if (info.windowType != NET::Normal && info.windowType != NET::Unknown) {
     return false;
   }
 
-  const auto state = info.state();
-  if (state & NET::SkipTaskbar) {
+  if (info.state & NET::SkipTaskbar) {
     return false;
   }
 
   // Filters out KSmoothDock dialogs.
-  const auto command = QString(info.windowClassName());
-  return command != "ksmoothdock";
+  return info.windowClassName != "ksmoothdock";
 }
 
 bool TaskHelper::isValidTask(WId wId, int screen, bool currentDesktopOnly,
@@ -114,58 +112,271 @@ bool TaskHelper::isValidTask(WId wId, int screen, bool currentDesktopOnly,
     return false;
   }
 
+  const auto& info = windowProperties(wId);
   if (currentDesktopOnly) {
-    KWindowInfo info(wId, NET::WMDesktop);
-    if (!info.valid() || (info.desktop() != currentDesktop_ && !info.onAllDesktops())) {
+    if (info.desktop != currentDesktop_ && !info.onAllDesktops) {
       return false;
     }
   }
 
   if (currentActivityOnly) {
-    KWindowInfo info(wId, 0, NET::WM2Activities);
-    if (!info.valid() ||
-        (!info.activities().empty() && !info.activities().contains(currentActivity_))) {
+    if (!info.activities.empty() && !info.activities.contains(currentActivity_)) {
       return false;
     }
   }
-  
+
   return true;
 }
 
-/* static */ TaskInfo TaskHelper::getBasicTaskInfo(WId wId) {
-  KWindowInfo info(wId, 0, NET::WM2WindowClass);
-  const auto program = QString(info.windowClassName());
-  return TaskInfo(wId, program);
+TaskInfo TaskHelper::getBasicTaskInfo(WId wId) {
+  return TaskInfo(wId, windowProperties(wId).windowClassName);
+}
+
+TaskInfo TaskHelper::getTaskInfo(WId wId) {
+  const auto& info = windowProperties(wId);
+  TaskInfo task(wId, info.windowClassClass, info.windowClassName, info.visibleName,
+                info.state == NET::DemandsAttention);
+  task.icon = [this, wId]() { return windowIcon(wId); };
+  const auto it = creationOrder_.find(wId);
+  task.creationOrder = (it != creationOrder_.end()) ? it->second : nextCreationOrder_;
+  return task;
+}
+
+int TaskHelper::getScreen(WId wId) {
+  if (screenTopology_->screenCount() == 1) {
+    return 0;
+  }
+
+  auto& info = mutableWindowProperties(wId);
+  if (info.screen == CachedWindowProperties::kUnknownScreen) {
+    info.screen = screenTopology_->screenForFrame(info.frameGeometry);
+  }
+  return info.screen;
+}
+
+CachedWindowProperties& TaskHelper::mutableWindowProperties(WId wId) {
+  auto it = windows_.find(wId);
+  if (it == windows_.end()) {
+    it = windows_.emplace(wId, CachedWindowProperties()).first;
+    windowSystem_->windowInfo(wId, WindowSystemBackend::kProperties,
+                              WindowSystemBackend::kProperties2, &it->second);
+  }
+  return it->second;
 }
 
-TaskInfo TaskHelper::getTaskInfo(WId wId) const {
+QPixmap TaskHelper::windowIcon(WId wId) {
   static constexpr int kIconLoadSize = 128;
-  KWindowInfo info(wId, NET::WMVisibleName | NET::WMState, NET::WM2WindowClass);
+  auto it = windows_.find(wId);
+  if (it == windows_.end()) {
+    // Not tracked (e.g. already closed), don't cache.
+    return windowSystem_->icon(wId, kIconLoadSize, kIconLoadSize);
+  }
 
-  const auto program = QString(info.windowClassClass());
-  const auto command = QString(info.windowClassName());
-  const auto name = info.visibleName();
-  QPixmap icon = KWindowSystem::icon(wId, kIconLoadSize, kIconLoadSize, true /* scale */);
+  auto& info = it->second;
+  if (!info.iconLoaded) {
+    info.icon = windowSystem_->icon(wId, kIconLoadSize, kIconLoadSize);
+    info.iconLoaded = true;
+  }
+  return info.icon;
+}
 
-  return TaskInfo(wId, program, command, name, icon, info.state() == NET::DemandsAttention);
+void TaskHelper::onCurrentDesktopChanged(int desktop) {
+  currentDesktop_ = desktop;
+  updateDockTasks();
+  emit currentDesktopChanged();
 }
 
-int TaskHelper::getScreen(WId wId) {
-  const auto screens = QGuiApplication::screens();
-  const auto screenCount = screens.size();
-  if (screenCount == 1) {
-    return 0;
+void TaskHelper::onCurrentActivityChanged(QString activity) {
+  currentActivity_ = activity;
+  updateDockTasks();
+  emit currentActivityChanged();
+}
+
+void TaskHelper::onActiveWindowChanged(WId wId) {
+  if (wId == activeWindow_) {
+    return;
   }
 
-  KWindowInfo info(wId, NET::WMFrameExtents);
-  const auto& geometry = info.frameGeometry();
-  for (int screen = 0; screen < screenCount; ++screen) {
-    const auto& screenGeometry = screens[screen]->geometry();
-    if (screenGeometry.intersects(geometry)) {
-      return screen;
+  const WId previous = activeWindow_;
+  activeWindow_ = wId;
+  emit activeWindowChanged(previous, wId);
+}
+
+void TaskHelper::onWindowAdded(WId wId) {
+  creationOrder_[wId] = nextCreationOrder_++;
+  if (docks_.empty() || !isValidTask(wId)) {
+    return;
+  }
+
+  std::unique_ptr<TaskInfo> task;
+  for (auto& dock : docks_) {
+    if (isValidTask(wId, dock.second)) {
+      if (!task) {
+        task = std::make_unique<TaskInfo>(getTaskInfo(wId));
+      }
+      dock.second.tasks.insert(wId);
+      emit taskAdded(dock.first, *task);
     }
   }
-  return -1;
+}
+
+void TaskHelper::onWindowRemoved(WId wId) {
+  windows_.erase(wId);
+  creationOrder_.erase(wId);
+  for (auto& dock : docks_) {
+    if (dock.second.tasks.erase(wId) > 0) {
+      emit taskRemoved(dock.first, wId);
+    }
+  }
+}
+
+void TaskHelper::onScreensChanged() {
+  for (auto& window : windows_) {
+    window.second.screen = CachedWindowProperties::kUnknownScreen;
+  }
+  updateDockTasks();
+}
+
+void TaskHelper::onWindowChanged(WId wId, NET::Properties properties,
+                                 NET::Properties2 properties2) {
+  updateWindowProperties(wId, properties, properties2);
+  if (docks_.empty() || !isValidTask(wId)) {
+    return;
+  }
+
+  if ((properties & (NET::WMDesktop | NET::WMGeometry)) ||
+      (properties2 & NET::WM2Activities)) {
+    std::unique_ptr<TaskInfo> task;
+    for (auto& dock : docks_) {
+      const bool hasTask = dock.second.tasks.count(wId) > 0;
+      if (isValidTask(wId, dock.second)) {
+        if (!hasTask) {
+          if (!task) {
+            task = std::make_unique<TaskInfo>(getTaskInfo(wId));
+          }
+          dock.second.tasks.insert(wId);
+          emit taskAdded(dock.first, *task);
+        }
+      } else if (hasTask) {
+        dock.second.tasks.erase(wId);
+        emit taskRemoved(dock.first, wId);
+      }
+    }
+  } else if (properties & NET::WMState) {
+    std::unique_ptr<TaskInfo> task;
+    for (auto& dock : docks_) {
+      if (dock.second.tasks.count(wId) > 0) {
+        if (!task) {
+          task = std::make_unique<TaskInfo>(getTaskInfo(wId));
+        }
+        emit taskUpdated(dock.first, *task);
+      }
+    }
+  }
+}
+
+void TaskHelper::updateDockTasks() {
+  if (docks_.empty()) {
+    return;
+  }
+
+  const auto windows = windowSystem_->windows();
+  std::unordered_map<WId, TaskInfo> taskInfos;
+  for (auto& dock : docks_) {
+    auto& tasks = dock.second.tasks;
+    std::vector<WId> added;
+    for (const auto wId : windows) {
+      if (isValidTask(wId, dock.second)) {
+        if (tasks.count(wId) == 0) {
+          added.push_back(wId);
+        }
+      } else if (tasks.erase(wId) > 0) {
+        emit taskRemoved(dock.first, wId);
+      }
+    }
+
+    // Windows that have gone without a windowRemoved() event yet.
+    for (auto it = tasks.begin(); it != tasks.end();) {
+      if (!windowSystem_->hasWId(*it)) {
+        const WId wId = *it;
+        it = tasks.erase(it);
+        emit taskRemoved(dock.first, wId);
+      } else {
+        ++it;
+      }
+    }
+
+    // The window list is in the order of creation, so are the
+    // added tasks.
+    for (const auto wId : added) {
+      auto task = taskInfos.find(wId);
+      if (task == taskInfos.end()) {
+        task = taskInfos.emplace(wId, getTaskInfo(wId)).first;
+      }
+      tasks.insert(wId);
+      emit taskAdded(dock.first, task->second);
+    }
+  }
+}
+
+void TaskHelper::loadCreationOrder() {
+  creationOrder_.clear();
+  nextCreationOrder_ = 0;
+  for (const auto wId : windowSystem_->windows()) {
+    creationOrder_[wId] = nextCreationOrder_++;
+  }
+}
+
+void TaskHelper::updateWindowProperties(WId wId, NET::Properties properties,
+                                        NET::Properties2 properties2) {
+  auto it = windows_.find(wId);
+  if (it == windows_.end()) {
+    // Not seen yet, will be fetched in full when needed.
+    return;
+  }
+
+  if (!it->second.valid) {
+    // Fetches again in full, the window might not have been mapped yet.
+    windows_.erase(it);
+    return;
+  }
+
+  if (properties & NET::WMIcon) {
+    it->second.icon = QPixmap();
+    it->second.iconLoaded = false;
+  }
+
+  NET::Properties changed;
+  if (properties & NET::WMState) {
+    changed |= NET::WMState;
+  }
+  if (properties & NET::WMWindowType) {
+    changed |= NET::WMWindowType;
+  }
+  if (properties & (NET::WMName | NET::WMVisibleName)) {
+    changed |= NET::WMVisibleName;
+  }
+  if (properties & NET::WMDesktop) {
+    changed |= NET::WMDesktop;
+  }
+  if (properties & (NET::WMGeometry | NET::WMFrameExtents)) {
+    changed |= NET::WMFrameExtents;
+  }
+
+  NET::Properties2 changed2;
+  if (properties2 & NET::WM2WindowClass) {
+    changed2 |= NET::WM2WindowClass;
+  }
+  if (properties2 & NET::WM2Activities) {
+    changed2 |= NET::WM2Activities;
+  }
+
+  if (changed & NET::WMFrameExtents) {
+    it->second.screen = CachedWindowProperties::kUnknownScreen;
+  }
+  if (changed || changed2) {
+    windowSystem_->windowInfo(wId, changed, changed2, &it->second);
+  }
 }
 
 }  // namespace ksmoothdock
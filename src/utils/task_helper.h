@@ -19,13 +19,21 @@
 #ifndef KSMOOTHDOCK_TASK_HELPER_H_
 #define KSMOOTHDOCK_TASK_HELPER_H_
 
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <QObject>
 #include <QPixmap>
+#include <QRect>
 #include <QString>
+#include <QStringList>
 
-#include <kactivities/consumer.h>
+#include <netwm_def.h>
+
+#include "screen_topology.h"
+#include "window_system_backend.h"
 
 namespace ksmoothdock {
 
@@ -34,31 +42,70 @@ struct TaskInfo {
   QString program;  // e.g. Dolphin
   QString command;  // e.g. dolphin
   QString name;  // e.g. home -- Dolphin
-  QPixmap icon;
-  bool demandsAttention;
+  // Lazy handle to the window icon. The icon is only fetched from the X
+  // server when this is called, and is cached per window by TaskHelper.
+  // Empty if the task has no window icon source.
+  std::function<QPixmap()> icon;
+  bool demandsAttention = false;
+  // Sequence number of the window in creation order, used for sorting.
+  int creationOrder = 0;
 
   TaskInfo(WId wId2, const QString& program2) : wId(wId2), program(program2) {}
   TaskInfo(WId wId2, const QString& program2, const QString&command2, const QString& name2,
-           const QPixmap& icon2, bool demandsAttention2)
-      : wId(wId2), program(program2), command(command2), name(name2), icon(icon2),
+           bool demandsAttention2)
+      : wId(wId2), program(program2), command(command2), name(name2),
         demandsAttention(demandsAttention2) {}
   TaskInfo(const TaskInfo& taskInfo) = default;
   TaskInfo& operator=(const TaskInfo& taskInfo) = default;
 
-  bool operator<(const TaskInfo& taskInfo) const;
+  // Sorts by program, then by creation time.
+  bool operator<(const TaskInfo& taskInfo) const {
+    return (program == taskInfo.program) ? creationOrder < taskInfo.creationOrder
+                                         : program < taskInfo.program;
+  }
+};
+
+// Cached properties of a window. They are fetched with a single windowInfo()
+// call when the window is first seen, then only the changed fields are
+// re-fetched on windowChanged() events.
+struct CachedWindowProperties : public WindowProperties {
+  // Screen index computed from frameGeometry, or kUnknownScreen if it needs
+  // to be (re-)computed.
+  static constexpr int kUnknownScreen = -2;
+  int screen = kUnknownScreen;
+  // The window icon, fetched on first use and refreshed on NET::WMIcon.
+  QPixmap icon;
+  bool iconLoaded = false;
 };
 
+// Process-wide tracker of running tasks, shared by all docks.
+//
+// It keeps the authoritative list of windows and does all the window system
+// queries once, through a WindowSystemBackend, then delivers filtered
+// add/remove/update deltas for each registered dock, with the screen, desktop
+// and activity filters applied here.
 class TaskHelper : public QObject {
   Q_OBJECT
 
  public:
-  TaskHelper();
+  // No ownership.
+  TaskHelper(WindowSystemBackend* windowSystem, ScreenTopology* screenTopology);
 
-  // Loads running tasks.
+  // Registers a dock (or updates its filters if already registered), so that
+  // it receives the deltas for its tasks. Returns the dock's current tasks.
   //
   // Args:
   //   screen: screen index to load, or -1 if loading for all screens.
-  std::vector<TaskInfo> loadTasks(int screen, bool currentDesktopOnly);
+  std::vector<TaskInfo> registerDock(int dockId, int screen, bool currentDesktopOnly);
+
+  // Updates the screen filter of a registered dock and delivers the
+  // resulting deltas.
+  void setDockScreen(int dockId, int screen);
+
+  // Stops delivering task deltas to a dock.
+  void unregisterDock(int dockId) {
+    docks_.erase(dockId);
+  }
 
   // Whether the task is valid for showing on the task manager.
   bool isValidTask(WId wId);
@@ -67,23 +114,82 @@ class TaskHelper : public QObject {
   bool isValidTask(WId wId, int screen, bool currentDesktopOnly = true,
                    bool currentActivityOnly = true);
 
-  static TaskInfo getBasicTaskInfo(WId wId);
+  TaskInfo getBasicTaskInfo(WId wId);
 
-  TaskInfo getTaskInfo(WId wId) const;
+  TaskInfo getTaskInfo(WId wId);
 
   // Gets the screen that a task is running on.
   int getScreen(WId wId);
 
- public slots:
-  void onCurrentDesktopChanged(int desktop) {
-    currentDesktop_ = desktop;
+  // Gets the cached properties of a window, fetching them if needed.
+  const CachedWindowProperties& windowProperties(WId wId) {
+    return mutableWindowProperties(wId);
   }
 
-  void onCurrentActivityChanged(QString activity) {
-    currentActivity_ = activity;
-  }
+  // Gets the cached icon of a window, fetching it if needed.
+  QPixmap windowIcon(WId wId);
+
+  // Gets the active window, tracked from activeWindowChanged() events.
+  WId activeWindow() const { return activeWindow_; }
+
+  // Gets the current desktop, tracked from currentDesktopChanged() events.
+  int currentDesktop() const { return currentDesktop_; }
+
+ signals:
+  void taskAdded(int dockId, const TaskInfo& task);
+  void taskRemoved(int dockId, WId wId);
+  void taskUpdated(int dockId, const TaskInfo& task);
+
+  // Emitted after the current desktop/activity has been updated here, and
+  // after the tasks that enter or leave each dock have been delivered as
+  // taskAdded()/taskRemoved() deltas.
+  void currentDesktopChanged();
+  void currentActivityChanged();
+
+  // Emitted once per active window change, for all docks.
+  void activeWindowChanged(WId previous, WId current);
+
+ public slots:
+  void onCurrentDesktopChanged(int desktop);
+  void onCurrentActivityChanged(QString activity);
+  void onActiveWindowChanged(WId wId);
+
+  void onWindowAdded(WId wId);
+  void onWindowRemoved(WId wId);
+  void onWindowChanged(WId wId, NET::Properties properties,
+                       NET::Properties2 properties2);
+
+  void onScreensChanged();
 
  private:
+  // A dock's task filters and the tasks that it currently shows.
+  struct DockTasks {
+    int screen = -1;
+    bool currentDesktopOnly = true;
+    std::unordered_set<WId> tasks;
+  };
+
+  bool isValidTask(WId wId, const DockTasks& dock) {
+    return isValidTask(wId, dock.screen, dock.currentDesktopOnly);
+  }
+
+  // Re-evaluates the desktop/activity filters of all docks' tasks and emits
+  // the resulting deltas. Tasks that stay in a dock are left alone.
+  void updateDockTasks();
+
+  // Rebuilds the creation order index from the window list, which is in the
+  // order of creation.
+  void loadCreationOrder();
+
+  CachedWindowProperties& mutableWindowProperties(WId wId);
+
+  // Re-fetches the changed properties of a cached window.
+  void updateWindowProperties(WId wId, NET::Properties properties,
+                              NET::Properties2 properties2);
+
+  WindowSystemBackend* windowSystem_;  // No ownership.
+  ScreenTopology* screenTopology_;  // No ownership.
+
   // KWindowSystem::currentDesktop() is buggy sometimes, for example,
   // on windowAdded() event, so we store it here ourselves.
   int currentDesktop_;
@@ -91,7 +197,18 @@ class TaskHelper : public QObject {
   // ID of the current activity.
   QString currentActivity_;
 
-  KActivities::Consumer activityManager_;
+  WId activeWindow_;
+
+  // Map from window IDs to their cached properties.
+  std::unordered_map<WId, CachedWindowProperties> windows_;
+
+  // Map from window IDs to their sequence numbers in creation order, so that
+  // comparing two tasks of the same program is a look-up.
+  std::unordered_map<WId, int> creationOrder_;
+  int nextCreationOrder_;
+
+  // Map from dock IDs to their task filters and tasks.
+  std::unordered_map<int, DockTasks> docks_;
 };
 
 }  // namespace ksmoothdock
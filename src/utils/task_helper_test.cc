@@ -0,0 +1,248 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2018 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "task_helper.h"
+
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include <QBuffer>
+#include <QSignalSpy>
+#include <QtTest>
+
+#include "screen_topology.h"
+#include "window_system_trace.h"
+
+namespace ksmoothdock {
+
+// Many windows of the same class, e.g. terminals.
+constexpr int kNumSameProgramTasks = 200;
+
+// Replays a trace, counting the window icon fetches.
+class IconCountingWindowSystem : public ReplayWindowSystemBackend {
+ public:
+  explicit IconCountingWindowSystem(QIODevice* device)
+      : ReplayWindowSystemBackend(device) {}
+
+  QPixmap icon(WId wId, int width, int height) const override {
+    ++iconFetches[wId];
+    return ReplayWindowSystemBackend::icon(wId, width, height);
+  }
+
+  // Map from window IDs to their numbers of icon fetches.
+  mutable std::unordered_map<WId, int> iconFetches;
+};
+
+class TaskHelperTest: public QObject {
+  Q_OBJECT
+
+ private slots:
+  // Tests that tasks are sorted by program, then by creation order.
+  void sortTasks();
+
+  // Tests that the creation order of the windows is kept up to date as
+  // windows are added and removed.
+  void creationOrder();
+
+  // Tests that the window icons are only fetched when a task's icon is used,
+  // once per window until the window's icon changes.
+  void windowIcon();
+
+  // Benchmarks sorting many tasks of the same program.
+  void sortTasks_sameProgram_benchmark();
+
+ private:
+  static WindowProperties createWindow(const QString& program) {
+    WindowProperties properties;
+    properties.valid = true;
+    properties.windowType = NET::Normal;
+    properties.windowClassClass = program;
+    properties.windowClassName = program.toLower();
+    properties.visibleName = program;
+    properties.desktop = 1;
+    properties.frameGeometry = QRect(100, 100, 800, 600);
+    return properties;
+  }
+
+  static TraceEvent createEvent(TraceEvent::Type type, WId wId) {
+    TraceEvent event;
+    event.type = type;
+    event.wId = wId;
+    if (type == TraceEvent::Type::WindowAdded ||
+        type == TraceEvent::Type::WindowChanged) {
+      event.properties = createWindow("Konsole");
+    }
+    return event;
+  }
+
+  static TraceEvent createChangeEvent(WId wId, NET::Properties properties) {
+    TraceEvent event = createEvent(TraceEvent::Type::WindowChanged, wId);
+    event.value = static_cast<qint32>(properties);
+    return event;
+  }
+
+  // Creates tasks of the same program in shuffled creation order.
+  std::vector<TaskInfo> createSameProgramTasks(int count) {
+    std::vector<TaskInfo> tasks;
+    tasks.reserve(count);
+    for (int i = 0; i < count; ++i) {
+      TaskInfo task(static_cast<WId>(1000 + i), "konsole");
+      task.creationOrder = i;
+      tasks.push_back(task);
+    }
+    std::shuffle(tasks.begin(), tasks.end(), std::mt19937(42));
+    return tasks;
+  }
+};
+
+void TaskHelperTest::sortTasks() {
+  auto tasks = createSameProgramTasks(kNumSameProgramTasks);
+  TaskInfo dolphin(1, "dolphin");
+  dolphin.creationOrder = kNumSameProgramTasks;
+  tasks.push_back(dolphin);
+
+  std::stable_sort(tasks.begin(), tasks.end());
+
+  QCOMPARE(tasks[0].program, QString("dolphin"));
+  for (int i = 1; i <= kNumSameProgramTasks; ++i) {
+    QCOMPARE(tasks[i].program, QString("konsole"));
+    QCOMPARE(tasks[i].creationOrder, i - 1);
+  }
+}
+
+void TaskHelperTest::creationOrder() {
+  // The window IDs are not in the order of creation.
+  QBuffer buffer;
+  buffer.open(QIODevice::ReadWrite);
+  {
+    WindowSystemTraceWriter writer(&buffer);
+    TraceSnapshot snapshot;
+    snapshot.windows.emplace_back(30, createWindow("Konsole"));
+    snapshot.windows.emplace_back(10, createWindow("Konsole"));
+    writer.writeSnapshot(snapshot);
+    writer.writeEvent(createEvent(TraceEvent::Type::WindowAdded, 20));
+    writer.writeEvent(createEvent(TraceEvent::Type::WindowRemoved, 30));
+    writer.writeEvent(createEvent(TraceEvent::Type::WindowAdded, 5));
+  }
+  buffer.seek(0);
+
+  ReplayWindowSystemBackend windowSystem(&buffer);
+  QVERIFY(windowSystem.isValid());
+  ScreenTopology screenTopology;
+  screenTopology.setGeometries({QRect(0, 0, 1920, 1080)});
+  TaskHelper taskHelper(&windowSystem, &screenTopology);
+  const auto wIds = [](const std::vector<TaskInfo>& tasks) {
+    std::vector<WId> result;
+    for (const auto& task : tasks) {
+      result.push_back(task.wId);
+    }
+    return result;
+  };
+
+  auto tasks = taskHelper.registerDock(1, -1, true /* currentDesktopOnly */);
+  QCOMPARE(wIds(tasks), (std::vector<WId>{30, 10}));
+
+  connect(&taskHelper, &TaskHelper::taskAdded,
+          [&tasks](int, const TaskInfo& task) { tasks.push_back(task); });
+  QSignalSpy removedSpy(&taskHelper, &TaskHelper::taskRemoved);
+  windowSystem.replayAll();
+  QCOMPARE(static_cast<int>(tasks.size()), 4);
+  QCOMPARE(removedSpy.count(), 1);
+  tasks.erase(tasks.begin());  // 30 has been removed.
+  std::stable_sort(tasks.begin(), tasks.end());
+  QCOMPARE(wIds(tasks), (std::vector<WId>{10, 20, 5}));
+  QVERIFY(taskHelper.getTaskInfo(20).creationOrder <
+          taskHelper.getTaskInfo(5).creationOrder);
+
+  // Rebuilt from the window list.
+  tasks = taskHelper.registerDock(1, -1, true /* currentDesktopOnly */);
+  QCOMPARE(wIds(tasks), (std::vector<WId>{10, 20, 5}));
+}
+
+void TaskHelperTest::windowIcon() {
+  QBuffer buffer;
+  buffer.open(QIODevice::ReadWrite);
+  {
+    WindowSystemTraceWriter writer(&buffer);
+    TraceSnapshot snapshot;
+    snapshot.windows.emplace_back(10, createWindow("Konsole"));
+    snapshot.windows.emplace_back(20, createWindow("Dolphin"));
+    writer.writeSnapshot(snapshot);
+    writer.writeEvent(createEvent(TraceEvent::Type::WindowAdded, 30));
+    writer.writeEvent(createChangeEvent(10, NET::WMState));
+    writer.writeEvent(createChangeEvent(10, NET::WMIcon));
+  }
+  buffer.seek(0);
+
+  IconCountingWindowSystem windowSystem(&buffer);
+  QVERIFY(windowSystem.isValid());
+  ScreenTopology screenTopology;
+  screenTopology.setGeometries({QRect(0, 0, 1920, 1080)});
+  TaskHelper taskHelper(&windowSystem, &screenTopology);
+  std::unordered_map<WId, TaskInfo> tasks;
+  const auto addTask = [&tasks](int, const TaskInfo& task) {
+    tasks.erase(task.wId);
+    tasks.emplace(task.wId, task);
+  };
+  connect(&taskHelper, &TaskHelper::taskAdded, addTask);
+  connect(&taskHelper, &TaskHelper::taskUpdated, addTask);
+
+  // Neither loading nor adding nor updating tasks fetches their icons.
+  for (const auto& task :
+       taskHelper.registerDock(1, -1, true /* currentDesktopOnly */)) {
+    addTask(1, task);
+  }
+  QVERIFY(windowSystem.step());  // 30 added.
+  QVERIFY(windowSystem.step());  // 10 state changed.
+  QCOMPARE(static_cast<int>(tasks.size()), 3);
+  QVERIFY(windowSystem.iconFetches.empty());
+
+  // The icons are fetched once per window.
+  for (int i = 0; i < 2; ++i) {
+    for (const auto& task : tasks) {
+      QVERIFY(task.second.icon);
+      task.second.icon();
+    }
+  }
+  QCOMPARE(windowSystem.iconFetches,
+           (std::unordered_map<WId, int>{{10, 1}, {20, 1}, {30, 1}}));
+
+  // And once more after a window's icon has changed.
+  QVERIFY(windowSystem.step());  // 10 icon changed.
+  QCOMPARE(windowSystem.iconFetches[10], 1);
+  for (int i = 0; i < 2; ++i) {
+    tasks.at(10).icon();
+  }
+  QCOMPARE(windowSystem.iconFetches,
+           (std::unordered_map<WId, int>{{10, 2}, {20, 1}, {30, 1}}));
+}
+
+void TaskHelperTest::sortTasks_sameProgram_benchmark() {
+  const auto shuffledTasks = createSameProgramTasks(kNumSameProgramTasks);
+  QBENCHMARK {
+    auto tasks = shuffledTasks;
+    std::stable_sort(tasks.begin(), tasks.end());
+  }
+}
+
+}  // namespace ksmoothdock
+
+QTEST_MAIN(ksmoothdock::TaskHelperTest)
+#include "task_helper_test.moc"
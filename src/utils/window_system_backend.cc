@@ -0,0 +1,57 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2018 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "window_system_backend.h"
+
+#include <iostream>
+
+#include <QTimer>
+
+#include "kwindowsystem_backend.h"
+#include "window_system_trace.h"
+
+namespace ksmoothdock {
+
+const NET::Properties WindowSystemBackend::kProperties =
+    NET::WMState | NET::WMWindowType | NET::WMVisibleName | NET::WMDesktop |
+    NET::WMFrameExtents;
+const NET::Properties2 WindowSystemBackend::kProperties2 =
+    NET::WM2WindowClass | NET::WM2Activities;
+
+/* static */ std::unique_ptr<WindowSystemBackend> WindowSystemBackend::create() {
+  const QString replayTrace = qEnvironmentVariable("UNICORNDOCK_REPLAY_TRACE");
+  if (!replayTrace.isEmpty()) {
+    std::cout << "Replaying window system trace " << replayTrace.toStdString() << "\n";
+    auto backend = std::make_unique<ReplayWindowSystemBackend>(replayTrace);
+    // Starts once the event loop is running and the docks have been created.
+    auto* replay = backend.get();
+    QTimer::singleShot(0, replay, [replay]() { replay->start(); });
+    return backend;
+  }
+
+  const QString recordTrace = qEnvironmentVariable("UNICORNDOCK_RECORD_TRACE");
+  if (!recordTrace.isEmpty()) {
+    std::cout << "Recording window system trace " << recordTrace.toStdString() << "\n";
+    return std::make_unique<RecordingWindowSystemBackend>(
+        std::make_unique<KWindowSystemBackend>(), recordTrace);
+  }
+
+  return std::make_unique<KWindowSystemBackend>();
+}
+
+}  // namespace ksmoothdock
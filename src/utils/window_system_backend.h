@@ -0,0 +1,109 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2018 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KSMOOTHDOCK_WINDOW_SYSTEM_BACKEND_H_
+#define KSMOOTHDOCK_WINDOW_SYSTEM_BACKEND_H_
+
+#include <memory>
+
+#include <QList>
+#include <QObject>
+#include <QPixmap>
+#include <QRect>
+#include <QString>
+#include <QStringList>
+
+#include <netwm_def.h>
+
+namespace ksmoothdock {
+
+// Properties of a window, as used by the task manager.
+struct WindowProperties {
+  bool valid = false;
+  NET::WindowType windowType = NET::Unknown;
+  NET::States state;
+  QString windowClassClass;  // e.g. Dolphin
+  QString windowClassName;  // e.g. dolphin
+  QString visibleName;  // e.g. home -- Dolphin
+  int desktop = 0;
+  bool onAllDesktops = false;
+  QStringList activities;
+  QRect frameGeometry;
+};
+
+// The window system as seen by the task manager: window list, window
+// properties, desktops, activities and the related change events.
+//
+// The real implementation is backed by KWindowSystem. Other implementations
+// record the events to a trace file, or replay a trace, so that the task
+// manager can be tested and benchmarked without a live X session.
+class WindowSystemBackend : public QObject {
+  Q_OBJECT
+
+ public:
+  // All the properties that can be fetched by windowInfo().
+  static const NET::Properties kProperties;
+  static const NET::Properties2 kProperties2;
+
+  // Creates the backend selected by the environment:
+  //   UNICORNDOCK_REPLAY_TRACE=<file>: replays the trace file;
+  //   UNICORNDOCK_RECORD_TRACE=<file>: uses KWindowSystem and records the
+  //   window events to the trace file;
+  // otherwise uses KWindowSystem.
+  static std::unique_ptr<WindowSystemBackend> create();
+
+  virtual ~WindowSystemBackend() = default;
+
+  // Windows in the order of creation.
+  virtual QList<WId> windows() const = 0;
+  virtual bool hasWId(WId wId) const = 0;
+  virtual WId activeWindow() const = 0;
+  virtual int currentDesktop() const = 0;
+  virtual int numberOfDesktops() const = 0;
+  virtual QString currentActivity() const = 0;
+
+  // Fetches the specified properties of a window into windowProperties,
+  // with a single round-trip to the window system. Other fields are left
+  // untouched.
+  virtual void windowInfo(WId wId, NET::Properties properties,
+                          NET::Properties2 properties2,
+                          WindowProperties* windowProperties) const = 0;
+
+  // Gets the window icon scaled to the specified size.
+  virtual QPixmap icon(WId wId, int width, int height) const = 0;
+
+  // Window requests.
+  virtual void activateWindow(WId wId) = 0;
+  virtual void minimizeWindow(WId wId) = 0;
+  // Raises the windows in a single batch, the last one ending up on top.
+  virtual void raiseWindows(const QList<WId>& wIds) = 0;
+
+ signals:
+  void windowAdded(WId wId);
+  void windowRemoved(WId wId);
+  void windowChanged(WId wId, NET::Properties properties,
+                     NET::Properties2 properties2);
+  void activeWindowChanged(WId wId);
+  void currentDesktopChanged(int desktop);
+  void numberOfDesktopsChanged(int number);
+  void currentActivityChanged(QString activity);
+};
+
+}  // namespace ksmoothdock
+
+#endif  // KSMOOTHDOCK_WINDOW_SYSTEM_BACKEND_H_
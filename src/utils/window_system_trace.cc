@@ -0,0 +1,442 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2018 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "window_system_trace.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace ksmoothdock {
+
+namespace {
+
+constexpr quint32 kTraceMagic = 0x55445452;  // "UDTR"
+constexpr quint16 kTraceVersion = 1;
+constexpr QDataStream::Version kStreamVersion = QDataStream::Qt_5_9;
+
+void writeWId(QDataStream& out, WId wId) {
+  out << static_cast<quint64>(wId);
+}
+
+WId readWId(QDataStream& in) {
+  quint64 wId = 0;
+  in >> wId;
+  return static_cast<WId>(wId);
+}
+
+void writeProperties(QDataStream& out, const WindowProperties& properties) {
+  out << properties.valid
+      << static_cast<qint32>(properties.windowType)
+      << static_cast<qint32>(properties.state)
+      << properties.windowClassClass
+      << properties.windowClassName
+      << properties.visibleName
+      << static_cast<qint32>(properties.desktop)
+      << properties.onAllDesktops
+      << properties.activities
+      << properties.frameGeometry;
+}
+
+void readProperties(QDataStream& in, WindowProperties* properties) {
+  qint32 windowType = 0;
+  qint32 state = 0;
+  qint32 desktop = 0;
+  in >> properties->valid
+     >> windowType
+     >> state
+     >> properties->windowClassClass
+     >> properties->windowClassName
+     >> properties->visibleName
+     >> desktop
+     >> properties->onAllDesktops
+     >> properties->activities
+     >> properties->frameGeometry;
+  properties->windowType = static_cast<NET::WindowType>(windowType);
+  properties->state = NET::States(QFlag(state));
+  properties->desktop = desktop;
+}
+
+}  // namespace
+
+WindowSystemTraceWriter::WindowSystemTraceWriter(QIODevice* device)
+    : out_(device) {
+  out_.setVersion(kStreamVersion);
+}
+
+void WindowSystemTraceWriter::writeSnapshot(const TraceSnapshot& snapshot) {
+  out_ << kTraceMagic << kTraceVersion
+       << static_cast<qint32>(snapshot.currentDesktop)
+       << static_cast<qint32>(snapshot.numberOfDesktops)
+       << snapshot.currentActivity;
+  writeWId(out_, snapshot.activeWindow);
+  out_ << static_cast<quint32>(snapshot.windows.size());
+  for (const auto& window : snapshot.windows) {
+    writeWId(out_, window.first);
+    writeProperties(out_, window.second);
+  }
+}
+
+void WindowSystemTraceWriter::writeEvent(const TraceEvent& event) {
+  out_ << static_cast<quint8>(event.type) << event.time;
+  switch (event.type) {
+    case TraceEvent::Type::WindowAdded:
+      writeWId(out_, event.wId);
+      writeProperties(out_, event.properties);
+      break;
+    case TraceEvent::Type::WindowChanged:
+      writeWId(out_, event.wId);
+      out_ << event.value << event.value2;
+      writeProperties(out_, event.properties);
+      break;
+    case TraceEvent::Type::WindowRemoved:
+    case TraceEvent::Type::ActiveWindowChanged:
+      writeWId(out_, event.wId);
+      break;
+    case TraceEvent::Type::CurrentDesktopChanged:
+    case TraceEvent::Type::NumberOfDesktopsChanged:
+      out_ << event.value;
+      break;
+    case TraceEvent::Type::CurrentActivityChanged:
+      out_ << event.activity;
+      break;
+  }
+}
+
+WindowSystemTraceReader::WindowSystemTraceReader(QIODevice* device)
+    : in_(device) {
+  in_.setVersion(kStreamVersion);
+}
+
+bool WindowSystemTraceReader::readSnapshot(TraceSnapshot* snapshot) {
+  quint32 magic = 0;
+  quint16 version = 0;
+  in_ >> magic >> version;
+  if (magic != kTraceMagic || version != kTraceVersion) {
+    return false;
+  }
+
+  qint32 currentDesktop = 0;
+  qint32 numberOfDesktops = 0;
+  quint32 windowCount = 0;
+  in_ >> currentDesktop >> numberOfDesktops >> snapshot->currentActivity;
+  snapshot->activeWindow = readWId(in_);
+  in_ >> windowCount;
+  snapshot->currentDesktop = currentDesktop;
+  snapshot->numberOfDesktops = numberOfDesktops;
+  snapshot->windows.clear();
+  for (quint32 i = 0; i < windowCount && in_.status() == QDataStream::Ok; ++i) {
+    const WId wId = readWId(in_);
+    WindowProperties properties;
+    readProperties(in_, &properties);
+    snapshot->windows.emplace_back(wId, properties);
+  }
+  return in_.status() == QDataStream::Ok;
+}
+
+bool WindowSystemTraceReader::readEvent(TraceEvent* event) {
+  if (in_.atEnd()) {
+    return false;
+  }
+
+  quint8 type = 0;
+  in_ >> type >> event->time;
+  event->type = static_cast<TraceEvent::Type>(type);
+  switch (event->type) {
+    case TraceEvent::Type::WindowAdded:
+      event->wId = readWId(in_);
+      readProperties(in_, &event->properties);
+      break;
+    case TraceEvent::Type::WindowChanged:
+      event->wId = readWId(in_);
+      in_ >> event->value >> event->value2;
+      readProperties(in_, &event->properties);
+      break;
+    case TraceEvent::Type::WindowRemoved:
+    case TraceEvent::Type::ActiveWindowChanged:
+      event->wId = readWId(in_);
+      break;
+    case TraceEvent::Type::CurrentDesktopChanged:
+    case TraceEvent::Type::NumberOfDesktopsChanged:
+      in_ >> event->value;
+      break;
+    case TraceEvent::Type::CurrentActivityChanged:
+      in_ >> event->activity;
+      break;
+    default:
+      std::cerr << "Unknown window system trace event: " << static_cast<int>(type)
+                << std::endl;
+      return false;
+  }
+  return in_.status() == QDataStream::Ok;
+}
+
+RecordingWindowSystemBackend::RecordingWindowSystemBackend(
+    std::unique_ptr<WindowSystemBackend> backend, const QString& tracePath)
+    : backend_(std::move(backend)),
+      file_(tracePath),
+      writer_(&file_) {
+  if (!file_.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    std::cerr << "Failed to open the window system trace file for writing: "
+              << tracePath.toStdString() << std::endl;
+  }
+
+  TraceSnapshot snapshot;
+  snapshot.currentDesktop = backend_->currentDesktop();
+  snapshot.numberOfDesktops = backend_->numberOfDesktops();
+  snapshot.currentActivity = backend_->currentActivity();
+  snapshot.activeWindow = backend_->activeWindow();
+  for (const auto wId : backend_->windows()) {
+    WindowProperties properties;
+    backend_->windowInfo(wId, kProperties, kProperties2, &properties);
+    snapshot.windows.emplace_back(wId, properties);
+  }
+  writer_.writeSnapshot(snapshot);
+  file_.flush();
+  elapsedTimer_.start();
+
+  auto* source = backend_.get();
+  connect(source, &WindowSystemBackend::windowAdded,
+          this, &RecordingWindowSystemBackend::onWindowAdded);
+  connect(source, &WindowSystemBackend::windowRemoved,
+          this, &RecordingWindowSystemBackend::onWindowRemoved);
+  connect(source, &WindowSystemBackend::windowChanged,
+          this, &RecordingWindowSystemBackend::onWindowChanged);
+  connect(source, &WindowSystemBackend::activeWindowChanged,
+          this, &RecordingWindowSystemBackend::onActiveWindowChanged);
+  connect(source, &WindowSystemBackend::currentDesktopChanged,
+          this, &RecordingWindowSystemBackend::onCurrentDesktopChanged);
+  connect(source, &WindowSystemBackend::numberOfDesktopsChanged,
+          this, &RecordingWindowSystemBackend::onNumberOfDesktopsChanged);
+  connect(source, &WindowSystemBackend::currentActivityChanged,
+          this, &RecordingWindowSystemBackend::onCurrentActivityChanged);
+}
+
+void RecordingWindowSystemBackend::onWindowAdded(WId wId) {
+  auto event = createEvent(TraceEvent::Type::WindowAdded, wId);
+  backend_->windowInfo(wId, kProperties, kProperties2, &event.properties);
+  record(event);
+  emit windowAdded(wId);
+}
+
+void RecordingWindowSystemBackend::onWindowRemoved(WId wId) {
+  record(createEvent(TraceEvent::Type::WindowRemoved, wId));
+  emit windowRemoved(wId);
+}
+
+void RecordingWindowSystemBackend::onWindowChanged(
+    WId wId, NET::Properties properties, NET::Properties2 properties2) {
+  auto event = createEvent(TraceEvent::Type::WindowChanged, wId);
+  event.value = static_cast<qint32>(properties);
+  event.value2 = static_cast<qint32>(properties2);
+  backend_->windowInfo(wId, kProperties, kProperties2, &event.properties);
+  record(event);
+  emit windowChanged(wId, properties, properties2);
+}
+
+void RecordingWindowSystemBackend::onActiveWindowChanged(WId wId) {
+  record(createEvent(TraceEvent::Type::ActiveWindowChanged, wId));
+  emit activeWindowChanged(wId);
+}
+
+void RecordingWindowSystemBackend::onCurrentDesktopChanged(int desktop) {
+  auto event = createEvent(TraceEvent::Type::CurrentDesktopChanged);
+  event.value = desktop;
+  record(event);
+  emit currentDesktopChanged(desktop);
+}
+
+void RecordingWindowSystemBackend::onNumberOfDesktopsChanged(int number) {
+  auto event = createEvent(TraceEvent::Type::NumberOfDesktopsChanged);
+  event.value = number;
+  record(event);
+  emit numberOfDesktopsChanged(number);
+}
+
+void RecordingWindowSystemBackend::onCurrentActivityChanged(QString activity) {
+  auto event = createEvent(TraceEvent::Type::CurrentActivityChanged);
+  event.activity = activity;
+  record(event);
+  emit currentActivityChanged(activity);
+}
+
+TraceEvent RecordingWindowSystemBackend::createEvent(TraceEvent::Type type, WId wId) {
+  TraceEvent event;
+  event.type = type;
+  event.time = elapsedTimer_.elapsed();
+  event.wId = wId;
+  return event;
+}
+
+void RecordingWindowSystemBackend::record(const TraceEvent& event) {
+  writer_.writeEvent(event);
+  // So that the trace is usable even if the dock doesn't exit cleanly.
+  file_.flush();
+}
+
+ReplayWindowSystemBackend::ReplayWindowSystemBackend(const QString& tracePath) {
+  QFile file(tracePath);
+  if (!file.open(QIODevice::ReadOnly)) {
+    std::cerr << "Failed to open the window system trace file: "
+              << tracePath.toStdString() << std::endl;
+    return;
+  }
+  load(&file);
+}
+
+ReplayWindowSystemBackend::ReplayWindowSystemBackend(QIODevice* device) {
+  load(device);
+}
+
+void ReplayWindowSystemBackend::load(QIODevice* device) {
+  timer_.setSingleShot(true);
+  connect(&timer_, &QTimer::timeout, this, [this]() {
+    step();
+    scheduleNextEvent();
+  });
+
+  WindowSystemTraceReader reader(device);
+  TraceSnapshot snapshot;
+  if (!reader.readSnapshot(&snapshot)) {
+    std::cerr << "Invalid window system trace" << std::endl;
+    return;
+  }
+
+  currentDesktop_ = snapshot.currentDesktop;
+  numberOfDesktops_ = snapshot.numberOfDesktops;
+  currentActivity_ = snapshot.currentActivity;
+  activeWindow_ = snapshot.activeWindow;
+  for (const auto& window : snapshot.windows) {
+    windows_.append(window.first);
+    properties_[window.first] = window.second;
+  }
+
+  TraceEvent event;
+  while (reader.readEvent(&event)) {
+    events_.push_back(event);
+  }
+  valid_ = true;
+}
+
+bool ReplayWindowSystemBackend::step() {
+  if (atEnd()) {
+    return false;
+  }
+
+  const auto& event = events_[nextEvent_++];
+  switch (event.type) {
+    case TraceEvent::Type::WindowAdded:
+      if (properties_.count(event.wId) == 0) {
+        windows_.append(event.wId);
+      }
+      properties_[event.wId] = event.properties;
+      emit windowAdded(event.wId);
+      break;
+    case TraceEvent::Type::WindowRemoved:
+      windows_.removeAll(event.wId);
+      properties_.erase(event.wId);
+      emit windowRemoved(event.wId);
+      break;
+    case TraceEvent::Type::WindowChanged: {
+      // E.g. a change recorded after the window has been removed.
+      const auto it = properties_.find(event.wId);
+      if (it == properties_.end()) {
+        break;
+      }
+      it->second = event.properties;
+      emit windowChanged(event.wId, NET::Properties(QFlag(event.value)),
+                         NET::Properties2(QFlag(event.value2)));
+      break;
+    }
+    case TraceEvent::Type::ActiveWindowChanged:
+      activeWindow_ = event.wId;
+      emit activeWindowChanged(event.wId);
+      break;
+    case TraceEvent::Type::CurrentDesktopChanged:
+      currentDesktop_ = event.value;
+      emit currentDesktopChanged(event.value);
+      break;
+    case TraceEvent::Type::NumberOfDesktopsChanged:
+      numberOfDesktops_ = event.value;
+      emit numberOfDesktopsChanged(event.value);
+      break;
+    case TraceEvent::Type::CurrentActivityChanged:
+      currentActivity_ = event.activity;
+      emit currentActivityChanged(event.activity);
+      break;
+  }
+  return true;
+}
+
+void ReplayWindowSystemBackend::replayAll() {
+  while (step()) {}
+}
+
+void ReplayWindowSystemBackend::start(double speed) {
+  speed_ = (speed > 0) ? speed : 1.0;
+  // Times are relative to the next event.
+  startTime_ = atEnd() ? 0 : events_[nextEvent_].time;
+  elapsedTimer_.start();
+  scheduleNextEvent();
+}
+
+void ReplayWindowSystemBackend::windowInfo(WId wId, NET::Properties properties,
+                                           NET::Properties2 properties2,
+                                           WindowProperties* windowProperties) const {
+  const auto it = properties_.find(wId);
+  windowProperties->valid = (it != properties_.end()) && it->second.valid;
+  if (!windowProperties->valid) {
+    return;
+  }
+
+  const auto& info = it->second;
+  if (properties & NET::WMState) {
+    windowProperties->state = info.state;
+  }
+  if (properties & NET::WMWindowType) {
+    windowProperties->windowType = info.windowType;
+  }
+  if (properties & NET::WMVisibleName) {
+    windowProperties->visibleName = info.visibleName;
+  }
+  if (properties & NET::WMDesktop) {
+    windowProperties->desktop = info.desktop;
+    windowProperties->onAllDesktops = info.onAllDesktops;
+  }
+  if (properties & NET::WMFrameExtents) {
+    windowProperties->frameGeometry = info.frameGeometry;
+  }
+  if (properties2 & NET::WM2WindowClass) {
+    windowProperties->windowClassClass = info.windowClassClass;
+    windowProperties->windowClassName = info.windowClassName;
+  }
+  if (properties2 & NET::WM2Activities) {
+    windowProperties->activities = info.activities;
+  }
+}
+
+void ReplayWindowSystemBackend::scheduleNextEvent() {
+  if (atEnd()) {
+    return;
+  }
+
+  const qint64 due =
+      static_cast<qint64>((events_[nextEvent_].time - startTime_) / speed_);
+  timer_.start(static_cast<int>(std::max<qint64>(due - elapsedTimer_.elapsed(), 0)));
+}
+
+}  // namespace ksmoothdock
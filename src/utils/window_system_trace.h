@@ -0,0 +1,230 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2018 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KSMOOTHDOCK_WINDOW_SYSTEM_TRACE_H_
+#define KSMOOTHDOCK_WINDOW_SYSTEM_TRACE_H_
+
+#include "window_system_backend.h"
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QIODevice>
+#include <QTimer>
+
+namespace ksmoothdock {
+
+// Window system traces.
+//
+// A trace is a binary QDataStream file that starts with a snapshot of the
+// window system state (desktops, activity, active window, windows with all
+// their properties), followed by the window system events with their times.
+// Window added/changed events carry all the window's properties after the
+// event, so that a replay can answer any property query. Window icons are
+// not recorded.
+
+// The initial window system state of a trace.
+struct TraceSnapshot {
+  int currentDesktop = 1;
+  int numberOfDesktops = 1;
+  QString currentActivity;
+  WId activeWindow = 0;
+  // Windows in the order of creation.
+  std::vector<std::pair<WId, WindowProperties>> windows;
+};
+
+// A window system event in a trace.
+struct TraceEvent {
+  enum class Type : quint8 {
+    WindowAdded,
+    WindowRemoved,
+    WindowChanged,
+    ActiveWindowChanged,
+    CurrentDesktopChanged,
+    NumberOfDesktopsChanged,
+    CurrentActivityChanged
+  };
+
+  Type type = Type::WindowAdded;
+  // Milliseconds since the start of the trace.
+  qint64 time = 0;
+  WId wId = 0;
+  // NET::Properties/NET::Properties2 for WindowChanged, the desktop number
+  // for CurrentDesktopChanged and NumberOfDesktopsChanged.
+  qint32 value = 0;
+  qint32 value2 = 0;
+  // The activity for CurrentActivityChanged.
+  QString activity;
+  // The window's properties after WindowAdded/WindowChanged.
+  WindowProperties properties;
+};
+
+// Writes a trace to a device. No ownership.
+class WindowSystemTraceWriter {
+ public:
+  explicit WindowSystemTraceWriter(QIODevice* device);
+
+  void writeSnapshot(const TraceSnapshot& snapshot);
+  void writeEvent(const TraceEvent& event);
+
+ private:
+  QDataStream out_;
+};
+
+// Reads a trace from a device. No ownership.
+class WindowSystemTraceReader {
+ public:
+  explicit WindowSystemTraceReader(QIODevice* device);
+
+  // Returns false if the device doesn't contain a valid trace header and
+  // snapshot.
+  bool readSnapshot(TraceSnapshot* snapshot);
+  // Returns false at the end of the trace.
+  bool readEvent(TraceEvent* event);
+
+ private:
+  QDataStream in_;
+};
+
+// Uses another backend and records its snapshot and events to a trace file.
+class RecordingWindowSystemBackend : public WindowSystemBackend {
+  Q_OBJECT
+
+ public:
+  RecordingWindowSystemBackend(std::unique_ptr<WindowSystemBackend> backend,
+                               const QString& tracePath);
+  ~RecordingWindowSystemBackend() = default;
+
+  QList<WId> windows() const override { return backend_->windows(); }
+  bool hasWId(WId wId) const override { return backend_->hasWId(wId); }
+  WId activeWindow() const override { return backend_->activeWindow(); }
+  int currentDesktop() const override { return backend_->currentDesktop(); }
+  int numberOfDesktops() const override { return backend_->numberOfDesktops(); }
+  QString currentActivity() const override { return backend_->currentActivity(); }
+
+  void windowInfo(WId wId, NET::Properties properties,
+                  NET::Properties2 properties2,
+                  WindowProperties* windowProperties) const override {
+    backend_->windowInfo(wId, properties, properties2, windowProperties);
+  }
+
+  QPixmap icon(WId wId, int width, int height) const override {
+    return backend_->icon(wId, width, height);
+  }
+
+  // Requests are not recorded, only their effects on the window system.
+  void activateWindow(WId wId) override { backend_->activateWindow(wId); }
+  void minimizeWindow(WId wId) override { backend_->minimizeWindow(wId); }
+  void raiseWindows(const QList<WId>& wIds) override {
+    backend_->raiseWindows(wIds);
+  }
+
+ private slots:
+  void onWindowAdded(WId wId);
+  void onWindowRemoved(WId wId);
+  void onWindowChanged(WId wId, NET::Properties properties,
+                       NET::Properties2 properties2);
+  void onActiveWindowChanged(WId wId);
+  void onCurrentDesktopChanged(int desktop);
+  void onNumberOfDesktopsChanged(int number);
+  void onCurrentActivityChanged(QString activity);
+
+ private:
+  TraceEvent createEvent(TraceEvent::Type type, WId wId = 0);
+  void record(const TraceEvent& event);
+
+  std::unique_ptr<WindowSystemBackend> backend_;
+  QFile file_;
+  WindowSystemTraceWriter writer_;
+  QElapsedTimer elapsedTimer_;
+};
+
+// Replays a trace deterministically.
+class ReplayWindowSystemBackend : public WindowSystemBackend {
+  Q_OBJECT
+
+ public:
+  explicit ReplayWindowSystemBackend(const QString& tracePath);
+  explicit ReplayWindowSystemBackend(QIODevice* device);
+  ~ReplayWindowSystemBackend() = default;
+
+  // Whether the trace has been loaded successfully.
+  bool isValid() const { return valid_; }
+
+  int eventCount() const { return static_cast<int>(events_.size()); }
+  bool atEnd() const { return nextEvent_ >= events_.size(); }
+
+  // Applies the next event and emits its signal. Returns false at the end.
+  bool step();
+
+  // Applies all the remaining events, as fast as possible.
+  void replayAll();
+
+  // Applies the remaining events from the event loop, with the recorded
+  // timing scaled by 1 / speed.
+  void start(double speed = 1.0);
+
+  QList<WId> windows() const override { return windows_; }
+  bool hasWId(WId wId) const override { return properties_.count(wId) > 0; }
+  WId activeWindow() const override { return activeWindow_; }
+  int currentDesktop() const override { return currentDesktop_; }
+  int numberOfDesktops() const override { return numberOfDesktops_; }
+  QString currentActivity() const override { return currentActivity_; }
+
+  void windowInfo(WId wId, NET::Properties properties,
+                  NET::Properties2 properties2,
+                  WindowProperties* windowProperties) const override;
+
+  // Icons are not recorded.
+  QPixmap icon(WId, int, int) const override { return QPixmap(); }
+
+  // The trace drives the window system state, so requests are ignored.
+  void activateWindow(WId) override {}
+  void minimizeWindow(WId) override {}
+  void raiseWindows(const QList<WId>&) override {}
+
+ private:
+  void load(QIODevice* device);
+  void scheduleNextEvent();
+
+  bool valid_ = false;
+  std::vector<TraceEvent> events_;
+  size_t nextEvent_ = 0;
+
+  QList<WId> windows_;
+  std::unordered_map<WId, WindowProperties> properties_;
+  WId activeWindow_ = 0;
+  int currentDesktop_ = 1;
+  int numberOfDesktops_ = 1;
+  QString currentActivity_;
+
+  double speed_ = 1.0;
+  qint64 startTime_ = 0;
+  QTimer timer_;
+  QElapsedTimer elapsedTimer_;
+};
+
+}  // namespace ksmoothdock
+
+#endif  // KSMOOTHDOCK_WINDOW_SYSTEM_TRACE_H_
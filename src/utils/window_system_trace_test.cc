@@ -0,0 +1,271 @@
+/*
+ * This file is part of KSmoothDock.
+ * Copyright (C) 2018 Viet Dang (dangvd@gmail.com)
+ *
+ * KSmoothDock is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KSmoothDock is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with KSmoothDock.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "window_system_trace.h"
+
+#include <memory>
+
+#include <QBuffer>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "screen_topology.h"
+#include "task_helper.h"
+
+namespace ksmoothdock {
+
+// Number of windows opened then closed by the benchmark trace.
+constexpr int kNumBenchmarkWindows = 500;
+
+class WindowSystemTraceTest: public QObject {
+  Q_OBJECT
+
+ private slots:
+  // Tests that replaying a trace delivers the expected task deltas.
+  void replay();
+
+  // Tests that recording a backend produces an equivalent trace.
+  void record();
+
+  // Tests that the active window is tracked once, with one signal per change.
+  void activeWindow();
+
+  // Tests that a change of an unknown window is ignored.
+  void windowChanged_unknownWindow();
+
+  // Benchmarks the task manager's processing of a trace.
+  void replay_benchmark();
+
+ private:
+  static WindowProperties createWindow(const QString& program, int desktop) {
+    WindowProperties properties;
+    properties.valid = true;
+    properties.windowType = NET::Normal;
+    properties.windowClassClass = program;
+    properties.windowClassName = program.toLower();
+    properties.visibleName = program;
+    properties.desktop = desktop;
+    properties.frameGeometry = QRect(100, 100, 800, 600);
+    return properties;
+  }
+
+  static TraceEvent createEvent(TraceEvent::Type type, qint64 time, WId wId = 0) {
+    TraceEvent event;
+    event.type = type;
+    event.time = time;
+    event.wId = wId;
+    return event;
+  }
+
+  // Writes a trace with one window in the snapshot, then a window added on
+  // desktop 1, a window added on desktop 2, a desktop switch and a window
+  // removed.
+  static void writeTrace(QIODevice* device) {
+    WindowSystemTraceWriter writer(device);
+    TraceSnapshot snapshot;
+    snapshot.numberOfDesktops = 2;
+    snapshot.windows.emplace_back(1, createWindow("Dolphin", 1));
+    writer.writeSnapshot(snapshot);
+
+    auto event = createEvent(TraceEvent::Type::WindowAdded, 10, 2);
+    event.properties = createWindow("Konsole", 1);
+    writer.writeEvent(event);
+    event = createEvent(TraceEvent::Type::WindowAdded, 20, 3);
+    event.properties = createWindow("Firefox", 2);
+    writer.writeEvent(event);
+    event = createEvent(TraceEvent::Type::CurrentDesktopChanged, 30);
+    event.value = 2;
+    writer.writeEvent(event);
+    writer.writeEvent(createEvent(TraceEvent::Type::WindowRemoved, 40, 3));
+  }
+};
+
+void WindowSystemTraceTest::replay() {
+  QBuffer buffer;
+  buffer.open(QIODevice::ReadWrite);
+  writeTrace(&buffer);
+  buffer.seek(0);
+
+  ReplayWindowSystemBackend windowSystem(&buffer);
+  QVERIFY(windowSystem.isValid());
+  QCOMPARE(windowSystem.eventCount(), 4);
+
+  ScreenTopology screenTopology;
+  screenTopology.setGeometries({QRect(0, 0, 1920, 1080)});
+  TaskHelper taskHelper(&windowSystem, &screenTopology);
+  const auto tasks = taskHelper.registerDock(1, -1, true /* currentDesktopOnly */);
+  QCOMPARE(static_cast<int>(tasks.size()), 1);
+  QCOMPARE(tasks[0].program, QString("Dolphin"));
+
+  QSignalSpy addedSpy(&taskHelper, &TaskHelper::taskAdded);
+  QSignalSpy removedSpy(&taskHelper, &TaskHelper::taskRemoved);
+  windowSystem.replayAll();
+  QVERIFY(windowSystem.atEnd());
+
+  // Konsole added on desktop 1, Firefox added on switching to desktop 2.
+  QCOMPARE(addedSpy.count(), 2);
+  // Dolphin and Konsole removed on switching to desktop 2, then Firefox closed.
+  QCOMPARE(removedSpy.count(), 3);
+  QCOMPARE(removedSpy.last().at(1).value<WId>(), static_cast<WId>(3));
+  QCOMPARE(windowSystem.currentDesktop(), 2);
+  QCOMPARE(windowSystem.windows(), (QList<WId>{1, 2}));
+}
+
+void WindowSystemTraceTest::record() {
+  QBuffer buffer;
+  buffer.open(QIODevice::ReadWrite);
+  writeTrace(&buffer);
+  buffer.seek(0);
+
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString tracePath = dir.path() + "/trace";
+  auto replay = std::make_unique<ReplayWindowSystemBackend>(&buffer);
+  auto* source = replay.get();
+  {
+    RecordingWindowSystemBackend recorder(std::move(replay), tracePath);
+    QSignalSpy addedSpy(&recorder, &WindowSystemBackend::windowAdded);
+    source->replayAll();
+    QCOMPARE(addedSpy.count(), 2);
+  }
+
+  ReplayWindowSystemBackend recorded(tracePath);
+  QVERIFY(recorded.isValid());
+  QCOMPARE(recorded.eventCount(), 4);
+  QCOMPARE(recorded.windows(), QList<WId>{1});
+  recorded.replayAll();
+  QCOMPARE(recorded.currentDesktop(), 2);
+  QCOMPARE(recorded.windows(), (QList<WId>{1, 2}));
+
+  WindowProperties properties;
+  recorded.windowInfo(2, WindowSystemBackend::kProperties,
+                      WindowSystemBackend::kProperties2, &properties);
+  QVERIFY(properties.valid);
+  QCOMPARE(properties.windowClassClass, QString("Konsole"));
+  QCOMPARE(properties.frameGeometry, QRect(100, 100, 800, 600));
+}
+
+void WindowSystemTraceTest::activeWindow() {
+  QBuffer buffer;
+  buffer.open(QIODevice::ReadWrite);
+  {
+    WindowSystemTraceWriter writer(&buffer);
+    TraceSnapshot snapshot;
+    snapshot.activeWindow = 1;
+    snapshot.windows.emplace_back(1, createWindow("Dolphin", 1));
+    snapshot.windows.emplace_back(2, createWindow("Konsole", 1));
+    writer.writeSnapshot(snapshot);
+    writer.writeEvent(createEvent(TraceEvent::Type::ActiveWindowChanged, 10, 2));
+    writer.writeEvent(createEvent(TraceEvent::Type::ActiveWindowChanged, 20, 2));
+    writer.writeEvent(createEvent(TraceEvent::Type::ActiveWindowChanged, 30, 0));
+  }
+  buffer.seek(0);
+
+  ReplayWindowSystemBackend windowSystem(&buffer);
+  ScreenTopology screenTopology;
+  TaskHelper taskHelper(&windowSystem, &screenTopology);
+  QCOMPARE(taskHelper.activeWindow(), static_cast<WId>(1));
+
+  QSignalSpy spy(&taskHelper, &TaskHelper::activeWindowChanged);
+  QVERIFY(windowSystem.step());
+  QCOMPARE(taskHelper.activeWindow(), static_cast<WId>(2));
+  QCOMPARE(spy.count(), 1);
+  QCOMPARE(spy.last().at(0).value<WId>(), static_cast<WId>(1));
+  QCOMPARE(spy.last().at(1).value<WId>(), static_cast<WId>(2));
+
+  // Unchanged.
+  QVERIFY(windowSystem.step());
+  QCOMPARE(spy.count(), 1);
+
+  QVERIFY(windowSystem.step());
+  QCOMPARE(taskHelper.activeWindow(), static_cast<WId>(0));
+  QCOMPARE(spy.count(), 2);
+}
+
+void WindowSystemTraceTest::windowChanged_unknownWindow() {
+  QBuffer buffer;
+  buffer.open(QIODevice::ReadWrite);
+  {
+    WindowSystemTraceWriter writer(&buffer);
+    TraceSnapshot snapshot;
+    snapshot.windows.emplace_back(1, createWindow("Dolphin", 1));
+    writer.writeSnapshot(snapshot);
+    writer.writeEvent(createEvent(TraceEvent::Type::WindowRemoved, 10, 1));
+    auto event = createEvent(TraceEvent::Type::WindowChanged, 20, 1);
+    event.value = NET::WMVisibleName;
+    event.properties = createWindow("Dolphin", 1);
+    writer.writeEvent(event);
+    event = createEvent(TraceEvent::Type::WindowAdded, 30, 1);
+    event.properties = createWindow("Konsole", 1);
+    writer.writeEvent(event);
+  }
+  buffer.seek(0);
+
+  ReplayWindowSystemBackend windowSystem(&buffer);
+  // NET::Properties isn't a registered metatype.
+  int changedCount = 0;
+  connect(&windowSystem, &WindowSystemBackend::windowChanged,
+          [&changedCount]() { ++changedCount; });
+  QVERIFY(windowSystem.step());
+  QVERIFY(windowSystem.step());
+  QCOMPARE(changedCount, 0);
+  QVERIFY(!windowSystem.hasWId(1));
+  QVERIFY(windowSystem.windows().isEmpty());
+
+  QVERIFY(windowSystem.step());
+  QVERIFY(windowSystem.hasWId(1));
+  QCOMPARE(windowSystem.windows(), QList<WId>{1});
+  WindowProperties properties;
+  windowSystem.windowInfo(1, WindowSystemBackend::kProperties,
+                          WindowSystemBackend::kProperties2, &properties);
+  QCOMPARE(properties.windowClassClass, QString("Konsole"));
+}
+
+void WindowSystemTraceTest::replay_benchmark() {
+  QBuffer buffer;
+  buffer.open(QIODevice::ReadWrite);
+  {
+    WindowSystemTraceWriter writer(&buffer);
+    writer.writeSnapshot(TraceSnapshot());
+    for (int i = 0; i < kNumBenchmarkWindows; ++i) {
+      auto event = createEvent(TraceEvent::Type::WindowAdded, i, 100 + i);
+      event.properties = createWindow((i % 2 == 0) ? "Konsole" : "Dolphin", 1);
+      writer.writeEvent(event);
+    }
+    for (int i = 0; i < kNumBenchmarkWindows; ++i) {
+      writer.writeEvent(createEvent(TraceEvent::Type::WindowRemoved,
+                                    kNumBenchmarkWindows + i, 100 + i));
+    }
+  }
+
+  ScreenTopology screenTopology;
+  screenTopology.setGeometries({QRect(0, 0, 1920, 1080)});
+  QBENCHMARK {
+    buffer.seek(0);
+    ReplayWindowSystemBackend windowSystem(&buffer);
+    TaskHelper taskHelper(&windowSystem, &screenTopology);
+    taskHelper.registerDock(1, 0, true /* currentDesktopOnly */);
+    windowSystem.replayAll();
+  }
+}
+
+}  // namespace ksmoothdock
+
+QTEST_MAIN(ksmoothdock::WindowSystemTraceTest)
+#include "window_system_trace_test.moc"
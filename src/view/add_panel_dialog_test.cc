@@ -22,6 +22,7 @@
 #include <memory>
 
 #include <QPushButton>
+#include <QStandardPaths>
 #include <QTemporaryDir>
 #include <QtTest>
 
@@ -33,6 +34,11 @@ class AddPanelDialogTest: public QObject {
   Q_OBJECT
 
  private slots:
+  void initTestCase() {
+    // Keeps the config caches out of the user's cache dir.
+    QStandardPaths::setTestModeEnabled(true);
+  }
+
   // Tests OK button in Add mode.
   void add_ok();
 
@@ -19,8 +19,12 @@
 #include "appearance_settings_dialog.h"
 #include "ui_appearance_settings_dialog.h"
 
+#include <algorithm>
 #include <cmath>
 
+#include <QGuiApplication>
+#include <QScreen>
+
 namespace ksmoothdock {
 
 namespace {
@@ -31,6 +35,15 @@ namespace {
   inline float transparencyPercentToAlphaF(int transparencyPercent) {
     return 1 - transparencyPercent / 100.0;
   }
+
+  // The interval between two previews, in milliseconds.
+  int previewInterval() {
+    constexpr qreal kDefaultRefreshRate = 60;
+    const QScreen* screen = QGuiApplication::primaryScreen();
+    const qreal refreshRate = (screen != nullptr && screen->refreshRate() > 0)
+        ? screen->refreshRate() : kDefaultRefreshRate;
+    return std::max(1, static_cast<int>(1000 / refreshRate));
+  }
 }
 
 AppearanceSettingsDialog::AppearanceSettingsDialog(QWidget* parent,
@@ -51,6 +64,26 @@ AppearanceSettingsDialog::AppearanceSettingsDialog(QWidget* parent,
   connect(ui->buttonBox, SIGNAL(clicked(QAbstractButton*)),
       this, SLOT(buttonClicked(QAbstractButton*)));
 
+  previewTimer_.setSingleShot(true);
+  previewTimer_.setInterval(previewInterval());
+  connect(&previewTimer_, SIGNAL(timeout()), this, SLOT(preview()));
+  connect(ui->minSize, SIGNAL(valueChanged(int)),
+      this, SLOT(schedulePreview()));
+  connect(ui->maxSize, SIGNAL(valueChanged(int)),
+      this, SLOT(schedulePreview()));
+  connect(ui->spacingFactor, SIGNAL(valueChanged(double)),
+      this, SLOT(schedulePreview()));
+  connect(backgroundColor_, SIGNAL(changed(const QColor&)),
+      this, SLOT(schedulePreview()));
+  connect(ui->backgroundTransparency, SIGNAL(valueChanged(int)),
+      this, SLOT(schedulePreview()));
+  connect(ui->showBorder, SIGNAL(toggled(bool)),
+      this, SLOT(schedulePreview()));
+  connect(borderColor_, SIGNAL(changed(const QColor&)),
+      this, SLOT(schedulePreview()));
+  connect(ui->tooltipFontSize, SIGNAL(valueChanged(int)),
+      this, SLOT(schedulePreview()));
+
   loadData();
 }
 
@@ -63,6 +96,12 @@ void AppearanceSettingsDialog::accept() {
   saveData();
 }
 
+void AppearanceSettingsDialog::reject() {
+  previewTimer_.stop();
+  QDialog::reject();
+  model_->cancelAppearancePreview();
+}
+
 void AppearanceSettingsDialog::buttonClicked(QAbstractButton* button) {
   auto role = ui->buttonBox->buttonRole(button);
   if (role == QDialogButtonBox::ApplyRole) {
@@ -82,6 +121,8 @@ void AppearanceSettingsDialog::loadData() {
   ui->showBorder->setChecked(model_->showBorder());
   borderColor_->setColor(model_->borderColor());
   ui->tooltipFontSize->setValue(model_->tooltipFontSize());
+  // Nothing to preview yet.
+  previewTimer_.stop();
 }
 
 void AppearanceSettingsDialog::resetData() {
@@ -95,7 +136,35 @@ void AppearanceSettingsDialog::resetData() {
   ui->tooltipFontSize->setValue(kDefaultTooltipFontSize);
 }
 
+void AppearanceSettingsDialog::schedulePreview() {
+  if (!previewTimer_.isActive()) {
+    previewTimer_.start();
+  }
+}
+
+void AppearanceSettingsDialog::preview() {
+  if (ui->minSize->value() > ui->maxSize->value()) {
+    // Not a valid size range yet.
+    return;
+  }
+
+  AppearanceSettings settings = model_->appearanceSettings();
+  settings.minIconSize = ui->minSize->value();
+  settings.maxIconSize = ui->maxSize->value();
+  settings.spacingFactor = ui->spacingFactor->value();
+  settings.backgroundColor = backgroundColor_->color();
+  settings.backgroundColor.setAlphaF(
+      transparencyPercentToAlphaF(ui->backgroundTransparency->value()));
+  settings.showBorder = ui->showBorder->isChecked();
+  settings.borderColor = borderColor_->color();
+  settings.tooltipFontSize = ui->tooltipFontSize->value();
+  model_->previewAppearanceSettings(settings);
+}
+
 void AppearanceSettingsDialog::saveData() {
+  // Saving supersedes any pending preview.
+  previewTimer_.stop();
+  model_->beginTransaction();
   model_->setMinIconSize(ui->minSize->value());
   model_->setMaxIconSize(ui->maxSize->value());
   model_->setSpacingFactor(ui->spacingFactor->value());
@@ -106,6 +175,7 @@ void AppearanceSettingsDialog::saveData() {
   model_->setBorderColor(borderColor_->color());
   model_->setTooltipFontSize(ui->tooltipFontSize->value());
   model_->saveAppearanceConfig();
+  model_->commit();
 }
 
 }  // namespace ksmoothdock
@@ -20,6 +20,7 @@
 #define KSMOOTHDOCK_APPEARANCE_SETTINGS_DIALOG_H_
 
 #include <QDialog>
+#include <QTimer>
 
 #include <KColorButton>
 
@@ -42,8 +43,14 @@ class AppearanceSettingsDialog : public QDialog {
 
  public slots:
   void accept() override;
+  void reject() override;
   void buttonClicked(QAbstractButton* button);
 
+ private slots:
+  // Previews the edited settings on the docks, at most once per frame.
+  void schedulePreview();
+  void preview();
+
  private:
   void loadData();
   void resetData();
@@ -55,6 +62,8 @@ class AppearanceSettingsDialog : public QDialog {
 
   MultiDockModel* model_;
 
+  QTimer previewTimer_;
+
   friend class AppearanceSettingsDialogTest;
 };
 
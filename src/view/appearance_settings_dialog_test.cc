@@ -24,6 +24,7 @@
 #include <memory>
 
 #include <QPushButton>
+#include <QStandardPaths>
 #include <QTemporaryDir>
 #include <QtTest>
 
@@ -33,6 +34,11 @@ class AppearanceSettingsDialogTest: public QObject {
   Q_OBJECT
 
  private slots:
+  void initTestCase() {
+    // Keeps the config caches out of the user's cache dir.
+    QStandardPaths::setTestModeEnabled(true);
+  }
+
   void init() {
     QTemporaryDir configDir;
     model_ = std::make_unique<MultiDockModel>(configDir.path());
@@ -61,6 +67,12 @@ class AppearanceSettingsDialogTest: public QObject {
   // Tests Cancel button/logic.
   void cancel();
 
+  // Tests that edits are previewed on the model.
+  void preview();
+
+  // Tests that Cancel ends the preview.
+  void preview_cancel();
+
  private:
   static bool compareDouble(double x, double y) {
     static constexpr double kDelta = 0.01;
@@ -154,6 +166,50 @@ void AppearanceSettingsDialogTest::cancel() {
   QCOMPARE(model_->tooltipFontSize(), 20);
 }
 
+void AppearanceSettingsDialogTest::preview() {
+  QSignalSpy iconSizesChanged(model_.get(), SIGNAL(iconSizesChanged()));
+  QSignalSpy tooltipFontSizeChanged(model_.get(),
+                                    SIGNAL(tooltipFontSizeChanged()));
+
+  // A burst of edits is previewed at once.
+  for (int size = 47; size >= 40; --size) {
+    dialog_->ui->minSize->setValue(size);
+  }
+  dialog_->ui->maxSize->setValue(80);
+  dialog_->ui->tooltipFontSize->setValue(24);
+
+  QTRY_COMPARE(iconSizesChanged.count(), 1);
+  QCOMPARE(tooltipFontSizeChanged.count(), 1);
+  QCOMPARE(model_->minIconSize(), 40);
+  QCOMPARE(model_->maxIconSize(), 80);
+  QCOMPARE(model_->tooltipFontSize(), 24);
+
+  QTest::mouseClick(dialog_->ui->buttonBox->button(QDialogButtonBox::Ok),
+                    Qt::LeftButton);
+
+  // Saving doesn't notify the previewed changes again.
+  QCOMPARE(iconSizesChanged.count(), 1);
+  QCOMPARE(tooltipFontSizeChanged.count(), 1);
+  QCOMPARE(model_->minIconSize(), 40);
+  QCOMPARE(model_->maxIconSize(), 80);
+  QCOMPARE(model_->tooltipFontSize(), 24);
+}
+
+void AppearanceSettingsDialogTest::preview_cancel() {
+  QSignalSpy iconSizesChanged(model_.get(), SIGNAL(iconSizesChanged()));
+
+  dialog_->ui->minSize->setValue(40);
+  QTRY_COMPARE(iconSizesChanged.count(), 1);
+  QCOMPARE(model_->minIconSize(), 40);
+
+  QTest::mouseClick(dialog_->ui->buttonBox->button(QDialogButtonBox::Cancel),
+                    Qt::LeftButton);
+
+  QCOMPARE(iconSizesChanged.count(), 2);
+  QCOMPARE(model_->minIconSize(), 48);
+  QCOMPARE(model_->maxIconSize(), 128);
+}
+
 }  // namespace ksmoothdock
 
 QTEST_MAIN(ksmoothdock::AppearanceSettingsDialogTest)
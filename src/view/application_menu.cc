@@ -71,6 +71,8 @@ ApplicationMenu::ApplicationMenu(
           [this]() { showingMenu_ = false; } );
   connect(model_, SIGNAL(applicationMenuConfigChanged()),
           this, SLOT(reloadMenu()));
+  connect(model_, &MultiDockModel::applicationMenuEntriesChanged,
+          this, &ApplicationMenu::applyEntryChanges);
 }
 
 void ApplicationMenu::draw(QPainter* painter, int position, int maxPosition)  {
@@ -92,9 +94,67 @@ void ApplicationMenu::mousePressEvent(QMouseEvent *e) {
 
 void ApplicationMenu::reloadMenu() {
   menu_.clear();
+  qDeleteAll(menu_.findChildren<QMenu*>(QString(), Qt::FindDirectChildrenOnly));
   buildMenu();
 }
 
+void ApplicationMenu::applyEntryChanges(const ApplicationEntryChanges& changes) {
+  for (const auto& removedEntry : changes.removedEntries) {
+    QMenu* menu = categoryMenus_.value(removedEntry.first);
+    if (menu == nullptr) {
+      continue;
+    }
+
+    for (QAction* action : menu->actions()) {
+      if (action->data().toString() == removedEntry.second) {
+        menu->removeAction(action);
+        action->deleteLater();
+      }
+    }
+    if (menu->actions().isEmpty()) {
+      categoryMenus_.remove(removedEntry.first);
+      menu_.removeAction(menu->menuAction());
+      menu->deleteLater();
+    }
+  }
+
+  const auto& categories = model_->applicationMenuCategories();
+  for (const auto& addedEntry : changes.addedEntries) {
+    QMenu* menu = categoryMenus_.value(addedEntry.first);
+    if (menu == nullptr) {
+      auto category = std::find_if(
+          categories.begin(), categories.end(),
+          [&addedEntry](const Category& category) {
+            return category.name == addedEntry.first;
+          });
+      if (category == categories.end()) {
+        continue;
+      }
+      // Keeps the order of the categories.
+      QAction* before = separator_;
+      for (auto next = category + 1; next != categories.end(); ++next) {
+        if (categoryMenus_.contains(next->name)) {
+          before = categoryMenus_[next->name]->menuAction();
+          break;
+        }
+      }
+      menu = addCategoryMenu(*category, before);
+      categoryMenus_[category->name] = menu;
+    }
+
+    // Keeps the entries sorted by name, the same as in the config.
+    const ApplicationEntry& entry = addedEntry.second;
+    QAction* before = nullptr;
+    for (QAction* action : menu->actions()) {
+      if (!(action->text() < entry.name)) {
+        before = action;
+        break;
+      }
+    }
+    addEntry(entry, menu, before);
+  }
+}
+
 bool ApplicationMenu::eventFilter(QObject* object, QEvent* event) {
   QMenu* menu = dynamic_cast<QMenu*>(object);
   if (menu) {
@@ -172,8 +232,9 @@ void ApplicationMenu::loadConfig() {
 }
 
 void ApplicationMenu::buildMenu() {
+  categoryMenus_.clear();
   addToMenu(model_->applicationMenuCategories());
-  menu_.addSeparator();
+  separator_ = menu_.addSeparator();
   addToMenu(ApplicationMenuConfig::kSessionSystemCategories);
   addEntry(ApplicationMenuConfig::kSearchEntry, &menu_);
 }
@@ -184,21 +245,34 @@ void ApplicationMenu::addToMenu(const std::vector<Category>& categories) {
       continue;
     }
 
-    QMenu* menu = menu_.addMenu(loadIcon(category.icon), category.displayName);
-    menu->setStyle(&style_);
+    QMenu* menu = addCategoryMenu(category, nullptr);
     for (const auto& entry : category.entries) {
       addEntry(entry, menu);
     }
-    menu->installEventFilter(this);
+    categoryMenus_[category.name] = menu;
   }
 }
 
-void ApplicationMenu::addEntry(const ApplicationEntry &entry, QMenu *menu) {
-  QAction* action = menu->addAction(loadIcon(entry.icon), entry.name, this,
-                  [&entry]() {
-                    Program::launch(entry.command);
-                  });
+QMenu* ApplicationMenu::addCategoryMenu(const Category& category,
+                                        QAction* before) {
+  QMenu* menu = new QMenu(category.displayName, &menu_);
+  menu->setIcon(loadIcon(category.icon));
+  menu->setStyle(&style_);
+  menu->installEventFilter(this);
+  menu_.insertMenu(before, menu);
+  return menu;
+}
+
+void ApplicationMenu::addEntry(const ApplicationEntry &entry, QMenu *menu,
+                               QAction* before) {
+  QAction* action = new QAction(loadIcon(entry.icon), entry.name, menu);
+  // The entry itself may be removed when the entries change.
+  const QString command = entry.command;
+  connect(action, &QAction::triggered, this, [command]() {
+    Program::launch(command);
+  });
   action->setData(entry.desktopFile);
+  menu->insertAction(before, action);
 }
 
 QIcon ApplicationMenu::loadIcon(const QString &icon) {
@@ -21,7 +21,9 @@
 
 #include "icon_based_dock_item.h"
 
+#include <QAction>
 #include <QEvent>
+#include <QHash>
 #include <QMenu>
 #include <QMouseEvent>
 #include <QPoint>
@@ -71,9 +73,15 @@ class ApplicationMenu : public QObject, public IconBasedDockItem {
 
   QSize getMenuSize() { return menu_.sizeHint(); }
 
+  // Re-applies the menu style after the dock's colors have changed.
+  void updateStyleSheet() { menu_.setStyleSheet(getStyleSheet()); }
+
 public slots:
  void reloadMenu();
 
+ // Adds and removes the changed entries in place.
+ void applyEntryChanges(const ApplicationEntryChanges& changes);
+
 protected:
   // Intercepts sub-menus's show events to adjust their position to improve
   // visibility.
@@ -87,7 +95,11 @@ protected:
   // Builds the menu from the application entries;
   void buildMenu();
   void addToMenu(const std::vector<Category>& categories);
-  void addEntry(const ApplicationEntry& entry, QMenu* menu);
+  // Adds an empty sub-menu for the category before the specified action, or
+  // at the end if it's null.
+  QMenu* addCategoryMenu(const Category& category, QAction* before);
+  void addEntry(const ApplicationEntry& entry, QMenu* menu,
+                QAction* before = nullptr);
 
   void createContextMenu();
 
@@ -95,6 +107,10 @@ protected:
 
   // The cascading popup menu that contains all application entries.
   QMenu menu_;
+  // Sub-menus by category name.
+  QHash<QString, QMenu*> categoryMenus_;
+  // Separates the application categories from the session/system ones.
+  QAction* separator_;
   bool showingMenu_;
 
   ApplicationMenuStyle style_;
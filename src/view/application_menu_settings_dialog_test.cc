@@ -22,6 +22,7 @@
 #include <memory>
 
 #include <QPushButton>
+#include <QStandardPaths>
 #include <QTemporaryDir>
 #include <QtTest>
 
@@ -31,6 +32,11 @@ class ApplicationMenuSettingsDialogTest: public QObject {
   Q_OBJECT
 
  private slots:
+  void initTestCase() {
+    // Keeps the config caches out of the user's cache dir.
+    QStandardPaths::setTestModeEnabled(true);
+  }
+
   void init() {
     QTemporaryDir configDir;
     model_ = std::make_unique<MultiDockModel>(configDir.path());
@@ -159,7 +159,7 @@ void Clock::loadConfig() {
 void Clock::saveConfig() {
   model_->setUse24HourClock(use24HourClockAction_->isChecked());
   model_->setClockFontScaleFactor(fontScaleFactor());
-  model_->saveAppearanceConfig(true /* repaintOnly */);
+  model_->saveAppearanceConfig();
 }
 
 }  // namespace ksmoothdock
@@ -159,7 +159,7 @@ void CpuLoad::loadConfig() {
 void CpuLoad::saveConfig() {
   model_->setUse24HourClock(use24HourClockAction_->isChecked());
   model_->setClockFontScaleFactor(fontScaleFactor());
-  model_->saveAppearanceConfig(true /* repaintOnly */);
+  model_->saveAppearanceConfig();
 }
 
 }  // namespace ksmoothdock
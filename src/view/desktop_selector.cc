@@ -106,7 +106,22 @@ void DesktopSelector::loadConfig() {
 
 void DesktopSelector::saveConfig() {
   model_->setShowDesktopNumber(showDesktopNumberAction_->isChecked());
-  model_->saveAppearanceConfig(true /* repaintOnly */);
+  model_->saveAppearanceConfig();
+}
+
+void DesktopSelector::setScreen(int screen) {
+  const QRect geometry = parent_->screenGeometry();
+  if (screen == screen_ && geometry.width() == desktopWidth_ &&
+      geometry.height() == desktopHeight_) {
+    return;
+  }
+
+  screen_ = screen;
+  desktopWidth_ = geometry.width();
+  desktopHeight_ = geometry.height();
+  // The wallpapers are per screen.
+  hasCustomWallpaper_ = false;
+  loadConfig();
 }
 
 void DesktopSelector::setIconScaled(const QPixmap& icon) {
@@ -118,6 +133,12 @@ void DesktopSelector::setIconScaled(const QPixmap& icon) {
   }
 }
 
+bool DesktopSelector::isCurrentDesktop() const {
+  // As tracked by the task helper, which follows the replayed desktop when
+  // replaying a trace.
+  return parent_->currentDesktop() == desktop_;
+}
+
 void DesktopSelector::createMenu() {
   menu_.addAction(
       QIcon::fromTheme("preferences-desktop-wallpaper"),
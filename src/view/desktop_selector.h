@@ -60,10 +60,11 @@ class DesktopSelector : public QObject, public IconBasedDockItem {
   // Sets the icon but scales the pixmap to the screen's width/height ratio.
   void setIconScaled(const QPixmap& icon);
 
+  // Follows the parent panel to another screen, or to a resized screen.
+  void setScreen(int screen);
+
  private:
-  bool isCurrentDesktop() const {
-    return KWindowSystem::currentDesktop() == desktop_;
-  }
+  bool isCurrentDesktop() const;
 
   void createMenu();
 
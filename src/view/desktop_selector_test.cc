@@ -22,6 +22,7 @@
 #include <cstdlib>
 #include <memory>
 
+#include <QStandardPaths>
 #include <QTemporaryDir>
 #include <QTemporaryFile>
 #include <QTest>
@@ -40,6 +41,11 @@ class DesktopSelectorTest: public QObject {
   Q_OBJECT
 
  private slots:
+  void initTestCase() {
+    // Keeps the config caches out of the user's cache dir.
+    QStandardPaths::setTestModeEnabled(true);
+  }
+
   void init() {
     QTemporaryDir configDir;
     model_ = std::make_unique<MultiDockModel>(configDir.path());
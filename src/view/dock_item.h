@@ -59,6 +59,20 @@ class DockItem {
   // has been changed by another dock (not their parent dock).
   virtual void loadConfig() {}
 
+  // Changes the orientation in place, after the dock has been moved to
+  // another edge.
+  virtual void setOrientation(Qt::Orientation orientation) {
+    orientation_ = orientation;
+  }
+
+  // Changes the min/max sizes in place, e.g. after the icon sizes have been
+  // changed in the appearance settings.
+  virtual void setSizeRange(int minSize, int maxSize) {
+    minSize_ = minSize;
+    maxSize_ = maxSize;
+    size_ = minSize;
+  }
+
   // Handles adding the task, e.g. for a Program dock item.
   virtual bool addTask(const TaskInfo& task) { return false; }
 
@@ -68,6 +82,10 @@ class DockItem {
   // Handles removing the task, e.g. for a Program dock item.
   virtual bool removeTask(WId wId) { return false; }
 
+  // Handles the active window change, e.g. for a Program dock item.
+  // Returns true if the item needs repainting.
+  virtual bool setActiveWindow(WId wId) { return false; }
+
   // Does this (Program) dock item already have this task?
   virtual bool hasTask(WId wId) { return false; }
 
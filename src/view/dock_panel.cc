@@ -26,12 +26,10 @@
 
 #include <QColor>
 #include <QCursor>
-#include <QGuiApplication>
 #include <QIcon>
 #include <QListWidgetItem>
 #include <QPainter>
 #include <QProcess>
-#include <QScreen>
 #include <QSize>
 #include <QStringList>
 #include <QVariant>
@@ -72,6 +70,9 @@ DockPanel::DockPanel(MultiDockView* parent, MultiDockModel* model, int dockId)
       applicationMenuSettingsDialog_(this, model),
       wallpaperSettingsDialog_(this, model),
       taskManagerSettingsDialog_(this, model),
+      windowSystem_(parent->windowSystem()),
+      taskHelper_(parent->taskHelper()),
+      screenTopology_(parent->screenTopology()),
       isMinimized_(true),
       isResizing_(false),
       isEntering_(false),
@@ -89,26 +90,43 @@ DockPanel::DockPanel(MultiDockView* parent, MultiDockModel* model, int dockId)
 
   connect(animationTimer_.get(), SIGNAL(timeout()), this,
       SLOT(updateAnimation()));
-  connect(KWindowSystem::self(), SIGNAL(numberOfDesktopsChanged(int)),
+  connect(windowSystem_, SIGNAL(numberOfDesktopsChanged(int)),
       this, SLOT(updatePager()));
-  connect(KWindowSystem::self(), SIGNAL(currentDesktopChanged(int)),
-          this, SLOT(onCurrentDesktopChanged()));
-  connect(KWindowSystem::self(), SIGNAL(activeWindowChanged(WId)),
-          this, SLOT(update()));
-  connect(KWindowSystem::self(), SIGNAL(windowAdded(WId)),
-          this, SLOT(onWindowAdded(WId)));
-  connect(KWindowSystem::self(), SIGNAL(windowRemoved(WId)),
-          this, SLOT(onWindowRemoved(WId)));
-  connect(KWindowSystem::self(),
-          SIGNAL(windowChanged(WId, NET::Properties, NET::Properties2)),
-          this,
-          SLOT(onWindowChanged(WId, NET::Properties, NET::Properties2)));
-  connect(&activityManager_, &KActivities::Consumer::currentActivityChanged,
+  connect(taskHelper_, &TaskHelper::currentDesktopChanged,
+          this, &DockPanel::onCurrentDesktopChanged);
+  connect(taskHelper_, &TaskHelper::currentActivityChanged,
           this, &DockPanel::onCurrentActivityChanged);
+  connect(taskHelper_, &TaskHelper::activeWindowChanged,
+          this, &DockPanel::onActiveWindowChanged);
+  connect(taskHelper_, &TaskHelper::taskAdded, this, &DockPanel::onTaskAdded);
+  connect(taskHelper_, &TaskHelper::taskRemoved, this, &DockPanel::onTaskRemoved);
+  connect(taskHelper_, &TaskHelper::taskUpdated, this, &DockPanel::onTaskUpdated);
+  connect(screenTopology_, &ScreenTopology::screensChanged,
+          this, &DockPanel::onScreensChanged);
+  taskEventTimer_.setSingleShot(true);
+  connect(&taskEventTimer_, &QTimer::timeout, this, &DockPanel::flushTaskEvents);
   connect(model_, SIGNAL(appearanceOutdated()), this, SLOT(update()));
+  connect(model_, &MultiDockModel::iconSizesChanged,
+          this, &DockPanel::onIconSizesChanged);
+  connect(model_, &MultiDockModel::colorsChanged,
+          this, &DockPanel::onColorsChanged);
+  connect(model_, &MultiDockModel::tooltipFontSizeChanged,
+          this, &DockPanel::onTooltipFontSizeChanged);
+  connect(model_, &MultiDockModel::applicationMenuAppearanceChanged,
+          this, &DockPanel::onApplicationMenuAppearanceChanged);
+  connect(model_, &MultiDockModel::wallpapersChanged,
+          this, &DockPanel::onWallpapersChanged);
   connect(model_, SIGNAL(appearanceChanged()), this, SLOT(reload()));
   connect(model_, SIGNAL(dockLaunchersChanged(int)),
           this, SLOT(onDockLaunchersChanged(int)));
+  // The overridden names, icons and task commands are resolved when the items
+  // are created.
+  connect(&model_->overrideConfig(), &OverrideConfig::configChanged,
+          this, &DockPanel::reload);
+}
+
+DockPanel::~DockPanel() {
+  taskHelper_->unregisterDock(dockId_);
 }
 
 void DockPanel::resize(int w, int h) {
@@ -172,6 +190,7 @@ QPoint DockPanel::applicationSubMenuPosition(
 
 void DockPanel::reload() {
   loadAppearanceConfig();
+  clearItemIndexes();
   items_.clear();
   initUi();
   update();
@@ -180,6 +199,7 @@ void DockPanel::reload() {
 void DockPanel::refresh() {
   for (int i = 0; i < itemCount(); ++i) {
     if (items_[i]->shouldBeRemoved()) {
+      removeFromItemIndexes(items_[i].get());
       items_.erase(items_.begin() + i);
       resizeTaskManager();
       return;
@@ -192,11 +212,76 @@ void DockPanel::delayedRefresh() {
 }
 
 void DockPanel::onCurrentDesktopChanged() {
-  reloadTasks();
+  // The task deltas have already been delivered by the task helper.
+  update();
 }
 
 void DockPanel::onCurrentActivityChanged() {
-  reloadTasks();
+  update();
+}
+
+void DockPanel::onActiveWindowChanged(WId previous, WId current) {
+  for (const WId wId : {previous, current}) {
+    const auto it = taskItems_.find(wId);
+    if (it != taskItems_.end() && it->second->setActiveWindow(current)) {
+      const DockItem* item = it->second;
+      update(item->left_, item->top_, item->getWidth(), item->getHeight());
+    }
+  }
+}
+
+void DockPanel::onIconSizesChanged() {
+  minSize_ = model_->minIconSize();
+  maxSize_ = model_->maxIconSize();
+  spacingFactor_ = model_->spacingFactor();
+  for (const auto& item : items_) {
+    item->setSizeRange(minSize_, maxSize_);
+  }
+  initLayoutVars();
+  updateLayout();
+  setStrut();
+  update();
+}
+
+void DockPanel::onColorsChanged() {
+  backgroundColor_ = model_->backgroundColor();
+  showBorder_ = model_->showBorder();
+  borderColor_ = model_->borderColor();
+  ApplicationMenu* applicationMenu = showApplicationMenu_
+      ? dynamic_cast<ApplicationMenu*>(items_[0].get()) : nullptr;
+  if (applicationMenu) {
+    applicationMenu->updateStyleSheet();
+  }
+  update();
+}
+
+void DockPanel::onTooltipFontSizeChanged() {
+  tooltipFontSize_ = model_->tooltipFontSize();
+  tooltip_.setFontSize(tooltipFontSize_);
+  tooltip_.updateLayout();
+}
+
+void DockPanel::onApplicationMenuAppearanceChanged() {
+  ApplicationMenu* applicationMenu = showApplicationMenu_
+      ? dynamic_cast<ApplicationMenu*>(items_[0].get()) : nullptr;
+  if (!applicationMenu) {
+    return;
+  }
+  applicationMenu->loadConfig();
+  // The new icon may have another aspect ratio.
+  initLayoutVars();
+  updateLayout();
+  update();
+}
+
+void DockPanel::onWallpapersChanged() {
+  for (const auto& item : items_) {
+    DesktopSelector* desktopSelector = dynamic_cast<DesktopSelector*>(item.get());
+    if (desktopSelector) {
+      desktopSelector->loadConfig();
+    }
+  }
+  update();
 }
 
 void DockPanel::setStrut() {
@@ -234,11 +319,39 @@ void DockPanel::togglePager() {
 }
 
 void DockPanel::setScreen(int screen) {
+  if (!screenTopology_->isValidScreen(screen)) {
+    screen = 0;
+  }
   screen_ = screen;
   for (int i = 0; i < static_cast<int>(screenActions_.size()); ++i) {
     screenActions_[i]->setChecked(i == screen);
   }
-  screenGeometry_ = QGuiApplication::screens()[screen]->geometry();
+  screenGeometry_ = screenTopology_->geometry(screen);
+}
+
+void DockPanel::onScreensChanged() {
+  updateScreenMenu();
+  // Goes back to the configured screen if it has been plugged in again.
+  setScreen(model_->screen(dockId_));
+  relayout();
+}
+
+void DockPanel::relayout() {
+  for (const auto& item : items_) {
+    item->setOrientation(orientation_);
+    DesktopSelector* desktopSelector = dynamic_cast<DesktopSelector*>(item.get());
+    if (desktopSelector) {
+      desktopSelector->setScreen(screen_);
+    }
+  }
+  if (model_->currentScreenTasksOnly()) {
+    // The task changes are delivered by the task helper.
+    taskHelper_->setDockScreen(dockId_, screen_);
+  }
+  initLayoutVars();
+  updateLayout();
+  setStrut();
+  update();
 }
 
 void DockPanel::updateAnimation() {
@@ -339,46 +452,66 @@ void DockPanel::removeDock() {
   }
 }
 
-void DockPanel::onWindowAdded(WId wId) {
-  if (!showTaskManager()) {
-    return;
+void DockPanel::onTaskAdded(int dockId, const TaskInfo& task) {
+  if (dockId == dockId_) {
+    queueTaskEvent(TaskEventType::Added, task);
   }
+}
 
-  if (taskHelper_.isValidTask(wId, screen_)) {
-    // Now inserts it.
-    addTask(wId);
-    resizeTaskManager();
+void DockPanel::onTaskRemoved(int dockId, WId wId) {
+  if (dockId == dockId_) {
+    queueTaskEvent(TaskEventType::Removed, TaskInfo(wId, QString()));
   }
 }
 
-void DockPanel::onWindowRemoved(WId wId) {
-  if (!showTaskManager()) {
-    return;
+void DockPanel::onTaskUpdated(int dockId, const TaskInfo& task) {
+  if (dockId == dockId_) {
+    queueTaskEvent(TaskEventType::Updated, task);
   }
-
-  removeTask(wId);
 }
 
-void DockPanel::onWindowChanged(WId wId, NET::Properties properties,
-                                NET::Properties2 properties2) {
-  if (!showTaskManager()) {
+void DockPanel::flushTaskEvents() {
+  taskEventTimer_.stop();
+  if (pendingTaskEvents_.empty()) {
     return;
   }
 
-  if (wId != winId() && wId != tooltip_.winId() &&
-      taskHelper_.isValidTask(wId)) {
-    auto screen = model_->currentScreenTasksOnly() ? screen_ : -1;
-    if (properties & NET::WMDesktop || properties & NET::WMGeometry) {
-      if (taskHelper_.isValidTask(wId, screen, model_->currentDesktopTasksOnly())) {
-        addTask(wId);
-        resizeTaskManager();
-      } else {
-        removeTask(wId);
-      }
-    } else if (properties & NET::WMState) {
-      updateTask(wId);
+  std::vector<std::pair<TaskEventType, TaskInfo>> events;
+  events.swap(pendingTaskEvents_);
+  bool layoutChanged = false;
+  for (const auto& event : events) {
+    switch (event.first) {
+      case TaskEventType::Added:
+        addTask(event.second);
+        layoutChanged = true;
+        break;
+      case TaskEventType::Removed:
+        layoutChanged |= removeTask(event.second.wId);
+        break;
+      case TaskEventType::Updated:
+        updateTask(event.second);
+        break;
     }
   }
+
+  const int eventCount = static_cast<int>(events.size());
+  ++taskEventStats_.flushes;
+  taskEventStats_.lastFlushEvents = eventCount;
+  taskEventStats_.maxFlushEvents = std::max(taskEventStats_.maxFlushEvents, eventCount);
+
+  if (layoutChanged) {
+    resizeTaskManager();
+  } else {
+    update();
+  }
+}
+
+void DockPanel::queueTaskEvent(TaskEventType type, const TaskInfo& task) {
+  pendingTaskEvents_.emplace_back(type, task);
+  ++taskEventStats_.events;
+  if (!taskEventTimer_.isActive()) {
+    taskEventTimer_.start(model_->taskEventCoalescingInterval());
+  }
 }
 
 void DockPanel::paintEvent(QPaintEvent* e) {
@@ -520,21 +653,8 @@ void DockPanel::createMenu() {
       [this]() { updatePosition(PanelPosition::Right); });
   positionRight_->setCheckable(true);
 
-  const int numScreens = QGuiApplication::screens().size();
-  if (numScreens > 1) {
-    QMenu* screen = menu_.addMenu(i18n("Scr&een"));
-    for (int i = 0; i < numScreens; ++i) {
-      QAction* action = screen->addAction(
-          "Screen " + QString::number(i + 1), this,
-          [this, i]() {
-            setScreen(i);
-            reload();
-            saveDockConfig();
-          });
-      action->setCheckable(true);
-      screenActions_.push_back(action);
-    }
-  }
+  screenMenu_ = menu_.addMenu(i18n("Scr&een"));
+  updateScreenMenu();
 
   QMenu* visibility = menu_.addMenu(i18n("&Visibility"));
   visibilityAlwaysVisibleAction_ = visibility->addAction(
@@ -621,6 +741,24 @@ void DockPanel::setVisibility(PanelVisibility visibility) {
       visibility_ == PanelVisibility::WindowsGoBelow);
 }
 
+void DockPanel::updateScreenMenu() {
+  screenMenu_->clear();
+  screenActions_.clear();
+  const int numScreens = screenTopology_->screenCount();
+  for (int i = 0; i < numScreens; ++i) {
+    QAction* action = screenMenu_->addAction(
+        "Screen " + QString::number(i + 1), this,
+        [this, i]() {
+          setScreen(i);
+          relayout();
+          saveDockConfig();
+        });
+    action->setCheckable(true);
+    screenActions_.push_back(action);
+  }
+  screenMenu_->menuAction()->setVisible(numScreens > 1);
+}
+
 void DockPanel::loadDockConfig() {
   setPosition(model_->panelPosition(dockId_));
   setScreen(model_->screen(dockId_));
@@ -667,17 +805,21 @@ void DockPanel::initApplicationMenu() {
 }
 
 void DockPanel::initLaunchers() {
+  launchersGeneration_ = model_->dockLaunchersGeneration(dockId_);
   for (const auto& launcherConfig : model_->dockLauncherConfigs(dockId_)) {
     std::cout << "Init launcher " << launcherConfig.name.toStdString() << "\n";
-    items_.push_back(std::make_unique<Program>(
+    auto program = std::make_unique<Program>(
         this, model_, launcherConfig.name, orientation_, launcherConfig.icon, minSize_,
-        maxSize_, launcherConfig.command, launcherConfig.taskCommand, /*pinned=*/true));
+        maxSize_, launcherConfig.command, launcherConfig.taskCommand, /*pinned=*/true);
+    Program* newProgram = program.get();
+    items_.push_back(std::move(program));
+    addToItemIndexes(newProgram);
   }
 }
 
 void DockPanel::initPager() {
   if (showPager_) {
-    for (int desktop = 1; desktop <= KWindowSystem::numberOfDesktops();
+    for (int desktop = 1; desktop <= windowSystem_->numberOfDesktops();
          ++desktop) {
       items_.push_back(std::make_unique<DesktopSelector>(
           this, model_, orientation_, minSize_, maxSize_, desktop, screen_));
@@ -686,41 +828,34 @@ void DockPanel::initPager() {
 }
 
 void DockPanel::initTasks() {
+  // The tasks loaded below supersede any queued task events.
+  pendingTaskEvents_.clear();
   if (!showTaskManager()) {
+    taskHelper_->unregisterDock(dockId_);
     return;
   }
 
   auto screen = model_->currentScreenTasksOnly() ? screen_ : -1;
-  for (const auto& task : taskHelper_.loadTasks(screen, model_->currentDesktopTasksOnly())) {
+  for (const auto& task : taskHelper_->registerDock(
+           dockId_, screen, model_->currentDesktopTasksOnly())) {
     addTask(task);
   }
 }
 
-void DockPanel::reloadTasks() {
-  if (!showTaskManager()) {
-    return;
-  }
-
-  const int itemsToKeep = applicationMenuItemCount() + pagerItemCount();
-  items_.resize(itemsToKeep);
-  initLaunchers();
-  initTasks();
-  initClock();
-  resizeTaskManager();
-}
-
 void DockPanel::addTask(const TaskInfo& task) {
   // Checks is the task already exists.
-  for (auto& item : items_) {
-    if (item->hasTask(task.wId)) {
-      return;
-    }
+  if (taskItems_.count(task.wId) > 0) {
+    return;
   }
 
   // Tries adding the task to existing programs.
-  for (auto& item : items_) {
-    if (item->addTask(task)) {
-      return;
+  const auto programs = programs_.constFind(normalizeTaskCommand(task.command));
+  if (programs != programs_.constEnd()) {
+    for (auto* program : programs.value()) {
+      if (program->addTask(task)) {
+        taskItems_[task.wId] = program;
+        return;
+      }
     }
   }
 
@@ -732,58 +867,119 @@ void DockPanel::addTask(const TaskInfo& task) {
 
 
   // another set of overrides, as some programs are called... just strange
-  QSettings settings;
-  settings.beginGroup("taskoverrides");
-  QStringList childKeys = settings.childKeys();
+  const auto& overrides = model_->overrideConfig();
   QString appName = task.program;
   if (app) {
     appName = app->name;
   }
-  for (const auto& key:childKeys) {
-    // do override
-    if (task.program == key) {
-      std::cout << "### overriding " << task.program.toStdString() << "\n";
-      appName = settings.value(key).toString();
-    }
+  const QString taskOverride = overrides.taskOverride(task.program);
+  if (!taskOverride.isEmpty()) {
+    std::cout << "### overriding " << task.program.toStdString() << "\n";
+    appName = taskOverride;
   }
 
   int i = 0;
   for (; i < itemCount() && items_[i]->beforeTask(command); ++i);
+  std::unique_ptr<Program> program;
   if (app) {
     // std::cout << "// App name: " << app->command.toStdString() << "\n";
     // std::cout << "// App name: " << app->taskCommand.toStdString() << "\n";
-    items_.insert(items_.begin() + i, std::make_unique<Program>(
+    program = std::make_unique<Program>(
         this, model_, appName, orientation_, app->icon, minSize_,
-        maxSize_, app->command, app->taskCommand, /*pinned=*/false));
+        maxSize_, app->command, app->taskCommand, /*pinned=*/false);
   } else {
-    items_.insert(items_.begin() + i, std::make_unique<Program>(
-        this, model_, appName, orientation_, "xapp", minSize_,
-        maxSize_, task.command, task.command, /*pinned=*/false));
+    const QString iconRule = overrides.iconForTask(task.command);
+    program = std::make_unique<Program>(
+        this, model_, appName, orientation_, iconRule.isEmpty() ? "xapp" : iconRule,
+        minSize_, maxSize_, task.command, task.command, /*pinned=*/false);
+    // Only now is the window icon worth fetching.
+    if (!program->iconFound() && task.icon) {
+      const QPixmap icon = task.icon();
+      if (!icon.isNull()) {
+        program->setIcon(icon);
+      }
+    }
   }
-  items_[i]->addTask(task);
+  program->addTask(task);
+  taskItems_[task.wId] = program.get();
+  Program* newProgram = program.get();
+  items_.insert(items_.begin() + i, std::move(program));
+  addToItemIndexes(newProgram);
 }
 
-void DockPanel::removeTask(WId wId) {
-  for (int i = 0; i < itemCount(); ++i) {
-    if (items_[i]->removeTask(wId)) {
-      if (items_[i]->shouldBeRemoved()) {
+bool DockPanel::removeTask(WId wId) {
+  const auto it = taskItems_.find(wId);
+  if (it == taskItems_.end()) {
+    return false;
+  }
+
+  DockItem* item = it->second;
+  taskItems_.erase(it);
+  item->removeTask(wId);
+  if (item->shouldBeRemoved()) {
+    for (int i = 0; i < itemCount(); ++i) {
+      if (items_[i].get() == item) {
+        removeFromItemIndexes(item);
         items_.erase(items_.begin() + i);
-        resizeTaskManager();
+        return true;
       }
-      return;
     }
   }
+  return false;
 }
 
-void DockPanel::updateTask(WId wId) {
-  const TaskInfo& task = taskHelper_.getTaskInfo(wId);
-  for (auto& item : items_) {
-    if (item->updateTask(task)) {
-      return;
+void DockPanel::updateTask(const TaskInfo& task) {
+  const auto it = taskItems_.find(task.wId);
+  if (it != taskItems_.end()) {
+    it->second->updateTask(task);
+  }
+}
+
+void DockPanel::addToItemIndexes(Program* program) {
+  auto& programs = programs_[normalizeTaskCommand(program->taskCommand())];
+  programs.push_back(program);
+  if (programs.size() == 1 || items_.back().get() == program) {
+    return;
+  }
+
+  // The program has been inserted in the middle of items_.
+  std::vector<Program*> ordered;
+  ordered.reserve(programs.size());
+  for (const auto& item : items_) {
+    if (std::find(programs.begin(), programs.end(), item.get()) !=
+        programs.end()) {
+      ordered.push_back(static_cast<Program*>(item.get()));
+    }
+  }
+  programs = std::move(ordered);
+}
+
+void DockPanel::removeFromItemIndexes(DockItem* item) {
+  Program* program = dynamic_cast<Program*>(item);
+  if (!program) {
+    return;
+  }
+
+  for (const auto& task : program->tasks_) {
+    taskItems_.erase(task.wId);
+  }
+
+  const auto key = normalizeTaskCommand(program->taskCommand());
+  auto programs = programs_.find(key);
+  if (programs != programs_.end()) {
+    auto& list = programs.value();
+    list.erase(std::remove(list.begin(), list.end(), program), list.end());
+    if (list.empty()) {
+      programs_.erase(programs);
     }
   }
 }
 
+void DockPanel::clearItemIndexes() {
+  taskItems_.clear();
+  programs_.clear();
+}
+
 void DockPanel::initClock() {
   if (showClock_) {
     items_.push_back(std::make_unique<Clock>(
@@ -1058,7 +1254,7 @@ void DockPanel::resizeTaskManager() {
   }
 
   const int itemsToKeep = (showApplicationMenu_ ? 1 : 0) +
-      (showPager_ ? KWindowSystem::numberOfDesktops() : 0);
+      (showPager_ ? windowSystem_->numberOfDesktops() : 0);
   int left = 0;
   int top = 0;
   for (int i = 0; i < itemCount(); ++i) {
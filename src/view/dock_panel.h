@@ -20,9 +20,12 @@
 #define KSMOOTHDOCK_DOCK_PANEL_H_
 
 #include <memory>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <QAction>
+#include <QHash>
 #include <QMenu>
 #include <QMouseEvent>
 #include <QPaintEvent>
@@ -35,7 +38,6 @@
 
 #include <KAboutApplicationDialog>
 #include <KWindowSystem>
-#include <kactivities/consumer.h>
 
 #include "add_panel_dialog.h"
 #include "application_menu_settings_dialog.h"
@@ -45,11 +47,26 @@
 #include "task_manager_settings_dialog.h"
 #include "tooltip.h"
 #include "wallpaper_settings_dialog.h"
+#include "utils/screen_topology.h"
 #include "utils/task_helper.h"
+#include "utils/window_system_backend.h"
 
 namespace ksmoothdock {
 
 class MultiDockView;
+class Program;
+
+// Statistics of task event coalescing, see DockPanel::flushTaskEvents().
+struct TaskEventStats {
+  // Total number of task events received.
+  int events = 0;
+  // Number of flushes, each doing one layout pass.
+  int flushes = 0;
+  // Number of events coalesced in the last flush.
+  int lastFlushEvents = 0;
+  // Maximum number of events coalesced in a single flush.
+  int maxFlushEvents = 0;
+};
 
 // A dock panel. The user can have multiple dock panels at the same time.
 class DockPanel : public QWidget {
@@ -58,7 +75,7 @@ class DockPanel : public QWidget {
  public:
   // No pointer ownership.
   DockPanel(MultiDockView* parent, MultiDockModel* model, int dockId);
-  virtual ~DockPanel() = default;
+  virtual ~DockPanel();
 
   void resize(int w, int h);
 
@@ -68,6 +85,18 @@ class DockPanel : public QWidget {
 
   int dockId() const { return dockId_; }
 
+  MultiDockModel* model() const { return model_; }
+
+  WindowSystemBackend* windowSystem() const { return windowSystem_; }
+
+  WId activeWindow() const { return taskHelper_->activeWindow(); }
+
+  int currentDesktop() const { return taskHelper_->currentDesktop(); }
+
+  bool isWindowMinimized(WId wId) const {
+    return taskHelper_->windowProperties(wId).state & NET::Hidden;
+  }
+
   QRect screenGeometry() { return screenGeometry_; }
 
   // Gets the position to show the application menu.
@@ -77,6 +106,8 @@ class DockPanel : public QWidget {
                                        const QRect& subMenuGeometry);
   void addPanelSettings(QMenu* menu);
 
+  const TaskEventStats& taskEventStats() const { return taskEventStats_; }
+
  public slots:
   // Reloads the items and updates the dock.
   void reload();
@@ -90,8 +121,19 @@ class DockPanel : public QWidget {
   void onCurrentDesktopChanged();
   void onCurrentActivityChanged();
 
+  // Repaints only the items whose highlight has changed.
+  void onActiveWindowChanged(WId previous, WId current);
+
+  // Appearance changes that keep the items.
+  void onIconSizesChanged();
+  void onColorsChanged();
+  void onTooltipFontSizeChanged();
+  void onApplicationMenuAppearanceChanged();
+  void onWallpapersChanged();
+
   void onDockLaunchersChanged(int dockId) {
-    if (dockId_ == dockId) {
+    if (dockId_ == dockId &&
+        model_->dockLaunchersGeneration(dockId_) != launchersGeneration_) {
       reload();
     }
   }
@@ -101,13 +143,13 @@ class DockPanel : public QWidget {
 
   void updatePosition(PanelPosition position) {
     setPosition(position);
-    reload();
+    relayout();
     saveDockConfig();
   }
 
   void updateVisibility(PanelVisibility visibility) {
     setVisibility(visibility);
-    reload();
+    relayout();
     saveDockConfig();
   }
 
@@ -138,10 +180,19 @@ class DockPanel : public QWidget {
   }
 
   // Sets the dock on a specific screen given screen index.
-  // Thus 0 is screen 1 and so on.
+  // Thus 0 is screen 1 and so on. Falls back to screen 1 if the screen
+  // doesn't exist.
   // This doesn't refresh the dock.
   void setScreen(int screen);
 
+  // Moves the dock after screens have been added/removed or resized,
+  // without reloading the items.
+  void onScreensChanged();
+
+  // Re-targets the items to the dock's position and screen, then updates
+  // the layout. Unlike reload(), keeps the items.
+  void relayout();
+
   // Slot to update zoom animation.
   void updateAnimation();
 
@@ -165,10 +216,13 @@ class DockPanel : public QWidget {
   void cloneDock();
   void removeDock();
 
-  void onWindowAdded(WId wId);
-  void onWindowRemoved(WId wId);
-  void onWindowChanged(WId wId, NET::Properties properties,
-                       NET::Properties2 properties2);
+  // Task events are queued and applied by flushTaskEvents().
+  void onTaskAdded(int dockId, const TaskInfo& task);
+  void onTaskRemoved(int dockId, WId wId);
+  void onTaskUpdated(int dockId, const TaskInfo& task);
+
+  // Applies all queued task events in order, then does one layout pass.
+  void flushTaskEvents();
 
  protected:
   virtual void paintEvent(QPaintEvent* e) override;
@@ -178,6 +232,8 @@ class DockPanel : public QWidget {
   virtual void leaveEvent(QEvent* e) override;
 
  private:
+  enum class TaskEventType { Added, Removed, Updated };
+
   // The space between the tooltip and the dock.
   static constexpr int kTooltipSpacing = 10;
 
@@ -204,7 +260,7 @@ class DockPanel : public QWidget {
   }
 
   int pagerItemCount() const {
-    return showPager_ ? KWindowSystem::numberOfDesktops() : 0;
+    return showPager_ ? windowSystem_->numberOfDesktops() : 0;
   }
 
   int clockItemCount() const {
@@ -225,13 +281,24 @@ class DockPanel : public QWidget {
   void initApplicationMenu();
   void initPager();
   void initTasks();
-  void reloadTasks();
   void addTask(const TaskInfo& task);
-  void addTask(WId wId) { addTask(taskHelper_.getTaskInfo(wId)); }
-  void removeTask(WId wId);
-  void updateTask(WId wId);
+  // Returns true if the task's item has been removed as well.
+  bool removeTask(WId wId);
+  void updateTask(const TaskInfo& task);
+
+  // Adds a new Program item, already in items_, to the look-up indexes.
+  void addToItemIndexes(Program* program);
+  // Removes an item that is about to be erased from the look-up indexes.
+  void removeFromItemIndexes(DockItem* item);
+  void clearItemIndexes();
+
+  void queueTaskEvent(TaskEventType type, const TaskInfo& task);
+
   void initClock();
 
+  // Rebuilds the Screen sub-menu's actions for the current screens.
+  void updateScreenMenu();
+
   void initLayoutVars();
 
   // Updates width, height, items's size and position when the mouse is outside
@@ -302,6 +369,21 @@ class DockPanel : public QWidget {
   // The list of all dock items.
   std::vector<std::unique_ptr<DockItem>> items_;
 
+  // Task events waiting for the next flush, in order of arrival.
+  std::vector<std::pair<TaskEventType, TaskInfo>> pendingTaskEvents_;
+  QTimer taskEventTimer_;
+  TaskEventStats taskEventStats_;
+
+  // Generation of the launcher configs that the launchers were created from.
+  quint64 launchersGeneration_ = 0;
+
+  // Look-up indexes into items_, to avoid scanning all items on task events.
+  // Map from task window IDs to the items that have them.
+  std::unordered_map<WId, DockItem*> taskItems_;
+  // Map from normalized task commands to the Program items with that task
+  // command, in the order of items_.
+  QHash<QString, std::vector<Program*>> programs_;
+
   // Context (right-click) menu.
   QMenu menu_;
   QAction* positionTop_;
@@ -318,6 +400,7 @@ class DockPanel : public QWidget {
   QAction* taskManagerAction_;
   QAction* clockAction_;
   // Actions to set the dock on a specific screen.
+  QMenu* screenMenu_;
   std::vector<QAction*> screenActions_;
 
   KAboutApplicationDialog aboutDialog_;
@@ -328,8 +411,14 @@ class DockPanel : public QWidget {
   WallpaperSettingsDialog wallpaperSettingsDialog_;
   TaskManagerSettingsDialog taskManagerSettingsDialog_;
 
-  TaskHelper taskHelper_;
-  KActivities::Consumer activityManager_;
+  // The window system shared by all docks. No ownership.
+  WindowSystemBackend* windowSystem_;
+
+  // The task tracker shared by all docks. No ownership.
+  TaskHelper* taskHelper_;
+
+  // The screen topology shared by all docks. No ownership.
+  ScreenTopology* screenTopology_;
 
   // The tooltip object to show tooltip for the active item.
   Tooltip tooltip_;
@@ -18,23 +18,69 @@
 
 #include "dock_panel.h"
 
+#include <algorithm>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
+#include <QBuffer>
+#include <QStandardPaths>
 #include <QTemporaryDir>
 #include <QtTest>
 
 #include <KWindowSystem>
 
+#include "icon_based_dock_item.h"
 #include "multi_dock_view.h"
+#include "program.h"
+#include "utils/window_system_trace.h"
 
 namespace ksmoothdock {
 
 constexpr int kDockId = 1;
 
+// Replays a trace, counting the window icon fetches and recording the
+// requests.
+class TestWindowSystem : public ReplayWindowSystemBackend {
+ public:
+  explicit TestWindowSystem(QIODevice* device)
+      : ReplayWindowSystemBackend(device) {}
+
+  QPixmap icon(WId wId, int width, int height) const override {
+    ++iconFetches;
+    return ReplayWindowSystemBackend::icon(wId, width, height);
+  }
+
+  void activateWindow(WId wId) override {
+    requests << QString("activate %1").arg(wId);
+  }
+
+  void minimizeWindow(WId wId) override {
+    requests << QString("minimize %1").arg(wId);
+  }
+
+  void raiseWindows(const QList<WId>& wIds) override {
+    QString request = "raise";
+    for (const auto wId : wIds) {
+      request += QString(" %1").arg(wId);
+    }
+    requests << request;
+  }
+
+  mutable int iconFetches = 0;
+  // E.g. "activate 10" or "raise 10 11".
+  QStringList requests;
+};
+
 class DockPanelTest: public QObject {
   Q_OBJECT
 
  private slots:
+  void initTestCase() {
+    // Keeps the config caches out of the user's cache dir.
+    QStandardPaths::setTestModeEnabled(true);
+  }
+
   void init() {
     QTemporaryDir configDir;
     model_ = std::make_unique<MultiDockModel>(configDir.path());
@@ -43,9 +89,19 @@ class DockPanelTest: public QObject {
     dock_ = std::make_unique<DockPanel>(view_.get(), model_.get(), kDockId);
   }
 
+  void cleanup() {
+    // The dock uses the view's task helper, and both use the model.
+    dock_.reset();
+    view_.reset();
+    model_.reset();
+  }
+
   // Tests setting position.
   void setPosition();
 
+  // Tests that moving the dock to another edge keeps the items.
+  void setPosition_keepsItems();
+
   // Tests setting Auto Hide on/off.
   void autoHide();
 
@@ -58,7 +114,131 @@ class DockPanelTest: public QObject {
   // Tests toggling the clock.
   void toggleClock();
 
+  // Tests that a burst of task events is applied in a single flush.
+  void coalesceTaskEvents();
+
+  // Tests that appearance changes that keep the items don't rebuild them.
+  void appearanceChange_keepsItems();
+
+  // Tests that the icon sizes are those of the scaled icons.
+  void iconSizes();
+
+  // Tests that the look-up indexes match the items as tasks are added to new
+  // programs, to existing programs and to pinned launchers.
+  void itemIndexes_addTasks();
+
+  // Tests that the look-up indexes match the items as programs are removed,
+  // through removeTask() and refresh(), then added again.
+  void itemIndexes_removeTasks();
+
+  // Tests that switching the desktop or the activity only adds and removes
+  // the tasks that enter or leave the dock, and keeps the other items.
+  void switchDesktopAndActivity();
+
+  // Tests that a window icon is only fetched for a task that creates a
+  // program without an icon.
+  void fetchWindowIcons();
+
+  // Tests the most-recently-used order of a program's tasks and the windows
+  // that a click on the program raises or activates.
+  void programMru();
+
  private:
+  static WindowProperties createWindow(const QString& program,
+                                       const QString& command) {
+    WindowProperties properties;
+    properties.valid = true;
+    properties.windowType = NET::Normal;
+    properties.windowClassClass = program;
+    properties.windowClassName = command;
+    properties.visibleName = program;
+    properties.desktop = 1;
+    properties.frameGeometry = QRect(100, 100, 800, 600);
+    return properties;
+  }
+
+  static TraceEvent createEvent(TraceEvent::Type type, WId wId,
+                                const WindowProperties& properties = {}) {
+    TraceEvent event;
+    event.type = type;
+    event.wId = wId;
+    event.properties = properties;
+    return event;
+  }
+
+  // Replaces the view and the dock with ones on a window system that replays
+  // the snapshot then the events, one step() at a time.
+  void replay(const TraceSnapshot& snapshot,
+              const std::vector<TraceEvent>& events) {
+    QBuffer buffer;
+    buffer.open(QIODevice::ReadWrite);
+    {
+      WindowSystemTraceWriter writer(&buffer);
+      writer.writeSnapshot(snapshot);
+      for (const auto& event : events) {
+        writer.writeEvent(event);
+      }
+    }
+    buffer.seek(0);
+
+    auto windowSystem = std::make_unique<TestWindowSystem>(&buffer);
+    QVERIFY(windowSystem->isValid());
+    windowSystem_ = windowSystem.get();
+    dock_.reset();
+    view_ = std::make_unique<MultiDockView>(model_.get(),
+                                            std::move(windowSystem));
+    dock_ = std::make_unique<DockPanel>(view_.get(), model_.get(), kDockId);
+  }
+
+  // Replays the next events, then applies the resulting task events.
+  void step(int count = 1) {
+    for (int i = 0; i < count; ++i) {
+      QVERIFY(windowSystem_->step());
+    }
+    dock_->flushTaskEvents();
+  }
+
+  // Gets the Program item that has the task.
+  Program* taskProgram(WId wId) {
+    const auto it = dock_->taskItems_.find(wId);
+    return (it != dock_->taskItems_.end())
+        ? dynamic_cast<Program*>(it->second) : nullptr;
+  }
+
+  // Left-clicks an item.
+  static void click(DockItem* item) {
+    QMouseEvent event(QEvent::MouseButtonPress, QPointF(), Qt::LeftButton,
+                      Qt::LeftButton, Qt::NoModifier);
+    item->mousePressEvent(&event);
+  }
+
+  // Gets the items in order.
+  std::vector<const DockItem*> items() {
+    std::vector<const DockItem*> result;
+    for (const auto& item : dock_->items_) {
+      result.push_back(item.get());
+    }
+    return result;
+  }
+
+  // Verifies that the look-up indexes match the items.
+  void verifyItemIndexes() {
+    std::unordered_map<WId, DockItem*> taskItems;
+    QHash<QString, std::vector<Program*>> programs;
+    for (const auto& item : dock_->items_) {
+      auto* program = dynamic_cast<Program*>(item.get());
+      if (program == nullptr) {
+        continue;
+      }
+      programs[normalizeTaskCommand(program->taskCommand())].push_back(program);
+      for (const auto& task : program->tasks_) {
+        taskItems[task.wId] = program;
+      }
+    }
+    QVERIFY(dock_->taskItems_ == taskItems);
+    QVERIFY(dock_->programs_ == programs);
+  }
+
   void verifyPosition(PanelPosition position) {
     QCOMPARE(dock_->position_, position);
     QCOMPARE(dock_->orientation_,
@@ -108,6 +288,8 @@ class DockPanelTest: public QObject {
   std::unique_ptr<MultiDockModel> model_;
   std::unique_ptr<MultiDockView> view_;
   std::unique_ptr<DockPanel> dock_;
+  // Owned by view_, set by replay().
+  TestWindowSystem* windowSystem_ = nullptr;
 };
 
 void DockPanelTest::setPosition() {
@@ -122,6 +304,31 @@ void DockPanelTest::setPosition() {
   verifyPosition(PanelPosition::Bottom);
 }
 
+void DockPanelTest::setPosition_keepsItems() {
+  std::vector<const DockItem*> items;
+  for (const auto& item : dock_->items_) {
+    items.push_back(item.get());
+  }
+
+  dock_->positionLeft_->trigger();
+  verifyPosition(PanelPosition::Left);
+  dock_->visibilityAutoHideAction_->trigger();
+  verifyAutoHide(true);
+  QCOMPARE(dock_->itemCount(), static_cast<int>(items.size()));
+  for (int i = 0; i < dock_->itemCount(); ++i) {
+    QCOMPARE(dock_->items_[i].get(), items[i]);
+    QVERIFY(!dock_->items_[i]->isHorizontal());
+  }
+
+  dock_->visibilityAlwaysVisibleAction_->trigger();
+  dock_->positionBottom_->trigger();
+  verifyPosition(PanelPosition::Bottom);
+  for (int i = 0; i < dock_->itemCount(); ++i) {
+    QCOMPARE(dock_->items_[i].get(), items[i]);
+    QVERIFY(dock_->items_[i]->isHorizontal());
+  }
+}
+
 void DockPanelTest::autoHide() {
   verifyAutoHide(false);
   dock_->visibilityAutoHideAction_->trigger();
@@ -150,6 +357,401 @@ void DockPanelTest::toggleClock() {
   verifyClock(true, itemCount);
 }
 
+void DockPanelTest::coalesceTaskEvents() {
+  constexpr int kTaskCount = 30;
+  constexpr WId kFirstWId = 1000;
+  const int itemCount = dock_->itemCount();
+  const int flushes = dock_->taskEventStats().flushes;
+  for (int i = 0; i < kTaskCount; ++i) {
+    dock_->onTaskAdded(kDockId, TaskInfo(kFirstWId + i, "Test Program",
+                                         "ksmoothdock-test-program",
+                                         "Test Program", false));
+  }
+  dock_->onTaskRemoved(kDockId, kFirstWId);
+  // Events for other docks are ignored.
+  dock_->onTaskRemoved(kDockId + 1, kFirstWId + 1);
+
+  // Nothing is applied until the flush.
+  QCOMPARE(dock_->itemCount(), itemCount);
+
+  QTRY_COMPARE(dock_->taskEventStats().flushes, flushes + 1);
+  QCOMPARE(dock_->taskEventStats().lastFlushEvents, kTaskCount + 1);
+  QCOMPARE(dock_->itemCount(), itemCount + 1);
+  QVERIFY(dock_->taskItems_.count(kFirstWId) == 0);
+  for (int i = 1; i < kTaskCount; ++i) {
+    QVERIFY(dock_->taskItems_.count(kFirstWId + i) == 1);
+  }
+
+  // Removing all the tasks removes the program in a single flush as well.
+  for (int i = 1; i < kTaskCount; ++i) {
+    dock_->onTaskRemoved(kDockId, kFirstWId + i);
+  }
+  dock_->flushTaskEvents();
+  QCOMPARE(dock_->taskEventStats().flushes, flushes + 2);
+  QCOMPARE(dock_->taskEventStats().lastFlushEvents, kTaskCount - 1);
+  QCOMPARE(dock_->itemCount(), itemCount);
+}
+
+void DockPanelTest::appearanceChange_keepsItems() {
+  std::vector<const DockItem*> items;
+  for (const auto& item : dock_->items_) {
+    items.push_back(item.get());
+  }
+  const int minWidth = dock_->minWidth_;
+
+  model_->setMinIconSize(model_->minIconSize() + 8);
+  model_->setMaxIconSize(model_->maxIconSize() + 16);
+  model_->setBorderColor(QColor("#123456"));
+  model_->setTooltipFontSize(model_->tooltipFontSize() + 2);
+  model_->saveAppearanceConfig();
+
+  QCOMPARE(dock_->itemCount(), static_cast<int>(items.size()));
+  for (int i = 0; i < dock_->itemCount(); ++i) {
+    QCOMPARE(dock_->items_[i].get(), items[i]);
+  }
+  QCOMPARE(dock_->minSize_, model_->minIconSize());
+  QCOMPARE(dock_->maxSize_, model_->maxIconSize());
+  QVERIFY(dock_->minWidth_ > minWidth);
+  QCOMPARE(dock_->borderColor(), QColor("#123456"));
+  QCOMPARE(dock_->tooltipFontSize_, model_->tooltipFontSize());
+}
+
+void DockPanelTest::iconSizes() {
+  IconBasedDockItem* item = nullptr;
+  for (const auto& dockItem : dock_->items_) {
+    item = dynamic_cast<IconBasedDockItem*>(dockItem.get());
+    if (item != nullptr) {
+      break;
+    }
+  }
+  QVERIFY(item != nullptr);
+
+  QImage image(100, 61, QImage::Format_ARGB32);
+  image.fill(Qt::white);
+  item->setIcon(QPixmap::fromImage(image));
+  for (const auto orientation : {Qt::Horizontal, Qt::Vertical}) {
+    item->setOrientation(orientation);
+    for (int size = dock_->minSize_; size <= dock_->maxSize_; ++size) {
+      const QImage scaled = (orientation == Qt::Horizontal)
+          ? image.scaledToHeight(size, Qt::SmoothTransformation)
+          : image.scaledToWidth(size, Qt::SmoothTransformation);
+      QCOMPARE(item->getIconWidth(size), scaled.width());
+      QCOMPARE(item->getIconHeight(size), scaled.height());
+    }
+  }
+}
+
+void DockPanelTest::itemIndexes_addTasks() {
+  model_->addLauncher(kDockId,
+                      LauncherConfig("Test Editor", "accessories-text-editor",
+                                     "ksmoothdock-test-editor"));
+  model_->addLauncher(kDockId, LauncherConfig("Firefox", "firefox", "firefox"));
+  model_->addLauncher(kDockId, LauncherConfig("Thunderbird", "thunderbird",
+                                              "thunderbird"));
+  const auto terminal =
+      createWindow("Test Terminal", "ksmoothdock-test-terminal");
+  replay(TraceSnapshot(), {
+      createEvent(TraceEvent::Type::WindowAdded, 10, terminal),
+      createEvent(TraceEvent::Type::WindowAdded, 11, terminal),
+      createEvent(TraceEvent::Type::WindowAdded, 12, terminal),
+      createEvent(TraceEvent::Type::WindowAdded, 20,
+                  createWindow("Test Editor", "ksmoothdock-test-editor")),
+      createEvent(TraceEvent::Type::WindowAdded, 30,
+                  createWindow("Firefox", "Navigator")),
+      createEvent(TraceEvent::Type::WindowAdded, 40,
+                  createWindow("Thunderbird", "Mail"))});
+  const int itemCount = dock_->itemCount();
+  verifyItemIndexes();
+
+  // Several tasks of one command share a new program.
+  step(3);
+  QCOMPARE(dock_->itemCount(), itemCount + 1);
+  Program* program = taskProgram(10);
+  QVERIFY(program != nullptr);
+  QVERIFY(!program->pinned());
+  QCOMPARE(program->taskCount(), 3);
+  QCOMPARE(taskProgram(11), program);
+  QCOMPARE(taskProgram(12), program);
+  verifyItemIndexes();
+
+  // Tasks of the pinned launchers, including the aliased commands, are added
+  // to the launchers.
+  for (const WId wId : {20, 30, 40}) {
+    step();
+    QCOMPARE(dock_->itemCount(), itemCount + 1);
+    program = taskProgram(wId);
+    QVERIFY(program != nullptr);
+    QVERIFY(program->pinned());
+    verifyItemIndexes();
+  }
+  QCOMPARE(taskProgram(30)->taskCommand(), QString("firefox"));
+  QCOMPARE(taskProgram(40)->taskCommand(), QString("thunderbird"));
+}
+
+void DockPanelTest::itemIndexes_removeTasks() {
+  model_->addLauncher(kDockId,
+                      LauncherConfig("Test Editor", "accessories-text-editor",
+                                     "ksmoothdock-test-editor"));
+  const auto terminal =
+      createWindow("Test Terminal", "ksmoothdock-test-terminal");
+  const auto editor = createWindow("Test Editor", "ksmoothdock-test-editor");
+  replay(TraceSnapshot(), {
+      createEvent(TraceEvent::Type::WindowAdded, 10, terminal),
+      createEvent(TraceEvent::Type::WindowAdded, 11, terminal),
+      createEvent(TraceEvent::Type::WindowAdded, 20, editor),
+      createEvent(TraceEvent::Type::WindowRemoved, 10),
+      createEvent(TraceEvent::Type::WindowRemoved, 11),
+      createEvent(TraceEvent::Type::WindowRemoved, 20),
+      createEvent(TraceEvent::Type::WindowAdded, 12, terminal),
+      createEvent(TraceEvent::Type::WindowAdded, 21, editor)});
+  const int itemCount = dock_->itemCount();
+  step(3);
+  QCOMPARE(dock_->itemCount(), itemCount + 1);
+  verifyItemIndexes();
+
+  // Closing the last task of an unpinned program removes it in removeTask().
+  step();
+  QCOMPARE(dock_->itemCount(), itemCount + 1);
+  verifyItemIndexes();
+  step();
+  QCOMPARE(dock_->itemCount(), itemCount);
+  QVERIFY(taskProgram(11) == nullptr);
+  verifyItemIndexes();
+
+  // A pinned launcher stays after its last task has been closed, until it is
+  // unpinned and refresh() removes it.
+  step();
+  QCOMPARE(dock_->itemCount(), itemCount);
+  verifyItemIndexes();
+  Program* launcher = nullptr;
+  for (const auto& item : dock_->items_) {
+    auto* program = dynamic_cast<Program*>(item.get());
+    if (program != nullptr &&
+        program->taskCommand() == "ksmoothdock-test-editor") {
+      launcher = program;
+    }
+  }
+  QVERIFY(launcher != nullptr);
+  QCOMPARE(launcher->taskCount(), 0);
+  launcher->pinUnpin();
+  dock_->refresh();
+  QCOMPARE(dock_->itemCount(), itemCount - 1);
+  verifyItemIndexes();
+
+  // Both programs are added again with their new tasks.
+  step(2);
+  QCOMPARE(dock_->itemCount(), itemCount + 1);
+  QVERIFY(taskProgram(12) != nullptr);
+  QVERIFY(taskProgram(21) != nullptr);
+  QVERIFY(taskProgram(12) != taskProgram(21));
+  QVERIFY(!taskProgram(21)->pinned());
+  verifyItemIndexes();
+}
+
+void DockPanelTest::switchDesktopAndActivity() {
+  model_->addLauncher(kDockId,
+                      LauncherConfig("Test Editor", "accessories-text-editor",
+                                     "ksmoothdock-test-editor"));
+  TraceSnapshot snapshot;
+  snapshot.currentDesktop = 1;
+  snapshot.numberOfDesktops = 2;
+  snapshot.currentActivity = "a";
+  auto terminal = createWindow("Test Terminal", "ksmoothdock-test-terminal");
+  snapshot.windows.emplace_back(10, terminal);
+  terminal.onAllDesktops = true;
+  snapshot.windows.emplace_back(11, terminal);
+  auto editor = createWindow("Test Editor", "ksmoothdock-test-editor");
+  editor.desktop = 2;
+  snapshot.windows.emplace_back(20, editor);
+  auto viewer = createWindow("Test Viewer", "ksmoothdock-test-viewer");
+  viewer.onAllDesktops = true;
+  viewer.activities = QStringList{"a"};
+  snapshot.windows.emplace_back(30, viewer);
+  auto player = createWindow("Test Player", "ksmoothdock-test-player");
+  player.onAllDesktops = true;
+  player.activities = QStringList{"b"};
+  snapshot.windows.emplace_back(40, player);
+  TraceEvent desktopChanged;
+  desktopChanged.type = TraceEvent::Type::CurrentDesktopChanged;
+  desktopChanged.value = 2;
+  TraceEvent activityChanged;
+  activityChanged.type = TraceEvent::Type::CurrentActivityChanged;
+  activityChanged.activity = "b";
+  replay(snapshot, {desktopChanged, activityChanged});
+
+  std::vector<WId> added;
+  std::vector<WId> removed;
+  connect(view_->taskHelper(), &TaskHelper::taskAdded,
+          [&added](int dockId, const TaskInfo& task) {
+            if (dockId == kDockId) {
+              added.push_back(task.wId);
+            }
+          });
+  connect(view_->taskHelper(), &TaskHelper::taskRemoved,
+          [&removed](int dockId, WId wId) {
+            if (dockId == kDockId) {
+              removed.push_back(wId);
+            }
+          });
+  Program* terminalProgram = taskProgram(10);
+  QVERIFY(terminalProgram != nullptr);
+  QCOMPARE(taskProgram(11), terminalProgram);
+  QVERIFY(taskProgram(20) == nullptr);
+  Program* viewerProgram = taskProgram(30);
+  QVERIFY(viewerProgram != nullptr);
+  QVERIFY(taskProgram(40) == nullptr);
+  auto expectedItems = items();
+  const int flushes = dock_->taskEventStats().flushes;
+
+  // 10 leaves, 20 enters the pinned launcher, the other items are kept.
+  step();
+  QCOMPARE(added, (std::vector<WId>{20}));
+  QCOMPARE(removed, (std::vector<WId>{10}));
+  QCOMPARE(dock_->taskEventStats().flushes, flushes + 1);
+  QCOMPARE(dock_->taskEventStats().lastFlushEvents, 2);
+  QVERIFY(items() == expectedItems);
+  QVERIFY(taskProgram(10) == nullptr);
+  QCOMPARE(taskProgram(11), terminalProgram);
+  Program* launcher = taskProgram(20);
+  QVERIFY(launcher != nullptr);
+  QVERIFY(launcher->pinned());
+  QCOMPARE(taskProgram(30), viewerProgram);
+  verifyItemIndexes();
+
+  // 30 leaves with its program, 40 enters with a new program, the other items
+  // are kept.
+  added.clear();
+  removed.clear();
+  step();
+  QCOMPARE(added, (std::vector<WId>{40}));
+  QCOMPARE(removed, (std::vector<WId>{30}));
+  QCOMPARE(dock_->taskEventStats().flushes, flushes + 2);
+  QCOMPARE(dock_->taskEventStats().lastFlushEvents, 2);
+  Program* playerProgram = taskProgram(40);
+  QVERIFY(playerProgram != nullptr);
+  expectedItems.erase(
+      std::find(expectedItems.begin(), expectedItems.end(), viewerProgram));
+  auto keptItems = items();
+  keptItems.erase(std::find(keptItems.begin(), keptItems.end(), playerProgram));
+  QVERIFY(keptItems == expectedItems);
+  QCOMPARE(taskProgram(11), terminalProgram);
+  QCOMPARE(taskProgram(20), launcher);
+  verifyItemIndexes();
+}
+
+void DockPanelTest::fetchWindowIcons() {
+  model_->addLauncher(kDockId,
+                      LauncherConfig("Test Editor", "accessories-text-editor",
+                                     "ksmoothdock-test-editor"));
+  std::vector<TraceEvent> events = {
+      createEvent(TraceEvent::Type::WindowAdded, 10,
+                  createWindow("Test Terminal", "ksmoothdock-test-terminal")),
+      createEvent(TraceEvent::Type::WindowAdded, 11,
+                  createWindow("Test Terminal", "ksmoothdock-test-terminal")),
+      createEvent(TraceEvent::Type::WindowAdded, 20,
+                  createWindow("Test Editor", "ksmoothdock-test-editor")),
+      createEvent(TraceEvent::Type::WindowChanged, 10,
+                  createWindow("Test Terminal", "ksmoothdock-test-terminal")),
+      createEvent(TraceEvent::Type::WindowAdded, 30,
+                  createWindow("Test Viewer", "ksmoothdock-test-viewer"))};
+  events[3].value = static_cast<qint32>(NET::WMState);
+  // Any installed application will do.
+  const ApplicationEntry* application = nullptr;
+  for (const auto& category : model_->applicationMenuCategories()) {
+    for (const auto& entry : category.entries) {
+      if (!entry.taskCommand.isEmpty() &&
+          model_->findApplication(entry.taskCommand) != nullptr) {
+        application = &entry;
+        break;
+      }
+    }
+    if (application != nullptr) {
+      break;
+    }
+  }
+  if (application != nullptr) {
+    events.push_back(createEvent(
+        TraceEvent::Type::WindowAdded, 40,
+        createWindow(application->name, application->taskCommand)));
+  }
+  replay(TraceSnapshot(), events);
+
+  // A new program without an icon.
+  step();
+  QVERIFY(taskProgram(10) != nullptr);
+  QCOMPARE(windowSystem_->iconFetches, 1);
+
+  // An existing program, a pinned launcher, a state change.
+  step(3);
+  QCOMPARE(taskProgram(11), taskProgram(10));
+  QVERIFY(taskProgram(20) != nullptr);
+  QCOMPARE(windowSystem_->iconFetches, 1);
+
+  // Another new program without an icon.
+  step();
+  QVERIFY(taskProgram(30) != nullptr);
+  QCOMPARE(windowSystem_->iconFetches, 2);
+
+  // A new program with the application's icon.
+  if (application != nullptr) {
+    step();
+    QVERIFY(taskProgram(40) != nullptr);
+    QCOMPARE(windowSystem_->iconFetches, 2);
+  }
+  QVERIFY(windowSystem_->atEnd());
+}
+
+void DockPanelTest::programMru() {
+  TraceSnapshot snapshot;
+  const auto terminal =
+      createWindow("Test Terminal", "ksmoothdock-test-terminal");
+  auto minimizedTerminal = terminal;
+  minimizedTerminal.state = NET::Hidden;
+  snapshot.windows.emplace_back(10, minimizedTerminal);
+  snapshot.windows.emplace_back(11, terminal);
+  snapshot.windows.emplace_back(12, terminal);
+  snapshot.windows.emplace_back(
+      20, createWindow("Test Editor", "ksmoothdock-test-editor"));
+  replay(snapshot, {
+      createEvent(TraceEvent::Type::ActiveWindowChanged, 11),
+      createEvent(TraceEvent::Type::ActiveWindowChanged, 12),
+      createEvent(TraceEvent::Type::ActiveWindowChanged, 20),
+      createEvent(TraceEvent::Type::WindowRemoved, 11),
+      createEvent(TraceEvent::Type::ActiveWindowChanged, 10)});
+  Program* program = taskProgram(10);
+  QVERIFY(program != nullptr);
+  QCOMPARE(program->mru_, (std::vector<WId>{10, 11, 12}));
+
+  step();
+  QCOMPARE(program->mru_, (std::vector<WId>{11, 10, 12}));
+  QCOMPARE(program->getActiveTask(), 1);
+  step();
+  QCOMPARE(program->mru_, (std::vector<WId>{12, 11, 10}));
+  QCOMPARE(program->getActiveTask(), 2);
+
+  // Another program's window doesn't change the order.
+  step();
+  QCOMPARE(program->mru_, (std::vector<WId>{12, 11, 10}));
+  QVERIFY(!program->active());
+
+  // Restores the minimized windows, raises all the windows in the
+  // most-recently-used order, then activates the most recently used one.
+  click(program);
+  QCOMPARE(windowSystem_->requests,
+           (QStringList{"activate 10", "raise 10 11 12", "activate 12"}));
+
+  step();
+  QCOMPARE(program->mru_, (std::vector<WId>{12, 10}));
+  step();
+  QCOMPARE(program->mru_, (std::vector<WId>{10, 12}));
+  QCOMPARE(program->getActiveTask(), 0);
+
+  // Cycles to the next task in the order of creation.
+  windowSystem_->requests.clear();
+  click(program);
+  QCOMPARE(windowSystem_->requests, QStringList{"activate 12"});
+}
+
 }  // namespace ksmoothdock
 
 QTEST_MAIN(ksmoothdock::DockPanelTest)
@@ -26,7 +26,6 @@
 #include <QVariant>
 #include <Qt>
 
-#include <KDesktopFile>
 #include <KIconLoader>
 #include <KLocalizedString>
 
@@ -77,12 +76,8 @@ void LauncherList::dropEvent(QDropEvent* event) {
   if (event->mimeData()->hasFormat("text/uri-list")) {
     QString fileUrl =
         QString(event->mimeData()->data("text/uri-list")).trimmed();
-    KDesktopFile desktopFile(QUrl(fileUrl).toLocalFile());
-    const QString name = desktopFile.readName();
-    const QString command = filterFieldCodes(
-        desktopFile.entryMap("Desktop Entry")["Exec"]);
-    const QString iconName = desktopFile.readIcon();
-    parent_->addLauncher(name, command, iconName);
+    const LauncherConfig launcher(QUrl(fileUrl).toLocalFile());
+    parent_->addLauncher(launcher.name, launcher.command, launcher.icon);
   } else {  // Internal drag-and-drop.
     QListWidget::dropEvent(event);
   }
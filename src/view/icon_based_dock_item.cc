@@ -24,9 +24,10 @@
 
 #include <QImage>
 #include <QDir>
-#include <QSettings>
 #include <QString>
 
+#include "dock_panel.h"
+#include <model/multi_dock_model.h>
 
 namespace ksmoothdock {
 
@@ -40,8 +41,6 @@ IconBasedDockItem::IconBasedDockItem(DockPanel* parent, const QString& label, Qt
     iconsWidths_ (maxSize - minSize + 1) {
   position_ = -1;
   setIconName(iconName);
-  QSettings settings;
-  std::cout << "Reading settings from "  << settings.fileName().toStdString() << "\n";
 }
 
 IconBasedDockItem::IconBasedDockItem(DockPanel* parent, const QString& label,
@@ -53,8 +52,6 @@ IconBasedDockItem::IconBasedDockItem(DockPanel* parent, const QString& label,
     iconsWidths_ (maxSize - minSize + 1) {
   position_ = -1;
   setIcon(icon);
-  QSettings settings;
-  std::cout << "Reading settings from "  << settings.fileName().toStdString() << "\n";
 }
 
 
@@ -178,6 +175,28 @@ void IconBasedDockItem::draw(QPainter* painter, int position, int maxPosition) {
 }
 
 
+void IconBasedDockItem::setSizeRange(int minSize, int maxSize) {
+  DockItem::setSizeRange(minSize, maxSize);
+  const int numSizes = maxSize - minSize + 1;
+  icons_.assign(numSizes, QPixmap());
+  iconsHeights_.assign(numSizes, 0);
+  iconsWidths_.assign(numSizes, 0);
+  // The recolored image if it has been drawn already.
+  mipmapIcons((position_ >= 0) ? image_ : originalImage_);
+}
+
+void IconBasedDockItem::setOrientation(Qt::Orientation orientation) {
+  if (orientation == orientation_) {
+    return;
+  }
+
+  DockItem::setOrientation(orientation);
+  const QImage& image = (position_ >= 0) ? image_ : originalImage_;
+  if (image.width() != image.height()) {
+    mipmapIcons(image);
+  }
+}
+
 void IconBasedDockItem::updateIconCache (int size, int minSize_) {
   icons_[size - minSize_] = QPixmap::fromImage(
     (orientation_ == Qt::Horizontal)
@@ -199,37 +218,22 @@ void IconBasedDockItem::setIconName(const QString& iconName) {
     iconName_ = iconName;
 
     // overrides, maybe load these from a .json or something
-    QString pngName (iconName);
-    {
-      QSettings settings;
-      settings.beginGroup("iconoverrides");
-      // QStringList childKeys = settings.childGroups();
-      QStringList childKeys = settings.childKeys();
-      for (const auto& key:childKeys) {
-        // do override
-        if (label_ == key) {
-          pngName = settings.value(key).toString();
-        }
-      }
+    const auto& overrides = parent_->model()->overrideConfig();
+    QString pngName = overrides.iconOverride(label_);
+    if (pngName.isEmpty()) {
+      pngName = iconName;
     }
 
     // put together icon path
     // FIXME: use os independent path join 
-    QString qstr;
-    {
-      QSettings settings;
-      settings.beginGroup("global");
-      QStringList childKeys = settings.childKeys();
-      std::cout << "ICONPATH: " << settings.value("iconPath").toString().toStdString() << "\n";
-      std::string newIconPath = settings.value("iconPath").toString().toStdString() + "/" + pngName.toStdString() + ".png";
-      qstr = QString::fromStdString(newIconPath);
-      std::cout << "Loading from " << newIconPath << " here.\n";
-    }
+    const QString qstr = overrides.iconPath() + "/" + pngName + ".png";
+    std::cout << "Loading from " << qstr.toStdString() << " here.\n";
 
     QPixmap icon;
     icon.load (qstr);
     std::cout << "Icon has size " << icon.height() << "x" << icon.width() << ".\n";
-    if (icon.height() == 0) {
+    iconFound_ = (icon.height() != 0);
+    if (!iconFound_) {
         // load stub
         std::string newIconPath = "/home/aydin/.icons/Moka/stash/kchmviewer.png";
         QString qstr = QString::fromStdString(newIconPath);
@@ -252,22 +256,38 @@ const QPixmap& IconBasedDockItem::getIcon(int size) const {
 
 void IconBasedDockItem::generateIcons(const QPixmap& icon) {
   originalImage_ = icon.toImage(); // Convert to QImage for fast scaling.
+  // So that the next draw() recolors the new icon.
+  position_ = -1;
   mipmapIcons (originalImage_);
 }
 
 void IconBasedDockItem::mipmapIcons (const QImage& image) {
+  // Only the sizes are needed here, the icons themselves are scaled lazily by
+  // draw(), so that changing the size range is cheap enough to follow a
+  // slider.
   for (int size = minSize_; size <= maxSize_; ++size) {
-    icons_[size - minSize_] = QPixmap::fromImage(
-        (orientation_ == Qt::Horizontal)
-            ? image.scaledToHeight(size, Qt::SmoothTransformation)
-            : image.scaledToWidth(size, Qt::SmoothTransformation));
-    iconsHeights_[size - minSize_] = icons_[size - minSize_].height();
-    iconsWidths_[size - minSize_] = icons_[size - minSize_].width();
-    // free image again
+    const QSize iconSize = scaledSize(image, size);
+    iconsHeights_[size - minSize_] = iconSize.height();
+    iconsWidths_[size - minSize_] = iconSize.width();
+    // Invalidates the cache.
     icons_[size - minSize_] = QPixmap();
   }
-  // create mipmaps only for sizes etc
-  return;
+}
+
+QSize IconBasedDockItem::scaledSize(const QImage& image, int size) const {
+  // The same as QImage::scaledToHeight()/scaledToWidth() with
+  // Qt::SmoothTransformation, see QImage::transformed().
+  if (image.isNull() || size <= 0) {
+    return QSize();
+  }
+  const int length = (orientation_ == Qt::Horizontal) ? image.height()
+                                                      : image.width();
+  if (size == length) {
+    return image.size();
+  }
+  const qreal factor = static_cast<qreal>(size) / length;
+  return QSize(static_cast<int>(factor * image.width() + 0.9999),
+               static_cast<int>(factor * image.height() + 0.9999));
 }
 
 
@@ -23,6 +23,7 @@
 
 #include <QPainter>
 #include <QPixmap>
+#include <QSize>
 #include <QString>
 #include <QImage>
 #include <Qt>
@@ -52,6 +53,13 @@ class IconBasedDockItem : public DockItem {
 
   void draw(QPainter* painter, int position, int maxPosition) override;
 
+  // Resizes the icon cache from the already loaded icon.
+  void setSizeRange(int minSize, int maxSize) override;
+
+  // Keeps the icon cache of a square icon, which is the same in both
+  // orientations.
+  void setOrientation(Qt::Orientation orientation) override;
+
   int getIconWidth (int size) const;
   int getIconHeight (int size) const;
 
@@ -61,6 +69,9 @@ class IconBasedDockItem : public DockItem {
   void setIconName(const QString& iconName);
   const QPixmap& getIcon(int size) const;
   QString getIconName() const { return iconName_; }
+  // Whether the icon set by setIconName() has been found, as opposed to
+  // the stub icon being used.
+  bool iconFound() const { return iconFound_; }
 
  protected:
   std::vector<QPixmap> icons_;
@@ -68,7 +79,7 @@ class IconBasedDockItem : public DockItem {
   std::vector<int> iconsWidths_;
 
   QString iconName_;
-
+  bool iconFound_ = false;
 
  private:
   static const int kIconLoadSize = 128;
@@ -79,6 +90,8 @@ class IconBasedDockItem : public DockItem {
   void recolorIcon (QImage& img, int position, int maxPosition);
   void generateIcons(const QPixmap& icon);
   void mipmapIcons (const QImage& image);
+  // The size of the image scaled to the icon size.
+  QSize scaledSize(const QImage& image, int size) const;
 
   friend class DockPanel;
 };
@@ -18,6 +18,8 @@
 
 #include "multi_dock_view.h"
 
+#include <utility>
+
 #include <KWindowSystem>
 
 #include "add_panel_dialog.h"
@@ -25,7 +27,13 @@
 namespace ksmoothdock {
 
 MultiDockView::MultiDockView(MultiDockModel* model)
+    : MultiDockView(model, WindowSystemBackend::create()) {}
+
+MultiDockView::MultiDockView(MultiDockModel* model,
+                             std::unique_ptr<WindowSystemBackend> windowSystem)
     : model_(model),
+      windowSystem_(std::move(windowSystem)),
+      taskHelper_(windowSystem_.get(), &screenTopology_),
       wallpaperHelper_(model) {
   connect(model_, SIGNAL(dockAdded(int)), this, SLOT(onDockAdded(int)));
   connect(model_, SIGNAL(wallpaperChanged(int)), &wallpaperHelper_,
@@ -28,7 +28,10 @@
 
 #include "dock_panel.h"
 #include <model/multi_dock_model.h>
+#include <utils/screen_topology.h>
+#include <utils/task_helper.h>
 #include <utils/wallpaper_helper.h>
+#include <utils/window_system_backend.h>
 
 namespace ksmoothdock {
 
@@ -39,10 +42,20 @@ class MultiDockView : public QObject {
  public:
   // No pointer ownership.
   explicit MultiDockView(MultiDockModel* model);
+  // Uses the given window system instead of WindowSystemBackend::create(),
+  // e.g. a replayed one in tests.
+  MultiDockView(MultiDockModel* model,
+                std::unique_ptr<WindowSystemBackend> windowSystem);
   ~MultiDockView() = default;
 
   void show();
 
+  WindowSystemBackend* windowSystem() { return windowSystem_.get(); }
+
+  ScreenTopology* screenTopology() { return &screenTopology_; }
+
+  TaskHelper* taskHelper() { return &taskHelper_; }
+
  public slots:
   void exit();
 
@@ -55,6 +68,10 @@ class MultiDockView : public QObject {
   void createDefaultDock();
 
   MultiDockModel* model_;  // No ownership.
+  // These need to be declared before docks_ so that they outlive them.
+  std::unique_ptr<WindowSystemBackend> windowSystem_;
+  ScreenTopology screenTopology_;
+  TaskHelper taskHelper_;
   std::unordered_map<int, std::unique_ptr<DockPanel>> docks_;
   WallpaperHelper wallpaperHelper_;
 };
@@ -18,6 +18,7 @@
 
 #include "program.h"
 
+#include <algorithm>
 #include <iostream>
 
 #include <QGuiApplication>
@@ -44,6 +45,7 @@ Program::Program(DockPanel* parent, MultiDockModel* model, const QString& label,
       taskCommand_(taskCommand),
       launching_(false),
       pinned_(pinned),
+      activeTask_(-1),
       demandsAttention_(false),
       attentionStrong_(false) {
   createMenu();
@@ -57,7 +59,7 @@ Program::Program(DockPanel* parent, MultiDockModel* model, const QString& label,
 
 void Program::draw(QPainter *painter, int position, int maxPosition)  {
   // std::cout << " program " << position << "\n";
-  if (launching_ || (!tasks_.empty() && active()) || attentionStrong_) {
+  if (launching_ || active() || attentionStrong_) {
     drawHighlightedIcon(model_->backgroundColor(), left_, top_, getWidth(), getHeight(),
                         5, size_ / 8, painter);
   } else if (!tasks_.empty()) {
@@ -84,20 +86,35 @@ void Program::mousePressEvent(QMouseEvent* e) {
         if (mod & Qt::ShiftModifier) {
           launch();
         } else {
+          auto* windowSystem = parent_->windowSystem();
           const auto activeTask = getActiveTask();
           if (activeTask >= 0) {
             if (tasks_.size() == 1) {
-              KWindowSystem::minimizeWindow(tasks_[0].wId);
+              windowSystem->minimizeWindow(tasks_[0].wId);
             } else {
-              // Cycles through tasks.
+              // Cycles through tasks in the order of creation. In the
+              // most-recently-used order, it would only alternate between the
+              // two most recent ones.
               auto nextTask = (activeTask < static_cast<int>(tasks_.size() - 1)) ?
                     (activeTask + 1) : 0;
-              KWindowSystem::forceActiveWindow(tasks_[nextTask].wId);
+              windowSystem->activateWindow(tasks_[nextTask].wId);
             }
           } else {
-            for (unsigned i = 0; i < tasks_.size(); ++i) {
-              KWindowSystem::forceActiveWindow(tasks_[i].wId);
+            // Raises all the windows keeping their most-recently-used order,
+            // then activates the most recently used one. Raising doesn't
+            // restore the minimized windows, so they are activated first.
+            if (mru_.size() > 1) {
+              QList<WId> wIds;
+              wIds.reserve(static_cast<int>(mru_.size()));
+              for (auto it = mru_.rbegin(); it != mru_.rend(); ++it) {
+                if (*it != mru_.front() && parent_->isWindowMinimized(*it)) {
+                  windowSystem->activateWindow(*it);
+                }
+                wIds.append(*it);
+              }
+              windowSystem->raiseWindows(wIds);
             }
+            windowSystem->activateWindow(mru_.front());
           }
         }
       }
@@ -116,7 +133,25 @@ QString Program::getLabel() const {
 
 bool Program::addTask(const TaskInfo& task) {
   if (areTheSameCommand(taskCommand_, task.command)) {
-    tasks_.push_back(ProgramTask(task.wId, task.name, task.demandsAttention));
+    // Tasks usually arrive in the order of creation, but not always, e.g.
+    // when they move to the dock's screen or desktop.
+    const auto next = std::upper_bound(
+        tasks_.begin(), tasks_.end(), task.creationOrder,
+        [](int creationOrder, const ProgramTask& existingTask) {
+          return creationOrder < existingTask.creationOrder;
+        });
+    const int index = static_cast<int>(next - tasks_.begin());
+    tasks_.insert(next, ProgramTask(task.wId, task.name, task.demandsAttention,
+                                    task.creationOrder));
+    if (activeTask_ >= index) {
+      ++activeTask_;
+    }
+    if (task.wId == parent_->activeWindow()) {
+      activeTask_ = index;
+      mru_.insert(mru_.begin(), task.wId);
+    } else {
+      mru_.push_back(task.wId);
+    }
     if (task.demandsAttention) {
       setDemandsAttention(true);
     }
@@ -145,12 +180,31 @@ bool Program::removeTask(WId wId) {
   for (int i = 0; i < static_cast<int>(tasks_.size()); ++i) {
     if (tasks_[i].wId == wId) {
       tasks_.erase(tasks_.begin() + i);
+      if (activeTask_ == i) {
+        activeTask_ = -1;
+      } else if (activeTask_ > i) {
+        --activeTask_;
+      }
+      mru_.erase(std::remove(mru_.begin(), mru_.end(), wId), mru_.end());
       return true;
     }
   }
   return false;
 }
 
+bool Program::setActiveWindow(WId wId) {
+  const bool wasActive = active();
+  activeTask_ = -1;
+  for (int i = 0; i < static_cast<int>(tasks_.size()); ++i) {
+    if (tasks_[i].wId == wId) {
+      activeTask_ = i;
+      touchMru(wId);
+      break;
+    }
+  }
+  return active() != wasActive;
+}
+
 bool Program::hasTask(WId wId) {
   for (const auto& task : tasks_) {
     if (task.wId == wId) {
@@ -235,6 +289,13 @@ void Program::setDemandsAttention(bool value) {
   }
 }
 
+void Program::touchMru(WId wId) {
+  auto it = std::find(mru_.begin(), mru_.end(), wId);
+  if (it != mru_.end()) {
+    std::rotate(mru_.begin(), it, it + 1);
+  }
+}
+
 void Program::updateDemandsAttention() {
   for (const auto& task : tasks_) {
     if (task.demandsAttention) {
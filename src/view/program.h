@@ -22,6 +22,7 @@
 #include <vector>
 
 #include <QAction>
+#include <QList>
 #include <QMenu>
 #include <QPixmap>
 #include <QTimer>
@@ -39,9 +40,13 @@ struct ProgramTask {
   WId wId;
   QString name;  // e.g. home -- Dolphin
   bool demandsAttention;
+  // See TaskInfo::creationOrder.
+  int creationOrder;
 
-  ProgramTask(WId wId2, QString name2, bool demandsAttention2)
-    : wId(wId2), name(name2), demandsAttention(demandsAttention2) {}
+  ProgramTask(WId wId2, QString name2, bool demandsAttention2,
+              int creationOrder2)
+    : wId(wId2), name(name2), demandsAttention(demandsAttention2),
+      creationOrder(creationOrder2) {}
 };
 
 class Program : public QObject, public IconBasedDockItem {
@@ -76,16 +81,13 @@ class Program : public QObject, public IconBasedDockItem {
 
   int taskCount() const { return static_cast<int>(tasks_.size()); }
 
-  bool active() const { return getActiveTask() >= 0; }
+  const QString& taskCommand() const { return taskCommand_; }
 
-  int getActiveTask() const {
-    for (int i = 0; i < static_cast<int>(tasks_.size()); ++i) {
-      if (KWindowSystem::activeWindow() == tasks_[i].wId) {
-        return i;
-      }
-    }
-    return -1;
-  }
+  bool setActiveWindow(WId wId) override;
+
+  bool active() const { return activeTask_ >= 0; }
+
+  int getActiveTask() const { return activeTask_; }
 
   bool pinned() { return pinned_; }
   void pinUnpin();
@@ -100,13 +102,21 @@ class Program : public QObject, public IconBasedDockItem {
   void setDemandsAttention(bool value);
   void updateDemandsAttention();
 
+  // Moves the window to the front of the most-recently-used list.
+  void touchMru(WId wId);
+
   MultiDockModel* model_;
   QString name_;
   QString command_;
   QString taskCommand_;
   bool launching_;
   bool pinned_;
+  // Tasks in the order of creation, as in TaskInfo::creationOrder.
   std::vector<ProgramTask> tasks_;
+  // Index of the active task, or -1 if none of the tasks is active.
+  int activeTask_;
+  // Task windows, most recently used first.
+  std::vector<WId> mru_;
 
   // Context (right-click) menu.
   QMenu menu_;
@@ -118,6 +128,7 @@ class Program : public QObject, public IconBasedDockItem {
   bool attentionStrong_;
 
   friend class DockPanel;
+  friend class DockPanelTest;
 };
 
 }  // namespace ksmoothdock